@@ -0,0 +1,210 @@
+#include "AnsiText.h"
+#include "CommandCatalog.h"
+#include "DocumentWriter.h"
+#include "TerminalWidget.h"
+#include "Utf8Decoder.h"
+
+#include <QApplication>
+#include <QByteArray>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextBrowser>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+// Matches the pty read size in ChatterClient::handleMasterReadyRead.
+constexpr int kReadChunk = 4096;
+
+QByteArray loadCorpus(const char *name)
+{
+    QFile file(QStringLiteral(CHATTER_BENCH_CORPUS_DIR "/") + QLatin1String(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qFatal("missing benchmark corpus %s", name);
+    }
+    return file.readAll();
+}
+
+// The corpus as the client sees it: one decoded string per pty read.
+QStringList decodedBatches(const QByteArray &bytes)
+{
+    QStringList batches;
+    Utf8Decoder decoder;
+    for (int offset = 0; offset < bytes.size(); offset += kReadChunk) {
+        decoder.append(bytes.constData() + offset, std::min(kReadChunk, int(bytes.size()) - offset));
+        const QString text = decoder.take();
+        if (!text.isEmpty()) {
+            batches.append(text);
+        }
+    }
+    return batches;
+}
+
+qint64 totalSize(const QStringList &batches)
+{
+    qint64 size = 0;
+    for (const QString &batch : batches) {
+        size += batch.size();
+    }
+    return size;
+}
+
+void BM_Utf8BoundaryLength(benchmark::State &state, const char *corpus)
+{
+    const QByteArray bytes = loadCorpus(corpus);
+    Utf8Decoder decoder;
+    decoder.append(bytes.constData(), bytes.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decoder.boundaryLength());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+void BM_TakeDecodedOutput(benchmark::State &state, const char *corpus)
+{
+    const QByteArray bytes = loadCorpus(corpus);
+    for (auto _ : state) {
+        Utf8Decoder decoder;
+        for (int offset = 0; offset < bytes.size(); offset += kReadChunk) {
+            decoder.append(bytes.constData() + offset, std::min(kReadChunk, int(bytes.size()) - offset));
+            benchmark::DoNotOptimize(decoder.take());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+void BM_ParseAnsiText(benchmark::State &state, const char *corpus)
+{
+    const QStringList batches = decodedBatches(loadCorpus(corpus));
+    const QTextCharFormat baseFormat;
+    for (auto _ : state) {
+        for (const QString &batch : batches) {
+            benchmark::DoNotOptimize(AnsiText::parse(batch, baseFormat));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * totalSize(batches));
+}
+
+// applySgr is internal to AnsiText, so feed the parser nothing but SGR runs
+// lifted from the palette corpus, one visible character apiece.
+void BM_ApplySgr(benchmark::State &state)
+{
+    const QString corpus = QString::fromUtf8(loadCorpus("palette.ans"));
+    static const QRegularExpression sgr(QStringLiteral("\x1b\\[[0-9;]*m"));
+    QString input;
+    auto it = sgr.globalMatch(corpus);
+    qint64 sequences = 0;
+    while (it.hasNext()) {
+        input += it.next().captured() + QLatin1Char('x');
+        ++sequences;
+    }
+
+    const QTextCharFormat baseFormat;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AnsiText::parse(input, baseFormat));
+    }
+    state.SetItemsProcessed(state.iterations() * sequences);
+}
+
+void BM_InsertFragmentWithLinks(benchmark::State &state, const char *corpus)
+{
+    const QStringList batches = decodedBatches(loadCorpus(corpus));
+    QVector<FormattedFragment> fragments;
+    for (const QString &batch : batches) {
+        fragments += AnsiText::parse(batch, QTextCharFormat());
+    }
+
+    for (auto _ : state) {
+        QTextDocument document;
+        QTextCursor cursor(&document);
+        for (const FormattedFragment &fragment : fragments) {
+            DocumentWriter::insertFragmentWithLinks(cursor, fragment.text, fragment.format);
+        }
+        benchmark::DoNotOptimize(document.characterCount());
+    }
+    state.SetItemsProcessed(state.iterations() * fragments.size());
+}
+
+// What MainWindow::appendMessage runs: TerminalWidget::appendOutput on an
+// offscreen widget, so highlighting, reflow and indexing count with the insert.
+void BM_AppendOutput(benchmark::State &state, const char *corpus)
+{
+    const QStringList batches = decodedBatches(loadCorpus(corpus));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto terminal = std::make_unique<TerminalWidget>();
+        terminal->resize(900, 600);
+        terminal->show();
+        QApplication::processEvents();
+        state.ResumeTiming();
+
+        for (const QString &batch : batches) {
+            terminal->appendOutput(batch);
+        }
+        benchmark::DoNotOptimize(terminal->display()->document()->blockCount());
+
+        state.PauseTiming();
+        terminal.reset();
+        QApplication::processEvents();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * totalSize(batches));
+}
+
+void BM_CommandCatalogIndexOf(benchmark::State &state)
+{
+    QStringList names;
+    for (int i = 0; i < CommandCatalog::commandCount(); ++i) {
+        names.append(CommandCatalog::name(i));
+    }
+    // Chat lines that merely look like commands have to miss quickly too.
+    names << QStringLiteral("/shrug") << QStringLiteral("/asciiartt") << QStringLiteral("/") << QStringLiteral("/zz");
+
+    for (auto _ : state) {
+        for (const QString &name : names) {
+            benchmark::DoNotOptimize(CommandCatalog::indexOf(name));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Utf8BoundaryLength, chat, "chat.ans");
+BENCHMARK_CAPTURE(BM_TakeDecodedOutput, chat, "chat.ans");
+BENCHMARK_CAPTURE(BM_TakeDecodedOutput, tetris, "tetris.ans");
+BENCHMARK_CAPTURE(BM_ParseAnsiText, chat, "chat.ans");
+BENCHMARK_CAPTURE(BM_ParseAnsiText, palette, "palette.ans");
+BENCHMARK_CAPTURE(BM_ParseAnsiText, tetris, "tetris.ans");
+BENCHMARK(BM_ApplySgr);
+BENCHMARK_CAPTURE(BM_InsertFragmentWithLinks, chat, "chat.ans");
+BENCHMARK_CAPTURE(BM_AppendOutput, chat, "chat.ans")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_AppendOutput, palette, "palette.ans")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_AppendOutput, tetris, "tetris.ans")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CommandCatalogIndexOf);
+
+int main(int argc, char **argv)
+{
+    // The terminal widget needs a GUI application but never a screen.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return EXIT_SUCCESS;
+}
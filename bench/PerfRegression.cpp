@@ -0,0 +1,253 @@
+#include "ChatterClient.h"
+#include "HistoryStore.h"
+#include "MessageFilter.h"
+#include "TerminalWidget.h"
+
+#include <QApplication>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+#include <errno.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+constexpr int kReplayChunk = 4096;
+constexpr int kPassTimeoutMs = 120000;
+constexpr int kDefaultPasses = 3;
+constexpr double kDefaultTolerance = 0.2;
+// The exit status ctest reports as a skip (SKIP_RETURN_CODE in bench/CMakeLists.txt).
+constexpr int kSkipExitCode = 77;
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+// Child side of a pass: plays the corpus into the pty the way ssh relays a
+// remote session, with the local line discipline out of the way.
+int replay(const char *path)
+{
+    termios mode;
+    if (::tcgetattr(STDOUT_FILENO, &mode) == 0) {
+        ::cfmakeraw(&mode);
+        ::tcsetattr(STDOUT_FILENO, TCSANOW, &mode);
+    }
+
+    QFile file(QString::fromLocal8Bit(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return EXIT_FAILURE;
+    }
+    const QByteArray bytes = file.readAll();
+
+    qsizetype offset = 0;
+    while (offset < bytes.size()) {
+        const size_t length = static_cast<size_t>(std::min<qsizetype>(kReplayChunk, bytes.size() - offset));
+        const ssize_t written = ::write(STDOUT_FILENO, bytes.constData() + offset, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return EXIT_FAILURE;
+        }
+        offset += written;
+    }
+    ::tcdrain(STDOUT_FILENO);
+    return EXIT_SUCCESS;
+}
+
+// Runs one replay through a fresh client and terminal; returns the elapsed
+// nanoseconds, or -1 if the session timed out or lost output.
+qint64 runPass(const QString &replayCommand, qsizetype expectedLength)
+{
+    qputenv("CHATTER_FRONTEND_COMMAND", replayCommand.toLocal8Bit());
+
+    // Output takes the window's path: history log, default filter, display.
+    const QTemporaryDir historyDir;
+    HistoryStore history;
+    if (!historyDir.isValid() || !history.open(historyDir.path(), QStringLiteral("perf"))) {
+        out() << "pass failed: can't open a scratch history\n";
+        return -1;
+    }
+    MessageFilter filter;
+
+    TerminalWidget terminal;
+    terminal.resize(900, 600);
+    terminal.show();
+
+    ChatterClient client;
+    QObject::connect(&terminal, &TerminalWidget::terminalSizeChanged, &client, &ChatterClient::setTerminalSize);
+
+    qsizetype received = 0;
+    QEventLoop loop;
+    QObject::connect(&client, &ChatterClient::outputReceived, &terminal, [&](const QString &text) {
+        received += text.size();
+        terminal.receiveOutput(text, &filter, &history);
+    });
+    bool started = false;
+    QObject::connect(&client, &ChatterClient::connectionStateChanged, &loop, [&](bool connected) {
+        started = started || connected;
+        if (!connected) {
+            loop.quit();
+        }
+    });
+    QObject::connect(&client, &ChatterClient::errorReceived, &loop, [](const QString &text) {
+        out() << text.trimmed() << '\n';
+    });
+
+    bool timedOut = false;
+    QTimer::singleShot(kPassTimeoutMs, &loop, [&]() {
+        timedOut = true;
+        loop.quit();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    client.start();
+    if (started) {
+        loop.exec();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    if (!started || timedOut || received != expectedLength) {
+        const char *reason = !started ? "no session" : timedOut ? "timed out" : "output incomplete";
+        out() << "pass failed: " << reason << ", received " << received << " of " << expectedLength
+              << " characters\n";
+        return -1;
+    }
+    return elapsed;
+}
+
+qint64 peakRssKiB()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+QJsonObject readBaseline(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+bool writeBaseline(const QString &path, const QJsonObject &baseline)
+{
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(baseline).toJson()) >= 0
+        && file.commit();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && qstrcmp(argv[1], "--replay") == 0) {
+        return replay(argv[2]);
+    }
+
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays a corpus through client, parser and display."));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("corpus"), QStringLiteral("Corpus file to replay."), QStringLiteral("path")});
+    parser.addOption({QStringLiteral("baseline"), QStringLiteral("Baseline JSON file."), QStringLiteral("path")});
+    parser.addOption({QStringLiteral("passes"), QStringLiteral("Replays to run; the fastest counts."), QStringLiteral("count"),
+                      QString::number(kDefaultPasses)});
+    parser.addOption({QStringLiteral("record"), QStringLiteral("Store the measurements as the new baseline.")});
+    parser.process(app);
+
+    const QFileInfo corpusInfo(parser.value(QStringLiteral("corpus")));
+    QFile corpus(corpusInfo.absoluteFilePath());
+    if (!corpus.open(QIODevice::ReadOnly)) {
+        out() << "can't read corpus " << corpusInfo.filePath() << '\n';
+        return EXIT_FAILURE;
+    }
+    const QByteArray bytes = corpus.readAll();
+    const qsizetype expectedLength = QString::fromUtf8(bytes).size();
+    const QString name = corpusInfo.completeBaseName();
+
+    // ChatterClient splits the override on spaces, so neither path may hold one.
+    const QString replayCommand = QStringLiteral("%1 --replay %2")
+                                      .arg(QFileInfo(QCoreApplication::applicationFilePath()).absoluteFilePath(),
+                                           corpusInfo.absoluteFilePath());
+
+    qint64 best = -1;
+    const int passes = std::max(1, parser.value(QStringLiteral("passes")).toInt());
+    for (int pass = 0; pass < passes; ++pass) {
+        const qint64 elapsed = runPass(replayCommand, expectedLength);
+        if (elapsed < 0) {
+            return EXIT_FAILURE;
+        }
+        best = best < 0 ? elapsed : std::min(best, elapsed);
+    }
+
+    const double throughput = double(bytes.size()) / 1024.0 / (double(std::max<qint64>(best, 1)) / 1e9);
+    const qint64 peakRss = peakRssKiB();
+    out() << name << ": " << qRound64(throughput) << " KiB/s, peak RSS " << peakRss << " KiB\n";
+
+    const QString baselinePath = parser.value(QStringLiteral("baseline"));
+    QJsonObject baseline = readBaseline(baselinePath);
+    QJsonObject corpora = baseline.value(QStringLiteral("corpora")).toObject();
+
+    if (parser.isSet(QStringLiteral("record"))) {
+        corpora.insert(name, QJsonObject{
+            {QStringLiteral("throughputKiBps"), qRound64(throughput)},
+            {QStringLiteral("peakRssKiB"), peakRss},
+        });
+        baseline.insert(QStringLiteral("corpora"), corpora);
+        if (!baseline.contains(QStringLiteral("tolerance"))) {
+            baseline.insert(QStringLiteral("tolerance"), kDefaultTolerance);
+        }
+        if (!writeBaseline(baselinePath, baseline)) {
+            out() << "can't write baseline " << baselinePath << '\n';
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    const QJsonObject expected = corpora.value(name).toObject();
+    if (expected.isEmpty()) {
+        out() << "no recorded baseline for " << name << " in " << baselinePath
+              << "; skipping. Run the perf-record-baseline target on the reference machine\n";
+        return kSkipExitCode;
+    }
+
+    const double tolerance = baseline.value(QStringLiteral("tolerance")).toDouble(kDefaultTolerance);
+    const double minimumThroughput = expected.value(QStringLiteral("throughputKiBps")).toDouble() * (1.0 - tolerance);
+    const double maximumRss = expected.value(QStringLiteral("peakRssKiB")).toDouble() * (1.0 + tolerance);
+
+    bool passed = true;
+    if (throughput < minimumThroughput) {
+        out() << "throughput regression: " << qRound64(throughput) << " KiB/s is below "
+              << qRound64(minimumThroughput) << " KiB/s\n";
+        passed = false;
+    }
+    if (double(peakRss) > maximumRss) {
+        out() << "memory regression: peak RSS " << peakRss << " KiB is above " << qRound64(maximumRss) << " KiB\n";
+        passed = false;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
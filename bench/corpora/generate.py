@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Regenerates the benchmark corpora.
+
+The corpora mirror what the chatter server writes to the pty: CRLF line
+endings, SGR colours, UTF-8 text and, for the games, cursor addressing.
+Output is seeded so the files only change when this script does.
+"""
+
+import os
+import random
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ESC = "\x1b"
+
+HANDLES = ["alice", "bob", "carol", "dave", "eve", "mallory", "trent", "peggy",
+           "victor", "walter", "지민", "하늘", "yuki", "zoë"]
+WORDS = ("the a server build tonight patch tetris score board colour frame latency "
+         "ssh terminal chat lol ok yes no maybe later soon again works broken fixed "
+         "coffee weekend 안녕하세요 고마워요 좋아요 ありがとう ✨ 🎉 👍 🙂").split()
+URLS = ["https://example.com/changelog", "https://git.example.org/chatter/pull/42",
+        "http://paste.example.net/r/8f3a1c"]
+
+
+def chat(rng, lines=1500):
+    out = []
+    for i in range(lines):
+        minute = (i // 7) % 60
+        stamp = f"[{10 + (i // 420) % 12:02d}:{minute:02d}]"
+        roll = rng.random()
+        if roll < 0.06:
+            who = rng.choice(HANDLES)
+            verb = rng.choice(["joined the chat", "has left", "disconnected"])
+            out.append(f"{ESC}[90m{stamp} * {who} {verb}{ESC}[0m")
+            continue
+        who = rng.choice(HANDLES)
+        colour = 31 + HANDLES.index(who) % 6
+        body = " ".join(rng.choice(WORDS) for _ in range(rng.randint(2, 18)))
+        if roll < 0.12:
+            body += " " + rng.choice(URLS)
+        msg_id = f"#{rng.randint(100000, 999999):x}"
+        prefix = f"{ESC}[90m{stamp}{ESC}[0m {ESC}[2m{msg_id}{ESC}[0m "
+        if roll < 0.16:
+            prefix += f"{ESC}[35m[PM]{ESC}[0m "
+        reactions = f" [👍 {rng.randint(1, 9)}]" if roll > 0.95 else ""
+        out.append(f"{prefix}{ESC}[1;{colour}m<{who}>{ESC}[0m {body}{reactions}")
+    return "\r\n".join(out) + "\r\n"
+
+
+def palette(rng, screens=12):
+    out = []
+    for screen in range(screens):
+        out.append(f"{ESC}[1;37m== palette {screen} =={ESC}[0m")
+        for row in range(16):
+            cells = []
+            for col in range(16):
+                index = row * 16 + col
+                fg = 16 + (index * 7) % 240
+                cells.append(f"{ESC}[38;5;{fg};48;5;{index}m{index:3d} ")
+            out.append("".join(cells) + f"{ESC}[0m")
+        for row in range(8):
+            cells = []
+            for col in range(40):
+                r = (row * 32 + screen * 9) % 256
+                g = (col * 6) % 256
+                b = rng.randint(0, 255)
+                cells.append(f"{ESC}[48;2;{r};{g};{b}m ")
+            out.append("".join(cells) + f"{ESC}[0m")
+        for row in range(6):
+            attrs = rng.choice(["1", "3", "4", "7", "1;4", "2;3"])
+            colour = rng.choice(range(30, 38))
+            bright = rng.choice(range(90, 98))
+            out.append(f"{ESC}[{attrs};{colour}mbold/italic {ESC}[{bright}mbright "
+                       f"{ESC}[22;23;24;27mreset-attrs {ESC}[39;49mdefault{ESC}[0m")
+    return "\r\n".join(out) + "\r\n"
+
+
+def tetris(rng, frames=120, width=10, height=20):
+    pieces = [41, 42, 43, 44, 45, 46, 47]
+    board = [[0] * width for _ in range(height)]
+    out = [f"{ESC}[?1049h{ESC}[?25l{ESC}[2J"]
+    for frame in range(frames):
+        if frame % 12 == 0:
+            row = rng.randint(height // 2, height - 1)
+            for col in range(width):
+                if rng.random() < 0.6:
+                    board[row][col] = rng.choice(pieces)
+        if frame % 60 == 59:
+            board.pop()
+            board.insert(0, [0] * width)
+        falling = (frame % height, rng.randint(0, width - 2), rng.choice(pieces))
+        parts = [f"{ESC}[H"]
+        for y in range(height):
+            parts.append(f"{ESC}[{y + 2};4H{ESC}[0m|")
+            for x in range(width):
+                colour = board[y][x]
+                if (y, x) in ((falling[0], falling[1]), (falling[0], falling[1] + 1)):
+                    colour = falling[2]
+                parts.append(f"{ESC}[{colour}m  " if colour else f"{ESC}[0m  ")
+            parts.append(f"{ESC}[0m|")
+        parts.append(f"{ESC}[{height + 2};4H+{'-' * (width * 2)}+")
+        parts.append(f"{ESC}[3;30H{ESC}[1mSCORE{ESC}[0m {frame * 40:7d}")
+        parts.append(f"{ESC}[5;30H{ESC}[1mLINES{ESC}[0m {frame // 60:7d}")
+        out.append("".join(parts))
+    out.append(f"{ESC}[?25h{ESC}[?1049l")
+    return "".join(out)
+
+
+def main():
+    corpora = {
+        "chat.ans": chat(random.Random(1)),
+        "palette.ans": palette(random.Random(2)),
+        "tetris.ans": tetris(random.Random(3)),
+    }
+    for name, text in corpora.items():
+        with open(os.path.join(HERE, name), "w", encoding="utf-8", newline="") as handle:
+            handle.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,274 @@
+#include "AnsiText.h"
+
+#include "TraceRecorder.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QFont>
+#include <QList>
+
+namespace {
+
+QColor basicAnsiColor(int index, bool bright)
+{
+    static const QColor normal[] = {
+        QColor(0, 0, 0),         // black
+        QColor(128, 0, 0),       // red
+        QColor(0, 128, 0),       // green
+        QColor(128, 128, 0),     // yellow
+        QColor(0, 0, 128),       // blue
+        QColor(128, 0, 128),     // magenta
+        QColor(0, 128, 128),     // cyan
+        QColor(192, 192, 192)    // white
+    };
+    static const QColor brightColors[] = {
+        QColor(128, 128, 128),   // bright black / gray
+        QColor(255, 0, 0),       // bright red
+        QColor(0, 255, 0),       // bright green
+        QColor(255, 255, 0),     // bright yellow
+        QColor(0, 0, 255),       // bright blue
+        QColor(255, 0, 255),     // bright magenta
+        QColor(0, 255, 255),     // bright cyan
+        QColor(255, 255, 255)    // bright white
+    };
+
+    index = qBound(0, index, 7);
+    return bright ? brightColors[index] : normal[index];
+}
+
+QColor colorFrom256Palette(int index)
+{
+    if (index < 0) {
+        index = 0;
+    }
+    if (index > 255) {
+        index = 255;
+    }
+
+    if (index < 16) {
+        const bool bright = index >= 8;
+        return basicAnsiColor(index % 8, bright);
+    }
+
+    if (index < 232) {
+        const int base = index - 16;
+        const int r = base / 36;
+        const int g = (base / 6) % 6;
+        const int b = base % 6;
+        auto component = [](int value) {
+            if (value == 0) {
+                return 0;
+            }
+            return 55 + (value * 40);
+        };
+        return QColor(component(r), component(g), component(b));
+    }
+
+    const int gray = 8 + ((index - 232) * 10);
+    return QColor(gray, gray, gray);
+}
+
+void applyExtendedColor(QTextCharFormat &format,
+                        bool isForeground,
+                        const QTextCharFormat &baseFormat,
+                        int mode,
+                        const QList<int> &params,
+                        int &i)
+{
+    if (mode == 5) {
+        if (i + 1 >= params.size()) {
+            return;
+        }
+        const QColor color = colorFrom256Palette(params.at(++i));
+        if (isForeground) {
+            format.setForeground(color);
+        } else {
+            format.setBackground(color);
+        }
+    } else if (mode == 2) {
+        if (i + 3 >= params.size()) {
+            return;
+        }
+        const int r = params.at(++i);
+        const int g = params.at(++i);
+        const int b = params.at(++i);
+        const QColor color(r, g, b);
+        if (!color.isValid()) {
+            return;
+        }
+        if (isForeground) {
+            format.setForeground(color);
+        } else {
+            format.setBackground(color);
+        }
+    } else {
+        if (isForeground) {
+            format.setForeground(baseFormat.foreground());
+        } else {
+            format.setBackground(baseFormat.background());
+        }
+    }
+}
+
+void applySgr(const QList<int> &params,
+              QTextCharFormat &currentFormat,
+              const QTextCharFormat &baseFormat)
+{
+    if (params.isEmpty()) {
+        currentFormat = baseFormat;
+        return;
+    }
+
+    for (int i = 0; i < params.size(); ++i) {
+        const int code = params.at(i);
+        switch (code) {
+        case 0:
+            currentFormat = baseFormat;
+            break;
+        case 1:
+            currentFormat.setFontWeight(QFont::Bold);
+            break;
+        case 3:
+            currentFormat.setFontItalic(true);
+            break;
+        case 4:
+            currentFormat.setFontUnderline(true);
+            break;
+        case 22:
+            currentFormat.setFontWeight(baseFormat.fontWeight());
+            break;
+        case 23:
+            currentFormat.setFontItalic(baseFormat.fontItalic());
+            break;
+        case 24:
+            currentFormat.setFontUnderline(baseFormat.fontUnderline());
+            break;
+        case 30: case 31: case 32: case 33:
+        case 34: case 35: case 36: case 37:
+            currentFormat.setForeground(basicAnsiColor(code - 30, false));
+            break;
+        case 39:
+            currentFormat.setForeground(baseFormat.foreground());
+            break;
+        case 40: case 41: case 42: case 43:
+        case 44: case 45: case 46: case 47:
+            currentFormat.setBackground(basicAnsiColor(code - 40, false));
+            break;
+        case 49:
+            currentFormat.setBackground(baseFormat.background());
+            break;
+        case 90: case 91: case 92: case 93:
+        case 94: case 95: case 96: case 97:
+            currentFormat.setForeground(basicAnsiColor(code - 90, true));
+            break;
+        case 100: case 101: case 102: case 103:
+        case 104: case 105: case 106: case 107:
+            currentFormat.setBackground(basicAnsiColor(code - 100, true));
+            break;
+        case 38:
+        case 48:
+            if (i + 1 < params.size()) {
+                const bool isForeground = (code == 38);
+                const int mode = params.at(++i);
+                applyExtendedColor(currentFormat, isForeground, baseFormat, mode, params, i);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace
+
+QVector<FormattedFragment> AnsiText::parse(const QString &input, const QTextCharFormat &baseFormat,
+                                           QTextCharFormat *state)
+{
+    const TraceScope trace("parseAnsiText");
+    QVector<FormattedFragment> fragments;
+    QTextCharFormat currentFormat = state ? *state : baseFormat;
+    QString buffer;
+
+    auto flushBuffer = [&]() {
+        if (buffer.isEmpty()) {
+            return;
+        }
+        fragments.append({buffer, currentFormat});
+        buffer.clear();
+    };
+
+    for (int i = 0; i < input.size(); ++i) {
+        const QChar ch = input.at(i);
+        if (ch == QLatin1Char('\x1b')) {
+            flushBuffer();
+            if (i + 1 >= input.size()) {
+                continue;
+            }
+            if (input.at(i + 1) != QLatin1Char('[')) {
+                continue;
+            }
+
+            int j = i + 2;
+            QString number;
+            QList<int> params;
+            for (; j < input.size(); ++j) {
+                const QChar c = input.at(j);
+                if (c.isDigit()) {
+                    number.append(c);
+                    continue;
+                }
+                if (c == QLatin1Char(';')) {
+                    params.append(number.isEmpty() ? 0 : number.toInt());
+                    number.clear();
+                    continue;
+                }
+                if (c == QLatin1Char('?')) {
+                    continue;
+                }
+                if (!number.isEmpty() || params.isEmpty()) {
+                    params.append(number.isEmpty() ? 0 : number.toInt());
+                    number.clear();
+                }
+                if (c == QLatin1Char('m')) {
+                    applySgr(params, currentFormat, baseFormat);
+                }
+                break;
+            }
+            i = j;
+            continue;
+        }
+
+        if (ch == QLatin1Char('\r')) {
+            if (i + 1 < input.size() && input.at(i + 1) == QLatin1Char('\n')) {
+                continue;
+            }
+            buffer.append(QLatin1Char('\n'));
+            flushBuffer();
+            continue;
+        }
+
+        if (ch == QLatin1Char('\b')) {
+            if (!buffer.isEmpty()) {
+                buffer.chop(1);
+            }
+            continue;
+        }
+
+        if (ch == QLatin1Char('\a')) {
+            continue;
+        }
+
+        buffer.append(ch);
+    }
+
+    flushBuffer();
+    if (state) {
+        *state = currentFormat;
+    }
+    return fragments;
+}
+
+QColor AnsiText::basicColor(int index, bool bright)
+{
+    return basicAnsiColor(index, bright);
+}
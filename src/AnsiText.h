@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QColor>
+#include <QString>
+#include <QTextCharFormat>
+#include <QVector>
+
+struct FormattedFragment {
+    QString text;
+    QTextCharFormat format;
+};
+
+// Splits terminal output into runs of text that share one SGR format.
+class AnsiText
+{
+public:
+    // With state, parsing starts from *state instead of baseFormat and leaves
+    // the final SGR format there, so colour can carry across separate lines.
+    static QVector<FormattedFragment> parse(const QString &input, const QTextCharFormat &baseFormat,
+                                            QTextCharFormat *state = nullptr);
+    static QColor basicColor(int index, bool bright);
+};
@@ -0,0 +1,289 @@
+#include "AsciiArtLibrary.h"
+
+#include "MessageFilter.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QPointer>
+#include <QSaveFile>
+#include <QThread>
+
+#include <utility>
+
+namespace {
+
+constexpr int kPreviewLength = 60;
+constexpr int kCacheLines = 64 * 64;
+
+QString indexFileName()
+{
+    return QStringLiteral("index.tsv");
+}
+
+QByteArray encodeLines(const QStringList &lines)
+{
+    return lines.join(QLatin1Char('\n')).toUtf8();
+}
+
+QString writeFile(const QString &filePath, const QByteArray &data)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return file.errorString();
+    }
+    if (file.write(data) != data.size()) {
+        const QString error = file.errorString();
+        file.cancelWriting();
+        return error;
+    }
+    if (!file.commit()) {
+        return file.errorString();
+    }
+    return QString();
+}
+
+QString previewOf(const QStringList &lines)
+{
+    for (const QString &line : lines) {
+        QString plain = MessageFilter::stripAnsi(line).simplified();
+        if (!plain.isEmpty()) {
+            plain.replace(QLatin1Char('\t'), QLatin1Char(' '));
+            return plain.left(kPreviewLength);
+        }
+    }
+    return QString();
+}
+
+class ArtWriter : public QObject
+{
+public:
+    QVector<AsciiArtEntry> open(const QString &directory)
+    {
+        m_directory = directory;
+
+        QVector<AsciiArtEntry> entries;
+        QFile index(QDir(directory).filePath(indexFileName()));
+        if (!index.open(QIODevice::ReadOnly)) {
+            return entries;
+        }
+
+        while (!index.atEnd()) {
+            const QString line = QString::fromUtf8(index.readLine()).trimmed();
+            const QStringList fields = line.split(QLatin1Char('\t'));
+            if (fields.size() < 4 || fields.at(0).isEmpty()) {
+                continue;
+            }
+            entries.append(AsciiArtEntry{fields.at(0),
+                                         QDateTime::fromString(fields.at(1), Qt::ISODate),
+                                         fields.at(2).toInt(),
+                                         fields.at(3)});
+        }
+        return entries;
+    }
+
+    QString store(const AsciiArtEntry &entry, const QStringList &lines)
+    {
+        if (m_directory.isEmpty() || !QDir().mkpath(m_directory)) {
+            return QObject::tr("The library directory is not available");
+        }
+
+        const QDir dir(m_directory);
+        const QString error = writeFile(dir.filePath(entry.hash + QStringLiteral(".txt")), encodeLines(lines));
+        if (!error.isEmpty()) {
+            return error;
+        }
+
+        QFile index(dir.filePath(indexFileName()));
+        if (!index.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            return index.errorString();
+        }
+        const QByteArray record = QStringList{entry.hash,
+                                              entry.created.toString(Qt::ISODate),
+                                              QString::number(entry.lineCount),
+                                              entry.preview}.join(QLatin1Char('\t')).toUtf8() + '\n';
+        if (index.write(record) != record.size() || !index.flush()) {
+            return index.errorString();
+        }
+        return QString();
+    }
+
+    QStringList load(const QString &hash) const
+    {
+        QFile file(QDir(m_directory).filePath(hash + QStringLiteral(".txt")));
+        if (m_directory.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+            return QStringList();
+        }
+        return QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'));
+    }
+
+    QString saveAs(const QStringList &lines, const QString &filePath)
+    {
+        return writeFile(filePath, encodeLines(lines));
+    }
+
+private:
+    QString m_directory;
+};
+
+} // namespace
+
+AsciiArtLibrary::AsciiArtLibrary(QObject *parent)
+    : QObject(parent)
+    , m_cache(kCacheLines)
+    , m_writerThread(new QThread(this))
+    , m_writer(new ArtWriter)
+{
+    m_writer->moveToThread(m_writerThread);
+    connect(m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_writerThread->start(QThread::LowPriority);
+}
+
+AsciiArtLibrary::~AsciiArtLibrary()
+{
+    m_writerThread->quit();
+    m_writerThread->wait();
+}
+
+void AsciiArtLibrary::open(const QString &directory)
+{
+    m_directory = directory;
+
+    auto *writer = static_cast<ArtWriter *>(m_writer);
+    QPointer<AsciiArtLibrary> self(this);
+    QMetaObject::invokeMethod(writer, [writer, self, directory]() {
+        const QVector<AsciiArtEntry> entries = writer->open(directory);
+        QMetaObject::invokeMethod(self.data(), [self, entries]() {
+            if (self) {
+                self->mergeLoaded(entries);
+            }
+        });
+    });
+}
+
+QString AsciiArtLibrary::directory() const
+{
+    return m_directory;
+}
+
+QVector<AsciiArtEntry> AsciiArtLibrary::entries() const
+{
+    return m_entries;
+}
+
+void AsciiArtLibrary::requestLines(const QString &hash)
+{
+    const auto pending = m_unwritten.constFind(hash);
+    if (pending != m_unwritten.constEnd()) {
+        emit linesLoaded(hash, pending.value());
+        return;
+    }
+    if (const QStringList *cached = m_cache.object(hash)) {
+        emit linesLoaded(hash, *cached);
+        return;
+    }
+
+    auto *writer = static_cast<ArtWriter *>(m_writer);
+    QPointer<AsciiArtLibrary> self(this);
+    QMetaObject::invokeMethod(writer, [writer, self, hash]() {
+        const QStringList lines = writer->load(hash);
+        QMetaObject::invokeMethod(self.data(), [self, hash, lines]() {
+            if (!self) {
+                return;
+            }
+            if (!lines.isEmpty()) {
+                self->m_cache.insert(hash, new QStringList(lines), static_cast<int>(lines.size()));
+            }
+            emit self->linesLoaded(hash, lines);
+        });
+    });
+}
+
+void AsciiArtLibrary::store(const QStringList &lines)
+{
+    const QString hash = contentHash(lines);
+    if (m_positions.contains(hash)) {
+        emit stored(hash, true, QString());
+        return;
+    }
+
+    const AsciiArtEntry entry{hash, QDateTime::currentDateTime(), static_cast<int>(lines.size()), previewOf(lines)};
+    m_positions.insert(hash, static_cast<int>(m_entries.size()));
+    m_entries.append(entry);
+    m_unwritten.insert(hash, lines);
+
+    auto *writer = static_cast<ArtWriter *>(m_writer);
+    QPointer<AsciiArtLibrary> self(this);
+    QMetaObject::invokeMethod(writer, [writer, self, entry, lines]() {
+        const QString error = writer->store(entry, lines);
+        QMetaObject::invokeMethod(self.data(), [self, hash = entry.hash, error]() {
+            if (!self) {
+                return;
+            }
+            // A failed piece leaves the library so resubmitting retries it.
+            if (error.isEmpty()) {
+                self->m_unwritten.remove(hash);
+            } else {
+                self->removeEntry(hash);
+            }
+            emit self->stored(hash, false, error);
+        });
+    });
+}
+
+void AsciiArtLibrary::saveAs(const QStringList &lines, const QString &filePath)
+{
+    auto *writer = static_cast<ArtWriter *>(m_writer);
+    QPointer<AsciiArtLibrary> self(this);
+    QMetaObject::invokeMethod(writer, [writer, self, lines, filePath]() {
+        const QString error = writer->saveAs(lines, filePath);
+        QMetaObject::invokeMethod(self.data(), [self, filePath, error]() {
+            if (self) {
+                emit self->saved(filePath, error.isEmpty(), error);
+            }
+        });
+    });
+}
+
+QString AsciiArtLibrary::contentHash(const QStringList &lines)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(encodeLines(lines), QCryptographicHash::Sha1).toHex());
+}
+
+void AsciiArtLibrary::mergeLoaded(const QVector<AsciiArtEntry> &entries)
+{
+    QVector<AsciiArtEntry> merged;
+    merged.reserve(entries.size() + m_entries.size());
+    QHash<QString, int> positions;
+    for (const AsciiArtEntry &entry : entries) {
+        if (!positions.contains(entry.hash)) {
+            positions.insert(entry.hash, static_cast<int>(merged.size()));
+            merged.append(entry);
+        }
+    }
+    for (const AsciiArtEntry &entry : std::as_const(m_entries)) {
+        if (!positions.contains(entry.hash)) {
+            positions.insert(entry.hash, static_cast<int>(merged.size()));
+            merged.append(entry);
+        }
+    }
+
+    m_entries.swap(merged);
+    m_positions.swap(positions);
+    emit loaded();
+}
+
+void AsciiArtLibrary::removeEntry(const QString &hash)
+{
+    m_unwritten.remove(hash);
+    const int position = m_positions.value(hash, -1);
+    if (position < 0) {
+        return;
+    }
+
+    m_entries.remove(position);
+    m_positions.remove(hash);
+    for (int i = position; i < m_entries.size(); ++i) {
+        m_positions.insert(m_entries.at(i).hash, i);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QThread;
+
+struct AsciiArtEntry {
+    QString hash;
+    QDateTime created;
+    int lineCount = 0;
+    QString preview;
+};
+
+// Saves and loads ASCII art on a worker thread. Library pieces are named by
+// content hash, so resubmitting an artwork never writes a second copy; the
+// index is kept in memory for browsing, with recently loaded pieces cached.
+class AsciiArtLibrary : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AsciiArtLibrary(QObject *parent = nullptr);
+    ~AsciiArtLibrary() override;
+
+    void open(const QString &directory);
+    QString directory() const;
+    QVector<AsciiArtEntry> entries() const;
+    void requestLines(const QString &hash);
+
+    void store(const QStringList &lines);
+    void saveAs(const QStringList &lines, const QString &filePath);
+
+    static QString contentHash(const QStringList &lines);
+
+signals:
+    void loaded();
+    void linesLoaded(const QString &hash, const QStringList &lines);
+    void stored(const QString &hash, bool duplicate, const QString &error);
+    void saved(const QString &filePath, bool success, const QString &error);
+
+private:
+    void mergeLoaded(const QVector<AsciiArtEntry> &entries);
+    void removeEntry(const QString &hash);
+
+    QString m_directory;
+    QVector<AsciiArtEntry> m_entries;
+    QHash<QString, int> m_positions;
+    QHash<QString, QStringList> m_unwritten;
+    QCache<QString, QStringList> m_cache;
+    QThread *m_writerThread;
+    QObject *m_writer;
+};
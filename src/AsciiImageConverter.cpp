@@ -0,0 +1,300 @@
+#include "AsciiImageConverter.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+namespace {
+
+constexpr int kMaxSourceSide = 1024;
+constexpr int kMinColumns = 8;
+constexpr int kMaxColumns = 240;
+constexpr int kMinRowsPerBand = 16;
+constexpr double kCellAspect = 2.0;
+constexpr float kEdgeThreshold = 1.0f;
+constexpr char kRamp[] = " .:-=+*#%@";
+constexpr int kRampLevels = sizeof(kRamp) - 1;
+
+class BandTask : public QRunnable
+{
+public:
+    BandTask(std::function<void()> work, QSemaphore *done)
+        : m_work(std::move(work))
+        , m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        m_work();
+        m_done->release();
+    }
+
+private:
+    std::function<void()> m_work;
+    QSemaphore *m_done;
+};
+
+// Splits [0, count) into bands on the global pool; the caller runs the first
+// band itself and returns once every band has finished.
+void runInBands(int count, const std::function<void(int, int)> &work)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int bands = std::max(1, std::min(pool->maxThreadCount(), count / kMinRowsPerBand));
+    if (bands <= 1) {
+        work(0, count);
+        return;
+    }
+
+    QSemaphore done;
+    const int perBand = (count + bands - 1) / bands;
+    int queued = 0;
+    for (int first = perBand; first < count; first += perBand) {
+        const int last = std::min(first + perBand, count);
+        pool->start(new BandTask([&work, first, last]() { work(first, last); }, &done));
+        ++queued;
+    }
+    work(0, std::min(perBand, count));
+    done.acquire(queued);
+}
+
+int xtermColorIndex(int red, int green, int blue)
+{
+    static constexpr int cubeLevels[6] = {0, 95, 135, 175, 215, 255};
+    const auto cubeStep = [](int value) {
+        return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40;
+    };
+
+    const int r = cubeStep(red);
+    const int g = cubeStep(green);
+    const int b = cubeStep(blue);
+    const int cubeDistance = (red - cubeLevels[r]) * (red - cubeLevels[r])
+        + (green - cubeLevels[g]) * (green - cubeLevels[g])
+        + (blue - cubeLevels[b]) * (blue - cubeLevels[b]);
+
+    const int average = (red + green + blue) / 3;
+    const int grayStep = average > 238 ? 23 : std::max(0, (average - 3) / 10);
+    const int gray = 8 + 10 * grayStep;
+    const int grayDistance = (red - gray) * (red - gray) + (green - gray) * (green - gray)
+        + (blue - gray) * (blue - gray);
+
+    return grayDistance < cubeDistance ? 232 + grayStep : 16 + 36 * r + 6 * g + b;
+}
+
+QChar edgeCharacter(float gx, float gy)
+{
+    float angle = std::atan2(gy, gx) * 180.0f / 3.14159265f;
+    if (angle < 0.0f) {
+        angle += 180.0f;
+    }
+    if (angle < 22.5f || angle >= 157.5f) {
+        return QLatin1Char('|');
+    }
+    if (angle < 67.5f) {
+        return QLatin1Char('/');
+    }
+    if (angle < 112.5f) {
+        return QLatin1Char('-');
+    }
+    return QLatin1Char('\\');
+}
+
+} // namespace
+
+AsciiImageConverter::AsciiImageConverter()
+    : m_width(0)
+    , m_height(0)
+{
+}
+
+bool AsciiImageConverter::load(const QString &path)
+{
+    const QImage image(path);
+    if (image.isNull()) {
+        return false;
+    }
+    setImage(image);
+    return true;
+}
+
+void AsciiImageConverter::setImage(const QImage &image)
+{
+    QImage source = image;
+    if (source.width() > kMaxSourceSide || source.height() > kMaxSourceSide) {
+        source = source.scaled(kMaxSourceSide, kMaxSourceSide, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    source = source.convertToFormat(QImage::Format_RGB32);
+
+    m_width = source.width();
+    m_height = source.height();
+    const int stride = m_width + 1;
+    const int size = stride * (m_height + 1);
+    m_luma.fill(0, size);
+    m_red.fill(0, size);
+    m_green.fill(0, size);
+    m_blue.fill(0, size);
+    if (source.isNull()) {
+        m_width = 0;
+        m_height = 0;
+        return;
+    }
+
+    quint32 *luma = m_luma.data();
+    quint32 *red = m_red.data();
+    quint32 *green = m_green.data();
+    quint32 *blue = m_blue.data();
+
+    // Horizontal prefix sums, one independent pass per source row.
+    runInBands(m_height, [&](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            const QRgb *pixels = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            const int row = (y + 1) * stride + 1;
+            quint32 l = 0;
+            quint32 r = 0;
+            quint32 g = 0;
+            quint32 b = 0;
+            for (int x = 0; x < m_width; ++x) {
+                const QRgb pixel = pixels[x];
+                r += quint32(qRed(pixel));
+                g += quint32(qGreen(pixel));
+                b += quint32(qBlue(pixel));
+                l += (77u * quint32(qRed(pixel)) + 150u * quint32(qGreen(pixel)) + 29u * quint32(qBlue(pixel))) >> 8;
+                luma[row + x] = l;
+                red[row + x] = r;
+                green[row + x] = g;
+                blue[row + x] = b;
+            }
+        }
+    });
+
+    // Vertical accumulation; each band owns a column range and the inner loop
+    // is a plain contiguous add the compiler can vectorize.
+    runInBands(stride, [&](int first, int last) {
+        for (int y = 2; y <= m_height; ++y) {
+            const int row = y * stride;
+            const int previous = row - stride;
+            for (int x = first; x < last; ++x) {
+                luma[row + x] += luma[previous + x];
+                red[row + x] += red[previous + x];
+                green[row + x] += green[previous + x];
+                blue[row + x] += blue[previous + x];
+            }
+        }
+    });
+}
+
+bool AsciiImageConverter::isNull() const
+{
+    return m_width == 0 || m_height == 0;
+}
+
+QSize AsciiImageConverter::sourceSize() const
+{
+    return QSize(m_width, m_height);
+}
+
+QStringList AsciiImageConverter::convert(const AsciiImageOptions &options) const
+{
+    if (isNull()) {
+        return {};
+    }
+
+    int columns = std::min(std::max(options.columns, kMinColumns), std::min(kMaxColumns, m_width));
+    const double cellWidth = double(m_width) / columns;
+    int rows = std::max(1, int(std::lround(m_height / (cellWidth * kCellAspect))));
+    const int maxRows = std::max(1, std::min(options.maxRows, m_height));
+    if (rows > maxRows) {
+        columns = std::clamp(int(std::lround(double(columns) * maxRows / rows)), 1, columns);
+        rows = maxRows;
+    }
+
+    QVector<Cell> cells(rows * columns);
+    QVector<float> levels(rows * columns);
+    runInBands(rows, [&](int first, int last) {
+        for (int row = first; row < last; ++row) {
+            const int y0 = row * m_height / rows;
+            const int y1 = std::max(y0 + 1, (row + 1) * m_height / rows);
+            for (int column = 0; column < columns; ++column) {
+                const int x0 = column * m_width / columns;
+                const int x1 = std::max(x0 + 1, (column + 1) * m_width / columns);
+                const quint32 area = quint32((x1 - x0) * (y1 - y0));
+
+                Cell &cell = cells[row * columns + column];
+                cell.luma = float(areaSum(m_luma, x0, y0, x1, y1)) / area;
+                cell.red = int(areaSum(m_red, x0, y0, x1, y1) / area);
+                cell.green = int(areaSum(m_green, x0, y0, x1, y1) / area);
+                cell.blue = int(areaSum(m_blue, x0, y0, x1, y1) / area);
+
+                const double level = (cell.luma / 255.0 - 0.5) * options.contrast + 0.5 + options.brightness;
+                levels[row * columns + column] = float(std::clamp(level, 0.0, 1.0));
+            }
+        }
+    });
+
+    QVector<QString> rendered(rows);
+    runInBands(rows, [&](int first, int last) {
+        for (int row = first; row < last; ++row) {
+            rendered[row] = renderRow(cells, levels, row, columns, rows, options);
+        }
+    });
+
+    QStringList lines;
+    lines.reserve(rows);
+    for (const QString &line : std::as_const(rendered)) {
+        lines.append(line);
+    }
+    return lines;
+}
+
+quint32 AsciiImageConverter::areaSum(const QVector<quint32> &table, int x0, int y0, int x1, int y1) const
+{
+    const int stride = m_width + 1;
+    return table.at(y1 * stride + x1) - table.at(y0 * stride + x1)
+        - table.at(y1 * stride + x0) + table.at(y0 * stride + x0);
+}
+
+QString AsciiImageConverter::renderRow(const QVector<Cell> &cells, const QVector<float> &levels, int row,
+                                       int columns, int rows, const AsciiImageOptions &options) const
+{
+    const auto level = [&](int r, int c) {
+        return levels.at(std::clamp(r, 0, rows - 1) * columns + std::clamp(c, 0, columns - 1));
+    };
+
+    QString line;
+    line.reserve(options.colour ? columns * 12 : columns);
+    int currentColor = -1;
+    for (int column = 0; column < columns; ++column) {
+        const float value = level(row, column);
+        QChar ch = QLatin1Char(kRamp[std::min(kRampLevels - 1, int(value * kRampLevels))]);
+
+        if (options.edges) {
+            const float gx = level(row - 1, column + 1) + 2.0f * level(row, column + 1) + level(row + 1, column + 1)
+                - level(row - 1, column - 1) - 2.0f * level(row, column - 1) - level(row + 1, column - 1);
+            const float gy = level(row + 1, column - 1) + 2.0f * level(row + 1, column) + level(row + 1, column + 1)
+                - level(row - 1, column - 1) - 2.0f * level(row - 1, column) - level(row - 1, column + 1);
+            if (gx * gx + gy * gy > kEdgeThreshold * kEdgeThreshold) {
+                ch = edgeCharacter(gx, gy);
+            }
+        }
+
+        if (options.colour && ch != QLatin1Char(' ')) {
+            const Cell &cell = cells.at(row * columns + column);
+            const int color = xtermColorIndex(cell.red, cell.green, cell.blue);
+            if (color != currentColor) {
+                line.append(QStringLiteral("\x1b[38;5;%1m").arg(color));
+                currentColor = color;
+            }
+        }
+        line.append(ch);
+    }
+
+    if (currentColor >= 0) {
+        line.append(QStringLiteral("\x1b[0m"));
+    }
+    return line;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct AsciiImageOptions {
+    int columns = 80;
+    int maxRows = 64;
+    double contrast = 1.0;
+    double brightness = 0.0;
+    bool edges = false;
+    bool colour = false;
+};
+
+// Converts an image into ASCII art. The image is reduced once to summed-area
+// tables, so every preview costs a constant number of lookups per cell.
+class AsciiImageConverter
+{
+public:
+    AsciiImageConverter();
+
+    bool load(const QString &path);
+    void setImage(const QImage &image);
+    bool isNull() const;
+    QSize sourceSize() const;
+
+    QStringList convert(const AsciiImageOptions &options) const;
+
+private:
+    struct Cell {
+        float luma = 0.0f;
+        int red = 0;
+        int green = 0;
+        int blue = 0;
+    };
+
+    quint32 areaSum(const QVector<quint32> &table, int x0, int y0, int x1, int y1) const;
+    QString renderRow(const QVector<Cell> &cells, const QVector<float> &levels, int row, int columns,
+                      int rows, const AsciiImageOptions &options) const;
+
+    int m_width;
+    int m_height;
+    QVector<quint32> m_luma;
+    QVector<quint32> m_red;
+    QVector<quint32> m_green;
+    QVector<quint32> m_blue;
+};
@@ -0,0 +1,129 @@
+#include "ChatLineParser.h"
+
+#include "MessageIdIndex.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace {
+
+constexpr int kHandleMaxLength = 32;
+constexpr int kTimestampMaxLength = 24;
+
+int skipSpaces(const QString &text, int position)
+{
+    while (position < text.size() && text.at(position).isSpace()) {
+        ++position;
+    }
+    return position;
+}
+
+bool isAllDigits(const QString &text)
+{
+    for (const QChar ch : text) {
+        if (!ch.isDigit()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isTimeText(const QString &text)
+{
+    for (const QChar ch : text) {
+        if (!ch.isDigit() && ch != QLatin1Char(':')) {
+            return false;
+        }
+    }
+    return text.contains(QLatin1Char(':'));
+}
+
+int skipPrivateMarker(const QString &text, int position)
+{
+    static const QStringList markers = {
+        QStringLiteral("[PM]"),
+        QStringLiteral("(PM)"),
+        QStringLiteral("[DM]"),
+        QStringLiteral("(DM)"),
+        QStringLiteral("(whisper)")
+    };
+    for (const QString &marker : markers) {
+        if (text.mid(position, marker.size()).compare(marker, Qt::CaseInsensitive) == 0) {
+            return skipSpaces(text, position + static_cast<int>(marker.size()));
+        }
+    }
+    return -1;
+}
+
+void splitReactions(ChatLine *line)
+{
+    static const QRegularExpression trailing(QStringLiteral("\\s*\\[(\\S+ ?\\d+(?:, ?\\S+ ?\\d+)*)\\]\\s*$"));
+    const QRegularExpressionMatch match = trailing.match(line->body);
+    if (match.hasMatch()) {
+        line->reactions = match.captured(1);
+        line->body.truncate(match.capturedStart());
+    }
+}
+
+} // namespace
+
+bool ChatLineParser::parse(const QString &plainLine, ChatLine *line)
+{
+    ChatLine parsed;
+    int position = skipSpaces(plainLine, 0);
+
+    if (position < plainLine.size() && plainLine.at(position) == QLatin1Char('[')) {
+        const int close = plainLine.indexOf(QLatin1Char(']'), position);
+        if (close > position && close - position <= kTimestampMaxLength) {
+            const QString inner = plainLine.mid(position + 1, close - position - 1).trimmed();
+            if (isTimeText(inner)) {
+                parsed.timestamp = inner;
+            }
+            position = skipSpaces(plainLine, close + 1);
+        }
+    }
+
+    parsed.messageId = MessageIdIndex::extractId(plainLine);
+    if (position < plainLine.size() && plainLine.at(position) == QLatin1Char('#')) {
+        while (position < plainLine.size() && !plainLine.at(position).isSpace()) {
+            ++position;
+        }
+        position = skipSpaces(plainLine, position);
+    }
+
+    const int afterMarker = skipPrivateMarker(plainLine, position);
+    if (afterMarker >= 0) {
+        parsed.isPrivate = true;
+        position = afterMarker;
+    }
+
+    int bodyStart = -1;
+    if (position < plainLine.size() && plainLine.at(position) == QLatin1Char('<')) {
+        const int close = plainLine.indexOf(QLatin1Char('>'), position);
+        if (close > position + 1 && close - position <= kHandleMaxLength) {
+            parsed.handle = plainLine.mid(position + 1, close - position - 1);
+            bodyStart = close + 1;
+        }
+    } else {
+        const int colon = plainLine.indexOf(QLatin1Char(':'), position);
+        if (colon > position && colon - position <= kHandleMaxLength
+            && !plainLine.mid(colon + 1, 2).startsWith(QStringLiteral("//"))) {
+            const QString candidate = plainLine.mid(position, colon - position);
+            if (!candidate.contains(QLatin1Char(' ')) && !isAllDigits(candidate)) {
+                parsed.handle = candidate;
+                bodyStart = colon + 1;
+            }
+        }
+    }
+
+    if (parsed.handle.isEmpty()) {
+        return false;
+    }
+
+    parsed.body = plainLine.mid(skipSpaces(plainLine, bodyStart));
+    splitReactions(&parsed);
+    if (line) {
+        *line = parsed;
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QString>
+
+struct ChatLine {
+    QString timestamp;
+    QString handle;
+    QString messageId;
+    QString body;
+    QString reactions;
+    bool isPrivate = false;
+};
+
+// Splits a plain (ANSI-free) chat line into its parts. Recognizes an optional
+// [timestamp], message ID and PM marker ahead of a "<handle>" or "handle:" prefix.
+class ChatLineParser
+{
+public:
+    static bool parse(const QString &plainLine, ChatLine *line);
+};
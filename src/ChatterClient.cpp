@@ -1,7 +1,14 @@
 #include "ChatterClient.h"
 
+#include "CommandValidator.h"
+#include "KeyLatencyProbe.h"
+#include "PerfCounters.h"
+#include "TraceRecorder.h"
+
 #include <QProcessEnvironment>
 #include <QSocketNotifier>
+#include <QTimer>
+#include <QVector>
 #include <QtGlobal>
 
 #include <errno.h>
@@ -11,15 +18,20 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <termios.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace {
 
 constexpr int kDefaultColumns = 80;
 constexpr int kDefaultRows = 24;
+// outboundStatsChanged() is coalesced so typing does not refresh the status
+// bar once per key.
+constexpr int kStatsIntervalMs = 100;
 
 QString defaultUsername()
 {
@@ -42,6 +54,15 @@ QString defaultHost()
     return host;
 }
 
+void configureOutboundRate(OutboundScheduler &scheduler)
+{
+    bool rateOk = false;
+    const double rate = qEnvironmentVariable("CHATTER_SEND_RATE").toDouble(&rateOk);
+    bool burstOk = false;
+    const int burst = qEnvironmentVariableIntValue("CHATTER_SEND_BURST", &burstOk);
+    scheduler.setRate(rateOk ? rate : scheduler.rate(), burstOk ? burst : scheduler.burst());
+}
+
 QByteArray escapeErrorMessage(const QByteArray &message)
 {
     QByteArray sanitized = message;
@@ -57,12 +78,28 @@ ChatterClient::ChatterClient(QObject *parent)
     , m_masterFd(-1)
     , m_childPid(-1)
     , m_readNotifier(nullptr)
+    , m_writeNotifier(nullptr)
+    , m_paceTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+    , m_latencyProbe(nullptr)
+    , m_inFlightOffset(0)
+    , m_hasInFlight(false)
+    , m_nextBatchId(1)
     , m_username(defaultUsername())
     , m_host(defaultHost())
     , m_columns(kDefaultColumns)
     , m_rows(kDefaultRows)
     , m_connected(false)
 {
+    configureOutboundRate(m_outbound);
+    m_clock.start();
+
+    m_paceTimer->setSingleShot(true);
+    connect(m_paceTimer, &QTimer::timeout, this, &ChatterClient::flushOutbound);
+
+    m_statsTimer->setSingleShot(true);
+    m_statsTimer->setInterval(kStatsIntervalMs);
+    connect(m_statsTimer, &QTimer::timeout, this, &ChatterClient::outboundStatsChanged);
 }
 
 ChatterClient::~ChatterClient()
@@ -83,6 +120,11 @@ QString ChatterClient::username() const
     return m_username;
 }
 
+QString ChatterClient::host() const
+{
+    return m_host;
+}
+
 void ChatterClient::start()
 {
     if (isRunning()) {
@@ -143,14 +185,14 @@ void ChatterClient::start()
 
     m_masterFd = masterFd;
     m_childPid = childPid;
-    m_outputBuffer.clear();
+    m_decoder.clear();
 
     const int currentFlags = ::fcntl(m_masterFd, F_GETFL, 0);
     if (currentFlags != -1) {
         ::fcntl(m_masterFd, F_SETFL, currentFlags | O_NONBLOCK);
     }
 
-    installReadNotifier();
+    installNotifiers();
     updateConnectedState(true);
 }
 
@@ -160,7 +202,7 @@ void ChatterClient::stop()
         return;
     }
 
-    removeReadNotifier();
+    removeNotifiers();
 
     if (m_masterFd >= 0) {
         ::close(m_masterFd);
@@ -173,17 +215,23 @@ void ChatterClient::stop()
     }
 
     m_childPid = -1;
-    m_outputBuffer.clear();
+    m_decoder.clear();
     updateConnectedState(false);
 }
 
-void ChatterClient::sendCommand(const QString &command)
+void ChatterClient::sendCommand(const QString &command, OutboundPriority priority)
 {
     const QString trimmed = command.trimmed();
     if (trimmed.isEmpty()) {
         return;
     }
 
+    const QString error = CommandValidator::validate(trimmed);
+    if (!error.isEmpty()) {
+        emit errorReceived(error);
+        return;
+    }
+
     if (!isRunning()) {
         start();
     }
@@ -192,10 +240,10 @@ void ChatterClient::sendCommand(const QString &command)
         return;
     }
 
-    writeBytes(trimmed.toUtf8() + '\r');
+    enqueueOutbound(trimmed.toUtf8() + '\r', priority);
 }
 
-void ChatterClient::sendRawData(const QByteArray &data)
+void ChatterClient::sendRawData(const QByteArray &data, OutboundPriority priority)
 {
     if (data.isEmpty()) {
         return;
@@ -205,7 +253,91 @@ void ChatterClient::sendRawData(const QByteArray &data)
         start();
     }
 
-    writeBytes(data);
+    enqueueOutbound(data, priority);
+}
+
+quint64 ChatterClient::sendLineBatch(const QStringList &lines, const QString &terminator, OutboundPriority priority)
+{
+    QVector<QByteArray> encoded;
+    encoded.reserve(lines.size());
+    const QByteArray end = terminator.trimmed().toUtf8() + '\r';
+    qsizetype total = end.size();
+    for (const QString &line : lines) {
+        // Leading whitespace and blank rows carry layout, so only the right edge is trimmed.
+        qsizetype length = line.size();
+        while (length > 0 && line.at(length - 1).isSpace()) {
+            --length;
+        }
+        const QByteArray bytes = length > 0 ? line.left(length).toUtf8() : QByteArray(" ");
+        encoded.append(bytes);
+        total += bytes.size() + 1;
+    }
+
+    QByteArray data;
+    data.reserve(total);
+    for (const QByteArray &bytes : std::as_const(encoded)) {
+        data.append(bytes);
+        data.append('\r');
+    }
+    data.append(end);
+
+    if (!isRunning()) {
+        start();
+    }
+
+    if (m_masterFd < 0) {
+        return 0;
+    }
+
+    const quint64 batchId = m_nextBatchId++;
+    m_batchTerminators.insert(batchId, end);
+    m_outbound.enqueue(data, priority, m_clock.elapsed(), static_cast<int>(encoded.size()) + 1, batchId);
+
+    // Deferred so the caller can connect to the progress signals for this id.
+    QMetaObject::invokeMethod(this, &ChatterClient::flushOutbound, Qt::QueuedConnection);
+    return batchId;
+}
+
+void ChatterClient::cancelBatch(quint64 batchId)
+{
+    const auto it = m_batchTerminators.constFind(batchId);
+    if (it == m_batchTerminators.constEnd()) {
+        return;
+    }
+
+    if (m_outbound.remove(batchId)) {
+        m_batchTerminators.remove(batchId);
+        emit batchFinished(batchId, false);
+        noteStatsChanged();
+        return;
+    }
+
+    if (!m_hasInFlight || m_inFlight.batchId != batchId) {
+        return;
+    }
+
+    if (m_inFlightOffset == 0) {
+        finishInFlight(false);
+        noteStatsChanged();
+        return;
+    }
+
+    // Finish the line being written, then close the batch so the server does
+    // not stay in multi-line mode.
+    qsizetype cut = m_inFlightOffset;
+    if (m_inFlight.data.at(cut - 1) != '\r') {
+        cut = m_inFlight.data.indexOf('\r', cut) + 1;
+    }
+    const QByteArray terminator = it.value();
+    if (cut + terminator.size() < m_inFlight.data.size()) {
+        m_inFlight.data.truncate(cut);
+        m_inFlight.data.append(terminator);
+    }
+}
+
+OutboundStats ChatterClient::outboundStats(OutboundPriority priority) const
+{
+    return m_outbound.stats(priority);
 }
 
 void ChatterClient::setTerminalSize(int columns, int rows)
@@ -222,6 +354,11 @@ void ChatterClient::setTerminalSize(int columns, int rows)
     applyTerminalSize();
 }
 
+void ChatterClient::setLatencyProbe(KeyLatencyProbe *probe)
+{
+    m_latencyProbe = probe;
+}
+
 QStringList ChatterClient::buildCommand() const
 {
     const QString overrideCommand = qEnvironmentVariable("CHATTER_FRONTEND_COMMAND");
@@ -240,13 +377,24 @@ void ChatterClient::handleMasterReadyRead()
         return;
     }
 
+    const TraceScope trace("handleMasterReadyRead");
+
     char buffer[4096];
     while (true) {
         const ssize_t bytesRead = ::read(m_masterFd, buffer, sizeof(buffer));
         if (bytesRead > 0) {
-            m_outputBuffer.append(buffer, bytesRead);
-
-            QString text = takeDecodedOutput();
+            if (m_latencyProbe) {
+                m_latencyProbe->mark(LatencyStage::Read);
+            }
+            m_decoder.append(buffer, static_cast<int>(bytesRead));
+            PerfCounters &counters = PerfCounters::instance();
+            counters.bytesRead.fetch_add(quint64(bytesRead), std::memory_order_relaxed);
+
+            QString text;
+            {
+                const PerfTimer timer(counters.decodeNanos, counters.decodeBatches);
+                text = takeDecodedOutput();
+            }
             if (!text.isEmpty()) {
                 emit outputReceived(text);
             }
@@ -275,14 +423,14 @@ void ChatterClient::handleMasterReadyRead()
 
 void ChatterClient::handleChildFinished(bool emitErrorMessage)
 {
-    removeReadNotifier();
+    removeNotifiers();
 
     if (m_masterFd >= 0) {
         ::close(m_masterFd);
         m_masterFd = -1;
     }
 
-    if (!m_outputBuffer.isEmpty()) {
+    if (!m_decoder.isEmpty()) {
         const QString text = takeDecodedOutput();
         if (!text.isEmpty()) {
             emit outputReceived(text);
@@ -319,9 +467,9 @@ void ChatterClient::updateConnectedState(bool connected)
     emit connectionStateChanged(connected);
 }
 
-void ChatterClient::installReadNotifier()
+void ChatterClient::installNotifiers()
 {
-    removeReadNotifier();
+    removeNotifiers();
 
     if (m_masterFd < 0) {
         return;
@@ -330,17 +478,29 @@ void ChatterClient::installReadNotifier()
     m_readNotifier = new QSocketNotifier(m_masterFd, QSocketNotifier::Read, this);
     connect(m_readNotifier, &QSocketNotifier::activated,
             this, [this]() { handleMasterReadyRead(); });
+
+    m_writeNotifier = new QSocketNotifier(m_masterFd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, [this]() {
+        m_writeNotifier->setEnabled(false);
+        flushOutbound();
+    });
 }
 
-void ChatterClient::removeReadNotifier()
+void ChatterClient::removeNotifiers()
 {
-    if (!m_readNotifier) {
-        return;
-    }
+    discardOutbound();
 
-    m_readNotifier->setEnabled(false);
-    m_readNotifier->deleteLater();
-    m_readNotifier = nullptr;
+    if (m_readNotifier) {
+        m_readNotifier->setEnabled(false);
+        m_readNotifier->deleteLater();
+        m_readNotifier = nullptr;
+    }
+    if (m_writeNotifier) {
+        m_writeNotifier->setEnabled(false);
+        m_writeNotifier->deleteLater();
+        m_writeNotifier = nullptr;
+    }
 }
 
 bool ChatterClient::isRunning() const
@@ -348,6 +508,15 @@ bool ChatterClient::isRunning() const
     return m_childPid > 0;
 }
 
+bool ChatterClient::isEchoEnabled() const
+{
+    struct termios attributes;
+    if (m_masterFd < 0 || ::tcgetattr(m_masterFd, &attributes) != 0) {
+        return true;
+    }
+    return attributes.c_lflag & ECHO;
+}
+
 void ChatterClient::applyTerminalSize()
 {
     if (m_masterFd < 0) {
@@ -365,96 +534,104 @@ void ChatterClient::applyTerminalSize()
 
 QString ChatterClient::takeDecodedOutput()
 {
-    QString result;
-
-    while (!m_outputBuffer.isEmpty()) {
-        const int length = utf8BoundaryLength();
-        if (length <= 0) {
-            break;
-        }
-
-        result.append(QString::fromUtf8(m_outputBuffer.constData(), length));
-        m_outputBuffer.remove(0, length);
-    }
-
-    return result;
+    const TraceScope trace("takeDecodedOutput");
+    return m_decoder.take();
 }
 
-int ChatterClient::utf8BoundaryLength() const
+void ChatterClient::enqueueOutbound(const QByteArray &data, OutboundPriority priority)
 {
-    if (m_outputBuffer.isEmpty()) {
-        return 0;
-    }
+    // A keystroke with nothing ahead of it becomes the in-flight write
+    // directly; only when it would have to wait does it enter the queue.
+    if (priority == OutboundPriority::Interactive && !m_hasInFlight && m_outbound.isEmpty()) {
+        m_inFlight.data = data;
+        m_inFlight.priority = priority;
+        m_inFlight.enqueuedAt = m_clock.elapsed();
+        m_inFlightOffset = 0;
+        m_hasInFlight = true;
+    } else {
+        m_outbound.enqueue(data, priority, m_clock.elapsed());
+    }
+    flushOutbound();
+}
 
-    const int size = m_outputBuffer.size();
-    int index = 0;
-    int lastComplete = 0;
-
-    while (index < size) {
-        const unsigned char byte = static_cast<unsigned char>(m_outputBuffer.at(index));
-
-        int expected = 0;
-        if ((byte & 0x80) == 0x00) {
-            expected = 1;
-        } else if ((byte & 0xE0) == 0xC0) {
-            expected = 2;
-        } else if ((byte & 0xF0) == 0xE0) {
-            expected = 3;
-        } else if ((byte & 0xF8) == 0xF0) {
-            expected = 4;
-        } else {
-            return index + 1;
+void ChatterClient::flushOutbound()
+{
+    while (m_masterFd >= 0) {
+        if (!m_hasInFlight) {
+            qint64 waitMs = 0;
+            if (!m_outbound.takeNext(m_clock.elapsed(), &m_inFlight, &waitMs)) {
+                if (waitMs > 0) {
+                    m_paceTimer->start(static_cast<int>(waitMs));
+                }
+                break;
+            }
+            m_inFlightOffset = 0;
+            m_hasInFlight = true;
         }
 
-        if (index + expected > size) {
-            break;
+        const qsizetype remaining = m_inFlight.data.size() - m_inFlightOffset;
+        const ssize_t written = ::write(m_masterFd, m_inFlight.data.constData() + m_inFlightOffset,
+                                        static_cast<size_t>(remaining));
+        if (written > 0) {
+            m_inFlightOffset += written;
+            if (m_inFlight.batchId != 0) {
+                emit batchProgress(m_inFlight.batchId, m_inFlightOffset, m_inFlight.data.size());
+            }
+            if (m_inFlightOffset == m_inFlight.data.size()) {
+                if (m_latencyProbe && m_inFlight.priority == OutboundPriority::Interactive) {
+                    m_latencyProbe->mark(LatencyStage::Write);
+                }
+                m_outbound.recordSent(m_inFlight, m_clock.elapsed());
+                finishInFlight(true);
+            }
+            continue;
         }
 
-        bool valid = true;
-        for (int i = 1; i < expected; ++i) {
-            const unsigned char continuation = static_cast<unsigned char>(m_outputBuffer.at(index + i));
-            if ((continuation & 0xC0) != 0x80) {
-                valid = false;
-                break;
-            }
+        if (written < 0 && errno == EINTR) {
+            continue;
         }
 
-        if (!valid) {
-            return index + 1;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && m_writeNotifier) {
+            m_writeNotifier->setEnabled(true);
+            break;
         }
 
-        index += expected;
-        lastComplete = index;
+        finishInFlight(false);
+        break;
     }
 
-    return lastComplete;
+    noteStatsChanged();
 }
 
-void ChatterClient::writeBytes(const QByteArray &data)
+void ChatterClient::finishInFlight(bool delivered)
 {
-    if (m_masterFd < 0 || data.isEmpty()) {
-        return;
-    }
+    const quint64 batchId = m_inFlight.batchId;
+    m_inFlight = OutboundMessage();
+    m_hasInFlight = false;
 
-    const char *buffer = data.constData();
-    qsizetype remaining = data.size();
-
-    while (remaining > 0) {
-        const ssize_t written = ::write(m_masterFd, buffer, static_cast<size_t>(remaining));
-        if (written > 0) {
-            buffer += written;
-            remaining -= written;
-            continue;
-        }
+    if (batchId != 0 && m_batchTerminators.remove(batchId) > 0) {
+        emit batchFinished(batchId, delivered);
+    }
+}
 
-        if (written < 0 && errno == EINTR) {
-            continue;
-        }
+void ChatterClient::noteStatsChanged()
+{
+    if (!m_statsTimer->isActive()) {
+        m_statsTimer->start();
+    }
+}
 
-        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            continue;
-        }
+void ChatterClient::discardOutbound()
+{
+    m_paceTimer->stop();
+    m_outbound.clear();
+    m_inFlight = OutboundMessage();
+    m_hasInFlight = false;
 
-        break;
+    const QList<quint64> pendingBatches = m_batchTerminators.keys();
+    m_batchTerminators.clear();
+    for (const quint64 batchId : pendingBatches) {
+        emit batchFinished(batchId, false);
     }
+    noteStatsChanged();
 }
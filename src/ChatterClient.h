@@ -1,12 +1,19 @@
 #pragma once
 
+#include "OutboundScheduler.h"
+#include "Utf8Decoder.h"
+
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QStringList>
 
 #include <sys/types.h>
 
+class KeyLatencyProbe;
 class QSocketNotifier;
+class QTimer;
 
 class ChatterClient : public QObject
 {
@@ -17,37 +24,63 @@ public:
 
     void setUsername(const QString &username);
     QString username() const;
+    QString host() const;
 
     void start();
     void stop();
-    void sendCommand(const QString &command);
-    void sendRawData(const QByteArray &data);
+    void sendCommand(const QString &command, OutboundPriority priority = OutboundPriority::Line);
+    void sendRawData(const QByteArray &data, OutboundPriority priority = OutboundPriority::Interactive);
+    quint64 sendLineBatch(const QStringList &lines, const QString &terminator,
+                          OutboundPriority priority = OutboundPriority::Bulk);
+    void cancelBatch(quint64 batchId);
     void setTerminalSize(int columns, int rows);
+    void setLatencyProbe(KeyLatencyProbe *probe);
+    // False while the remote side has echo off, e.g. at a password prompt.
+    bool isEchoEnabled() const;
+
+    OutboundStats outboundStats(OutboundPriority priority) const;
 
 signals:
     void outputReceived(const QString &text);
     void errorReceived(const QString &text);
     void connectionStateChanged(bool connected);
+    void outboundStatsChanged();
+    void batchProgress(quint64 batchId, qint64 written, qint64 total);
+    void batchFinished(quint64 batchId, bool delivered);
 
 private:
     QStringList buildCommand() const;
     void handleMasterReadyRead();
     void handleChildFinished(bool emitErrorMessage = true);
     void updateConnectedState(bool connected);
-    void installReadNotifier();
-    void removeReadNotifier();
+    void installNotifiers();
+    void removeNotifiers();
     bool isRunning() const;
     void applyTerminalSize();
     QString takeDecodedOutput();
-    int utf8BoundaryLength() const;
-    void writeBytes(const QByteArray &data);
+    void enqueueOutbound(const QByteArray &data, OutboundPriority priority);
+    void flushOutbound();
+    void discardOutbound();
+    void noteStatsChanged();
+    void finishInFlight(bool delivered);
 
     int m_masterFd;
     pid_t m_childPid;
     QSocketNotifier *m_readNotifier;
+    QSocketNotifier *m_writeNotifier;
+    QTimer *m_paceTimer;
+    QTimer *m_statsTimer;
+    KeyLatencyProbe *m_latencyProbe;
+    OutboundScheduler m_outbound;
+    OutboundMessage m_inFlight;
+    qsizetype m_inFlightOffset;
+    bool m_hasInFlight;
+    quint64 m_nextBatchId;
+    QHash<quint64, QByteArray> m_batchTerminators;
+    QElapsedTimer m_clock;
     QString m_username;
     QString m_host;
-    QByteArray m_outputBuffer;
+    Utf8Decoder m_decoder;
     int m_columns;
     int m_rows;
     bool m_connected;
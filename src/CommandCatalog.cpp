@@ -1,87 +1,337 @@
 #include "CommandCatalog.h"
 
-#include <QRegularExpression>
+#include <QCoreApplication>
+
+#include <array>
+#include <iterator>
+#include <string_view>
 
 namespace {
-CommandDescriptor makeDescriptor(const QString &label,
-                                 const QString &command,
-                                 const QString &hint = QString())
+
+struct CommandSpec {
+    const char *label;
+    std::string_view command;
+    const char *hint;
+    std::string_view name;
+    bool takesArgument;
+    ArgumentSchema schema;
+};
+
+constexpr CommandSpec command(const char *label, std::string_view text, const char *hint = "",
+                              ArgumentSchema schema = ArgumentSchema())
+{
+    return CommandSpec{label, text, hint, text.substr(0, text.find(' ')),
+                       text.find("%1") != std::string_view::npos, schema};
+}
+
+constexpr ArgumentSchema text()
+{
+    return ArgumentSchema{ArgumentKind::Text, "", 0, 0, ArgumentRest::Optional};
+}
+
+constexpr ArgumentSchema choice(const char *choices, ArgumentRest rest = ArgumentRest::None)
+{
+    return ArgumentSchema{ArgumentKind::Choice, choices, 0, 0, rest};
+}
+
+constexpr ArgumentSchema integer(int minimum, int maximum)
+{
+    return ArgumentSchema{ArgumentKind::Integer, "", minimum, maximum, ArgumentRest::None};
+}
+
+constexpr ArgumentSchema date()
+{
+    return ArgumentSchema{ArgumentKind::Date, "", 0, 0, ArgumentRest::None};
+}
+
+constexpr ArgumentSchema username(ArgumentRest rest = ArgumentRest::None)
+{
+    return ArgumentSchema{ArgumentKind::Username, "", 0, 0, rest};
+}
+
+constexpr ArgumentSchema url()
+{
+    return ArgumentSchema{ArgumentKind::Url, "", 0, 0, ArgumentRest::Optional};
+}
+
+constexpr ArgumentSchema messageId(ArgumentRest rest = ArgumentRest::None)
+{
+    return ArgumentSchema{ArgumentKind::MessageId, "", 0, 0, rest};
+}
+
+constexpr CommandSpec kCommands[] = {
+    command(QT_TRANSLATE_NOOP("QObject", "Help"), "/help"),
+    command(QT_TRANSLATE_NOOP("QObject", "Exit"), "/exit"),
+    command(QT_TRANSLATE_NOOP("QObject", "Change Nickname"), "/nick %1", QT_TRANSLATE_NOOP("QObject", "nickname"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "Private Message"), "/pm %1", QT_TRANSLATE_NOOP("QObject", "username message"), username(ArgumentRest::Required)),
+    command(QT_TRANSLATE_NOOP("QObject", "Message of the Day"), "/motd"),
+    command(QT_TRANSLATE_NOOP("QObject", "Set Status"), "/status %1", QT_TRANSLATE_NOOP("QObject", "message"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Show Status"), "/showstatus %1", QT_TRANSLATE_NOOP("QObject", "username"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "List Users"), "/users"),
+    command(QT_TRANSLATE_NOOP("QObject", "Search Users"), "/search %1", QT_TRANSLATE_NOOP("QObject", "text"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Show Chat Message"), "/chat %1", QT_TRANSLATE_NOOP("QObject", "message-id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "Reply"), "/reply %1", QT_TRANSLATE_NOOP("QObject", "message-id text"), messageId(ArgumentRest::Required)),
+    command(QT_TRANSLATE_NOOP("QObject", "Share Image"), "/image %1", QT_TRANSLATE_NOOP("QObject", "url [caption]"), url()),
+    command(QT_TRANSLATE_NOOP("QObject", "Share Video"), "/video %1", QT_TRANSLATE_NOOP("QObject", "url [caption]"), url()),
+    command(QT_TRANSLATE_NOOP("QObject", "Share Audio"), "/audio %1", QT_TRANSLATE_NOOP("QObject", "url [caption]"), url()),
+    command(QT_TRANSLATE_NOOP("QObject", "Share Files"), "/files %1", QT_TRANSLATE_NOOP("QObject", "url [caption]"), url()),
+    command(QT_TRANSLATE_NOOP("QObject", "Open ASCII Art Composer"), "/asciiart"),
+    command(QT_TRANSLATE_NOOP("QObject", "Start Game"), "/game %1", QT_TRANSLATE_NOOP("QObject", "tetris|liargame"), choice("tetris|liargame")),
+    command(QT_TRANSLATE_NOOP("QObject", "Set Handle Color"), "/color %1", QT_TRANSLATE_NOOP("QObject", "text;highlight[;bold]"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Set System Palette"), "/systemcolor %1", QT_TRANSLATE_NOOP("QObject", "fg;background[;highlight][;bold]"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Set Translation Language"), "/set-trans-lang %1", QT_TRANSLATE_NOOP("QObject", "language|off"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Set Target Language"), "/set-target-lang %1", QT_TRANSLATE_NOOP("QObject", "language|off"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Toggle Translation"), "/translate %1", QT_TRANSLATE_NOOP("QObject", "on|off"), choice("on|off")),
+    command(QT_TRANSLATE_NOOP("QObject", "Translation Scope"), "/translate-scope %1", QT_TRANSLATE_NOOP("QObject", "chat|chat-nohistory|all"), choice("chat|chat-nohistory|all")),
+    command(QT_TRANSLATE_NOOP("QObject", "Toggle Gemini"), "/gemini %1", QT_TRANSLATE_NOOP("QObject", "on|off"), choice("on|off")),
+    command(QT_TRANSLATE_NOOP("QObject", "Gemini Unfreeze"), "/gemini-unfreeze"),
+    command(QT_TRANSLATE_NOOP("QObject", "Toggle Eliza"), "/eliza %1", QT_TRANSLATE_NOOP("QObject", "on|off"), choice("on|off")),
+    command(QT_TRANSLATE_NOOP("QObject", "Chat Spacing"), "/chat-spacing %1", QT_TRANSLATE_NOOP("QObject", "0-5"), integer(0, 5)),
+    command(QT_TRANSLATE_NOOP("QObject", "Apply Palette"), "/palette %1", QT_TRANSLATE_NOOP("QObject", "name"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Today's Function"), "/today"),
+    command(QT_TRANSLATE_NOOP("QObject", "Show Date"), "/date %1", QT_TRANSLATE_NOOP("QObject", "timezone"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Register OS"), "/os %1", QT_TRANSLATE_NOOP("QObject", "name"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Lookup OS"), "/getos %1", QT_TRANSLATE_NOOP("QObject", "username"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "Register Birthday"), "/birthday %1", QT_TRANSLATE_NOOP("QObject", "YYYY-MM-DD"), date()),
+    command(QT_TRANSLATE_NOOP("QObject", "Find Soulmate"), "/soulmate"),
+    command(QT_TRANSLATE_NOOP("QObject", "Find Pair"), "/pair"),
+    command(QT_TRANSLATE_NOOP("QObject", "Connected Users"), "/connected"),
+    command(QT_TRANSLATE_NOOP("QObject", "Grant Operator"), "/grant %1", QT_TRANSLATE_NOOP("QObject", "ip"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Revoke Operator"), "/revoke %1", QT_TRANSLATE_NOOP("QObject", "ip"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Start Poll"), "/poll %1", QT_TRANSLATE_NOOP("QObject", "question|options"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote"), "/vote %1", QT_TRANSLATE_NOOP("QObject", "label question|option"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Single Vote"), "/vote-single %1", QT_TRANSLATE_NOOP("QObject", "label question|option"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Elect"), "/elect %1", QT_TRANSLATE_NOOP("QObject", "label choice"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Poke User"), "/poke %1", QT_TRANSLATE_NOOP("QObject", "username"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "Kick User"), "/kick %1", QT_TRANSLATE_NOOP("QObject", "username"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "Ban User"), "/ban %1", QT_TRANSLATE_NOOP("QObject", "username"), username()),
+    command(QT_TRANSLATE_NOOP("QObject", "List Bans"), "/banlist"),
+    command(QT_TRANSLATE_NOOP("QObject", "Block"), "/block %1", QT_TRANSLATE_NOOP("QObject", "user|ip"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Unblock"), "/unblock %1", QT_TRANSLATE_NOOP("QObject", "target|all"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "Pardon"), "/pardon %1", QT_TRANSLATE_NOOP("QObject", "user|ip"), text()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Good"), "/good %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Sad"), "/sad %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Cool"), "/cool %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Angry"), "/angry %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Checked"), "/checked %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React Love"), "/love %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "React WTF"), "/wtf %1", QT_TRANSLATE_NOOP("QObject", "id"), messageId()),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote 1"), "/1"),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote 2"), "/2"),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote 3"), "/3"),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote 4"), "/4"),
+    command(QT_TRANSLATE_NOOP("QObject", "Vote 5"), "/5"),
+    command(QT_TRANSLATE_NOOP("QObject", "Bulletin Board"), "/bbs %1", QT_TRANSLATE_NOOP("QObject", "list|read|post|comment|regen|delete"), choice("list|read|post|comment|regen|delete", ArgumentRest::Optional)),
+    command(QT_TRANSLATE_NOOP("QObject", "Suspend Game"), "/suspend!")
+};
+
+constexpr int kCommandCount = static_cast<int>(std::size(kCommands));
+constexpr int kBucketCount = 32;
+constexpr int kSlotCount = 128;
+constexpr quint32 kMaxDisplacement = 4096;
+
+static_assert(kCommandCount < kSlotCount, "command table outgrew the perfect hash");
+
+constexpr quint32 mixUnit(quint32 hash, quint32 unit)
+{
+    return (hash ^ unit) * 16777619u;
+}
+
+constexpr quint32 finalizeHash(quint32 hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    return hash ^ (hash >> 16);
+}
+
+constexpr quint32 hashName(std::string_view name, quint32 seed)
+{
+    quint32 hash = 2166136261u ^ (seed * 16777619u);
+    for (const char ch : name) {
+        hash = mixUnit(hash, static_cast<unsigned char>(ch));
+    }
+    return finalizeHash(hash);
+}
+
+quint32 hashName(QStringView name, quint32 seed)
 {
-    return CommandDescriptor{label, command, hint};
+    quint32 hash = 2166136261u ^ (seed * 16777619u);
+    for (const QChar ch : name) {
+        hash = mixUnit(hash, ch.unicode());
+    }
+    return finalizeHash(hash);
 }
+
+// Hash-and-displace: keys are grouped into buckets by one hash, then each
+// bucket (largest first) searches for a seed that drops all of its keys into
+// free slots. Lookup is two hashes and one string compare.
+struct PerfectHash {
+    std::array<quint32, kBucketCount> displacement{};
+    std::array<qint8, kSlotCount> slots{};
+    bool valid = false;
+};
+
+constexpr PerfectHash buildPerfectHash()
+{
+    PerfectHash table;
+    for (int slot = 0; slot < kSlotCount; ++slot) {
+        table.slots[slot] = -1;
+    }
+
+    std::array<int, kCommandCount> bucketOf{};
+    std::array<int, kBucketCount> bucketSizes{};
+    for (int i = 0; i < kCommandCount; ++i) {
+        bucketOf[i] = static_cast<int>(hashName(kCommands[i].name, 0) % kBucketCount);
+        ++bucketSizes[bucketOf[i]];
+    }
+
+    std::array<bool, kBucketCount> placed{};
+    for (int round = 0; round < kBucketCount; ++round) {
+        int bucket = -1;
+        for (int b = 0; b < kBucketCount; ++b) {
+            if (!placed[b] && (bucket < 0 || bucketSizes[b] > bucketSizes[bucket])) {
+                bucket = b;
+            }
+        }
+        placed[bucket] = true;
+        if (bucketSizes[bucket] == 0) {
+            continue;
+        }
+
+        bool fitted = false;
+        for (quint32 seed = 1; seed < kMaxDisplacement && !fitted; ++seed) {
+            std::array<int, kCommandCount> chosen{};
+            int count = 0;
+            fitted = true;
+            for (int i = 0; i < kCommandCount && fitted; ++i) {
+                if (bucketOf[i] != bucket) {
+                    continue;
+                }
+                const int slot = static_cast<int>(hashName(kCommands[i].name, seed) % kSlotCount);
+                fitted = table.slots[slot] < 0;
+                for (int c = 0; c < count && fitted; ++c) {
+                    fitted = chosen[c] != slot;
+                }
+                chosen[count++] = slot;
+            }
+
+            if (fitted) {
+                table.displacement[bucket] = seed;
+                int c = 0;
+                for (int i = 0; i < kCommandCount; ++i) {
+                    if (bucketOf[i] == bucket) {
+                        table.slots[chosen[c++]] = static_cast<qint8>(i);
+                    }
+                }
+            }
+        }
+        if (!fitted) {
+            return table;
+        }
+    }
+
+    table.valid = true;
+    return table;
+}
+
+constexpr PerfectHash kPerfectHash = buildPerfectHash();
+static_assert(kPerfectHash.valid, "command names must be unique and hashable");
+
+bool sameName(std::string_view expected, QStringView name)
+{
+    if (static_cast<qsizetype>(expected.size()) != name.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (name.at(static_cast<qsizetype>(i)).unicode() != static_cast<unsigned char>(expected[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString translated(const char *text)
+{
+    return *text ? QCoreApplication::translate("QObject", text) : QString();
 }
 
+} // namespace
+
 QVector<CommandDescriptor> CommandCatalog::allCommands()
 {
-    return {
-        makeDescriptor(QObject::tr("Help"), QStringLiteral("/help")),
-        makeDescriptor(QObject::tr("Exit"), QStringLiteral("/exit")),
-        makeDescriptor(QObject::tr("Change Nickname"), QStringLiteral("/nick %1"), QObject::tr("nickname")),
-        makeDescriptor(QObject::tr("Private Message"), QStringLiteral("/pm %1"), QObject::tr("username message")),
-        makeDescriptor(QObject::tr("Message of the Day"), QStringLiteral("/motd")),
-        makeDescriptor(QObject::tr("Set Status"), QStringLiteral("/status %1"), QObject::tr("message")),
-        makeDescriptor(QObject::tr("Show Status"), QStringLiteral("/showstatus %1"), QObject::tr("username")),
-        makeDescriptor(QObject::tr("List Users"), QStringLiteral("/users")),
-        makeDescriptor(QObject::tr("Search Users"), QStringLiteral("/search %1"), QObject::tr("text")),
-        makeDescriptor(QObject::tr("Show Chat Message"), QStringLiteral("/chat %1"), QObject::tr("message-id")),
-        makeDescriptor(QObject::tr("Reply"), QStringLiteral("/reply %1"), QObject::tr("message-id text")),
-        makeDescriptor(QObject::tr("Share Image"), QStringLiteral("/image %1"), QObject::tr("url [caption]")),
-        makeDescriptor(QObject::tr("Share Video"), QStringLiteral("/video %1"), QObject::tr("url [caption]")),
-        makeDescriptor(QObject::tr("Share Audio"), QStringLiteral("/audio %1"), QObject::tr("url [caption]")),
-        makeDescriptor(QObject::tr("Share Files"), QStringLiteral("/files %1"), QObject::tr("url [caption]")),
-        makeDescriptor(QObject::tr("Open ASCII Art Composer"), QStringLiteral("/asciiart")),
-        makeDescriptor(QObject::tr("Start Game"), QStringLiteral("/game %1"), QObject::tr("tetris|liargame")),
-        makeDescriptor(QObject::tr("Set Handle Color"), QStringLiteral("/color %1"), QObject::tr("text;highlight[;bold]")),
-        makeDescriptor(QObject::tr("Set System Palette"), QStringLiteral("/systemcolor %1"), QObject::tr("fg;background[;highlight][;bold]")),
-        makeDescriptor(QObject::tr("Set Translation Language"), QStringLiteral("/set-trans-lang %1"), QObject::tr("language|off")),
-        makeDescriptor(QObject::tr("Set Target Language"), QStringLiteral("/set-target-lang %1"), QObject::tr("language|off")),
-        makeDescriptor(QObject::tr("Toggle Translation"), QStringLiteral("/translate %1"), QObject::tr("on|off")),
-        makeDescriptor(QObject::tr("Translation Scope"), QStringLiteral("/translate-scope %1"), QObject::tr("chat|chat-nohistory|all")),
-        makeDescriptor(QObject::tr("Toggle Gemini"), QStringLiteral("/gemini %1"), QObject::tr("on|off")),
-        makeDescriptor(QObject::tr("Gemini Unfreeze"), QStringLiteral("/gemini-unfreeze")),
-        makeDescriptor(QObject::tr("Toggle Eliza"), QStringLiteral("/eliza %1"), QObject::tr("on|off")),
-        makeDescriptor(QObject::tr("Chat Spacing"), QStringLiteral("/chat-spacing %1"), QObject::tr("0-5")),
-        makeDescriptor(QObject::tr("Apply Palette"), QStringLiteral("/palette %1"), QObject::tr("name")),
-        makeDescriptor(QObject::tr("Today's Function"), QStringLiteral("/today")),
-        makeDescriptor(QObject::tr("Show Date"), QStringLiteral("/date %1"), QObject::tr("timezone")),
-        makeDescriptor(QObject::tr("Register OS"), QStringLiteral("/os %1"), QObject::tr("name")),
-        makeDescriptor(QObject::tr("Lookup OS"), QStringLiteral("/getos %1"), QObject::tr("username")),
-        makeDescriptor(QObject::tr("Register Birthday"), QStringLiteral("/birthday %1"), QObject::tr("YYYY-MM-DD")),
-        makeDescriptor(QObject::tr("Find Soulmate"), QStringLiteral("/soulmate")),
-        makeDescriptor(QObject::tr("Find Pair"), QStringLiteral("/pair")),
-        makeDescriptor(QObject::tr("Connected Users"), QStringLiteral("/connected")),
-        makeDescriptor(QObject::tr("Grant Operator"), QStringLiteral("/grant %1"), QObject::tr("ip")),
-        makeDescriptor(QObject::tr("Revoke Operator"), QStringLiteral("/revoke %1"), QObject::tr("ip")),
-        makeDescriptor(QObject::tr("Start Poll"), QStringLiteral("/poll %1"), QObject::tr("question|options")),
-        makeDescriptor(QObject::tr("Vote"), QStringLiteral("/vote %1"), QObject::tr("label question|option")),
-        makeDescriptor(QObject::tr("Single Vote"), QStringLiteral("/vote-single %1"), QObject::tr("label question|option")),
-        makeDescriptor(QObject::tr("Elect"), QStringLiteral("/elect %1"), QObject::tr("label choice")),
-        makeDescriptor(QObject::tr("Poke User"), QStringLiteral("/poke %1"), QObject::tr("username")),
-        makeDescriptor(QObject::tr("Kick User"), QStringLiteral("/kick %1"), QObject::tr("username")),
-        makeDescriptor(QObject::tr("Ban User"), QStringLiteral("/ban %1"), QObject::tr("username")),
-        makeDescriptor(QObject::tr("List Bans"), QStringLiteral("/banlist")),
-        makeDescriptor(QObject::tr("Block"), QStringLiteral("/block %1"), QObject::tr("user|ip")),
-        makeDescriptor(QObject::tr("Unblock"), QStringLiteral("/unblock %1"), QObject::tr("target|all")),
-        makeDescriptor(QObject::tr("Pardon"), QStringLiteral("/pardon %1"), QObject::tr("user|ip")),
-        makeDescriptor(QObject::tr("React Good"), QStringLiteral("/good %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React Sad"), QStringLiteral("/sad %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React Cool"), QStringLiteral("/cool %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React Angry"), QStringLiteral("/angry %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React Checked"), QStringLiteral("/checked %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React Love"), QStringLiteral("/love %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("React WTF"), QStringLiteral("/wtf %1"), QObject::tr("id")),
-        makeDescriptor(QObject::tr("Vote 1"), QStringLiteral("/1")),
-        makeDescriptor(QObject::tr("Vote 2"), QStringLiteral("/2")),
-        makeDescriptor(QObject::tr("Vote 3"), QStringLiteral("/3")),
-        makeDescriptor(QObject::tr("Vote 4"), QStringLiteral("/4")),
-        makeDescriptor(QObject::tr("Vote 5"), QStringLiteral("/5")),
-        makeDescriptor(QObject::tr("Bulletin Board"), QStringLiteral("/bbs %1"), QObject::tr("list|read|post|comment|regen|delete")),
-        makeDescriptor(QObject::tr("Suspend Game"), QStringLiteral("/suspend!"))
-    };
+    // Built per call so descriptions follow the translator installed now.
+    QVector<CommandDescriptor> descriptors;
+    descriptors.reserve(kCommandCount);
+    for (int i = 0; i < kCommandCount; ++i) {
+        descriptors.append(descriptor(i));
+    }
+    return descriptors;
+}
+
+int CommandCatalog::commandCount()
+{
+    return kCommandCount;
+}
+
+int CommandCatalog::indexOf(QStringView name)
+{
+    const quint32 seed = kPerfectHash.displacement[hashName(name, 0) % kBucketCount];
+    if (seed == 0) {
+        return -1;
+    }
+
+    const int index = kPerfectHash.slots[hashName(name, seed) % kSlotCount];
+    if (index < 0 || !sameName(kCommands[index].name, name)) {
+        return -1;
+    }
+    return index;
+}
+
+CommandDescriptor CommandCatalog::descriptor(int index)
+{
+    if (index < 0 || index >= kCommandCount) {
+        return CommandDescriptor();
+    }
+
+    const CommandSpec &spec = kCommands[index];
+    return CommandDescriptor{translated(spec.label),
+                             QString::fromLatin1(spec.command.data(), static_cast<int>(spec.command.size())),
+                             translated(spec.hint),
+                             spec.takesArgument};
+}
+
+QLatin1String CommandCatalog::name(int index)
+{
+    if (index < 0 || index >= kCommandCount) {
+        return QLatin1String();
+    }
+    return QLatin1String(kCommands[index].name.data(), static_cast<int>(kCommands[index].name.size()));
+}
+
+QLatin1String CommandCatalog::argumentHint(int index)
+{
+    if (index < 0 || index >= kCommandCount) {
+        return QLatin1String();
+    }
+    return QLatin1String(kCommands[index].hint);
+}
+
+ArgumentSchema CommandCatalog::argumentSchema(int index)
+{
+    if (index < 0 || index >= kCommandCount) {
+        return ArgumentSchema();
+    }
+    return kCommands[index].schema;
+}
+
+bool CommandCatalog::requiresUserInput(int index)
+{
+    return index >= 0 && index < kCommandCount && kCommands[index].takesArgument;
 }
 
 bool CommandCatalog::requiresUserInput(const CommandDescriptor &descriptor)
 {
-    static const QRegularExpression placeholder(QStringLiteral("%1"));
-    return descriptor.command.contains(placeholder);
+    return descriptor.takesArgument;
 }
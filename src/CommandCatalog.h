@@ -3,18 +3,55 @@
 #include <QObject>
 #include <QVector>
 #include <QString>
+#include <QStringView>
 #include <QMetaType>
 
 struct CommandDescriptor {
     QString label;
     QString command;
     QString placeholderHint;
+    bool takesArgument = false;
 };
 
 Q_DECLARE_METATYPE(CommandDescriptor)
 
+enum class ArgumentKind {
+    None,
+    Text,
+    Choice,
+    Integer,
+    Date,
+    Username,
+    Url,
+    MessageId
+};
+
+// Whether free text may or must follow the typed leading token.
+enum class ArgumentRest {
+    None,
+    Optional,
+    Required
+};
+
+struct ArgumentSchema {
+    ArgumentKind kind = ArgumentKind::None;
+    const char *choices = "";
+    int minimum = 0;
+    int maximum = 0;
+    ArgumentRest rest = ArgumentRest::None;
+};
+
+// The catalog is a compile-time table; names resolve through a perfect hash
+// built at compile time, so lookups never allocate.
 class CommandCatalog {
 public:
     static QVector<CommandDescriptor> allCommands();
+    static int commandCount();
+    static int indexOf(QStringView name);
+    static CommandDescriptor descriptor(int index);
+    static QLatin1String name(int index);
+    static QLatin1String argumentHint(int index);
+    static ArgumentSchema argumentSchema(int index);
+    static bool requiresUserInput(int index);
     static bool requiresUserInput(const CommandDescriptor &descriptor);
 };
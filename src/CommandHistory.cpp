@@ -0,0 +1,308 @@
+#include "CommandHistory.h"
+
+#include "FuzzyMatcher.h"
+#include "ScrollbackModel.h"
+
+#include <QPointer>
+#include <QThread>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr int kMaxEntries = 100000;
+constexpr int kScanChunk = 4096;
+
+class HistoryWriter : public QObject
+{
+public:
+    bool open(const QString &directory, const QString &key)
+    {
+        if (!m_store.open(directory, key)) {
+            return false;
+        }
+        if (m_store.mappedLineCount() > kMaxEntries * 2) {
+            m_store.retainNewest(kMaxEntries);
+        }
+        return m_store.isOpen();
+    }
+
+    void append(const QString &line)
+    {
+        m_store.append(line + QLatin1Char('\n'));
+        m_store.flush();
+    }
+
+    const HistoryStore &store() const
+    {
+        return m_store;
+    }
+
+private:
+    HistoryStore m_store;
+};
+
+} // namespace
+
+CommandHistory::CommandHistory(QObject *parent)
+    : QObject(parent)
+    , m_persistence(Persistence::All)
+    , m_deadEntries(0)
+    , m_generation(0)
+    , m_writerThread(new QThread(this))
+    , m_writer(new HistoryWriter)
+{
+    m_writer->moveToThread(m_writerThread);
+    connect(m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_writerThread->start(QThread::LowPriority);
+}
+
+CommandHistory::~CommandHistory()
+{
+    m_writerThread->quit();
+    m_writerThread->wait();
+}
+
+void CommandHistory::open(const QString &directory, const QString &key)
+{
+    // Stored entries point into the mapping that is about to be dropped;
+    // only lines typed this session survive until the reload lands.
+    const QStringList added = (m_key.isEmpty() || m_key == key) ? sessionLines() : QStringList();
+    m_reader.close();
+    m_entries.clear();
+    m_positions.clear();
+    m_deadEntries = 0;
+    for (const QString &line : added) {
+        appendEntry(line);
+    }
+    m_key = key;
+
+    const int generation = ++m_generation;
+    auto *writer = static_cast<HistoryWriter *>(m_writer);
+    QPointer<CommandHistory> self(this);
+    QMetaObject::invokeMethod(writer, [writer, self, directory, key, generation]() {
+        const QVector<Entry> stored = writer->open(directory, key) ? scanStored(writer->store()) : QVector<Entry>();
+        QMetaObject::invokeMethod(self.data(), [self, directory, key, generation, stored]() {
+            if (self && self->m_generation == generation) {
+                self->mergeLoaded(directory, key, stored);
+            }
+        });
+    });
+}
+
+void CommandHistory::setPersistence(Persistence persistence)
+{
+    m_persistence = persistence;
+}
+
+void CommandHistory::add(const QString &line)
+{
+    if (line.trimmed().isEmpty()) {
+        return;
+    }
+
+    appendEntry(line);
+    if (m_deadEntries > static_cast<int>(m_entries.size()) / 2) {
+        compact();
+    }
+
+    if (m_persistence == Persistence::Off
+        || (m_persistence == Persistence::CommandsOnly && !line.startsWith(QLatin1Char('/')))) {
+        return;
+    }
+
+    auto *writer = static_cast<HistoryWriter *>(m_writer);
+    QMetaObject::invokeMethod(writer, [writer, line]() {
+        writer->append(line);
+    });
+}
+
+int CommandHistory::end() const
+{
+    return static_cast<int>(m_entries.size());
+}
+
+int CommandHistory::previous(int position) const
+{
+    for (int i = std::min(position, end()) - 1; i >= 0; --i) {
+        if (m_entries.at(i).live) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int CommandHistory::next(int position) const
+{
+    for (int i = position + 1; i < end(); ++i) {
+        if (m_entries.at(i).live) {
+            return i;
+        }
+    }
+    return end();
+}
+
+QString CommandHistory::at(int position) const
+{
+    if (position < 0 || position >= end()) {
+        return QString();
+    }
+    return textOf(m_entries.at(position));
+}
+
+int CommandHistory::searchBackward(const QString &query, int before) const
+{
+    const QString folded = ScrollbackModel::foldCase(query);
+    const quint64 mask = FuzzyMatcher::charMask(folded);
+    for (int i = std::min(before, end()) - 1; i >= 0; --i) {
+        const Entry &entry = m_entries.at(i);
+        if (entry.live && FuzzyMatcher::mayMatch(mask, entry.mask)
+            && ScrollbackModel::foldCase(textOf(entry)).contains(folded)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QStringList CommandHistory::recent(int limit, const QString &prefix) const
+{
+    QStringList lines;
+    for (int i = end() - 1; i >= 0 && lines.size() < limit; --i) {
+        const Entry &entry = m_entries.at(i);
+        if (!entry.live) {
+            continue;
+        }
+        const QString text = textOf(entry);
+        if (text.startsWith(prefix)) {
+            lines.append(text);
+        }
+    }
+    return lines;
+}
+
+// Runs on the writer thread. Walks the newest stored lines a chunk at a time
+// and keeps the newest copy of each; only line numbers, hashes and masks are
+// returned, never the text.
+QVector<CommandHistory::Entry> CommandHistory::scanStored(const HistoryStore &store)
+{
+    const int total = store.mappedLineCount();
+    const int first = std::max(0, total - kMaxEntries);
+
+    QVector<Entry> newestFirst;
+    QMultiHash<uint, int> seen;
+    for (int chunkEnd = total; chunkEnd > first; chunkEnd -= kScanChunk) {
+        const int chunkStart = std::max(first, chunkEnd - kScanChunk);
+        const QStringList lines = store.readLines(chunkStart, chunkEnd - chunkStart);
+        for (int i = static_cast<int>(lines.size()) - 1; i >= 0; --i) {
+            const QString &text = lines.at(i);
+            const uint hash = static_cast<uint>(qHash(text));
+            bool duplicate = false;
+            for (auto it = seen.constFind(hash); it != seen.constEnd() && it.key() == hash; ++it) {
+                if (store.readLines(newestFirst.at(it.value()).line, 1).value(0) == text) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) {
+                continue;
+            }
+
+            Entry entry;
+            entry.line = chunkStart + i;
+            entry.hash = hash;
+            entry.mask = FuzzyMatcher::charMask(ScrollbackModel::foldCase(text));
+            seen.insert(hash, static_cast<int>(newestFirst.size()));
+            newestFirst.append(entry);
+        }
+    }
+
+    std::reverse(newestFirst.begin(), newestFirst.end());
+    return newestFirst;
+}
+
+QString CommandHistory::textOf(const Entry &entry) const
+{
+    return entry.line < 0 ? entry.text : m_reader.readLines(entry.line, 1).value(0);
+}
+
+int CommandHistory::find(const QString &line, uint hash) const
+{
+    for (auto it = m_positions.constFind(hash); it != m_positions.constEnd() && it.key() == hash; ++it) {
+        if (textOf(m_entries.at(it.value())) == line) {
+            return it.value();
+        }
+    }
+    return -1;
+}
+
+QStringList CommandHistory::sessionLines() const
+{
+    QStringList lines;
+    for (const Entry &entry : m_entries) {
+        if (entry.live && entry.line < 0) {
+            lines.append(entry.text);
+        }
+    }
+    return lines;
+}
+
+void CommandHistory::appendEntry(const QString &line)
+{
+    const uint hash = static_cast<uint>(qHash(line));
+    const int existing = find(line, hash);
+    if (existing >= 0) {
+        m_entries[existing].live = false;
+        m_positions.remove(hash, existing);
+        ++m_deadEntries;
+    }
+
+    Entry entry;
+    entry.text = line;
+    entry.hash = hash;
+    entry.mask = FuzzyMatcher::charMask(ScrollbackModel::foldCase(line));
+    m_positions.insert(hash, end());
+    m_entries.append(entry);
+
+    if (end() - m_deadEntries > kMaxEntries) {
+        const int oldest = next(-1);
+        m_entries[oldest].live = false;
+        m_positions.remove(m_entries.at(oldest).hash, oldest);
+        ++m_deadEntries;
+    }
+}
+
+void CommandHistory::mergeLoaded(const QString &directory, const QString &key, const QVector<Entry> &stored)
+{
+    const QStringList added = sessionLines();
+    m_entries.clear();
+    m_positions.clear();
+    m_deadEntries = 0;
+
+    if (!stored.isEmpty() && m_reader.openReadOnly(directory, key)) {
+        for (const Entry &entry : stored) {
+            m_positions.insert(entry.hash, end());
+            m_entries.append(entry);
+        }
+    }
+    for (const QString &line : added) {
+        appendEntry(line);
+    }
+    compact();
+    emit loaded();
+}
+
+void CommandHistory::compact()
+{
+    QVector<Entry> live;
+    live.reserve(end() - m_deadEntries);
+    m_positions.clear();
+    for (const Entry &entry : std::as_const(m_entries)) {
+        if (entry.live) {
+            m_positions.insert(entry.hash, static_cast<int>(live.size()));
+            live.append(entry);
+        }
+    }
+    m_entries.swap(live);
+    m_deadEntries = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "HistoryStore.h"
+
+#include <QMultiHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QThread;
+
+// Deduplicated entry-line history. The newest copy of a line wins; older
+// copies become tombstones until the next compaction. Lines loaded from the
+// backing file stay in HistoryStore's mapping and are read only when recall or
+// search reaches them; the file is written on a worker thread.
+class CommandHistory : public QObject
+{
+    Q_OBJECT
+public:
+    // Which added lines are written to the backing file; the session keeps all of them.
+    enum class Persistence {
+        All,
+        CommandsOnly,
+        Off
+    };
+
+    explicit CommandHistory(QObject *parent = nullptr);
+    ~CommandHistory() override;
+
+    void open(const QString &directory, const QString &key);
+    void setPersistence(Persistence persistence);
+    void add(const QString &line);
+
+    int end() const;
+    int previous(int position) const;
+    int next(int position) const;
+    QString at(int position) const;
+    int searchBackward(const QString &query, int before) const;
+    QStringList recent(int limit, const QString &prefix = QString()) const;
+
+signals:
+    void loaded();
+
+private:
+    struct Entry {
+        int line = -1;
+        QString text;
+        quint64 mask = 0;
+        uint hash = 0;
+        bool live = true;
+    };
+
+    static QVector<Entry> scanStored(const HistoryStore &store);
+    QString textOf(const Entry &entry) const;
+    int find(const QString &line, uint hash) const;
+    QStringList sessionLines() const;
+    void appendEntry(const QString &line);
+    void mergeLoaded(const QString &directory, const QString &key, const QVector<Entry> &stored);
+    void compact();
+
+    QVector<Entry> m_entries;
+    QMultiHash<uint, int> m_positions;
+    HistoryStore m_reader;
+    QString m_key;
+    Persistence m_persistence;
+    int m_deadEntries;
+    int m_generation;
+    QThread *m_writerThread;
+    QObject *m_writer;
+};
@@ -0,0 +1,133 @@
+#include "CommandPalette.h"
+
+#include "FuzzyMatcher.h"
+
+#include <QEvent>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QStringList>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kMaxVisibleEntries = 50;
+
+struct ScoredEntry {
+    int index;
+    int score;
+};
+
+} // namespace
+
+CommandPalette::CommandPalette(QWidget *parent)
+    : QDialog(parent)
+    , m_query(new QLineEdit(this))
+    , m_list(new QListWidget(this))
+{
+    setWindowTitle(tr("Command Palette"));
+    setModal(true);
+    resize(520, 360);
+
+    m_query->setPlaceholderText(tr("Type a command"));
+    m_query->installEventFilter(this);
+    m_list->setUniformItemSizes(true);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->addWidget(m_query);
+    layout->addWidget(m_list);
+
+    connect(m_query, &QLineEdit::textChanged, this, &CommandPalette::updateMatches);
+    connect(m_query, &QLineEdit::returnPressed, this, [this]() {
+        if (selectedEntry() >= 0) {
+            accept();
+        }
+    });
+    connect(m_list, &QListWidget::itemActivated, this, [this]() { accept(); });
+}
+
+void CommandPalette::setEntries(const QVector<PaletteEntry> &entries)
+{
+    m_entries = entries;
+    m_candidates.clear();
+    m_candidates.reserve(entries.size());
+    for (const PaletteEntry &entry : entries) {
+        Candidate candidate;
+        candidate.haystack = (entry.title + QLatin1Char(' ') + entry.detail).toCaseFolded();
+        candidate.mask = FuzzyMatcher::charMask(candidate.haystack);
+        m_candidates.append(candidate);
+    }
+    updateMatches(m_query->text());
+}
+
+int CommandPalette::selectedEntry() const
+{
+    const int row = m_list->currentRow();
+    return (row >= 0 && row < m_visible.size()) ? m_visible.at(row) : -1;
+}
+
+bool CommandPalette::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_query && event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent *>(event)->key();
+        const int count = m_list->count();
+        if ((key == Qt::Key_Down || key == Qt::Key_Up) && count > 0) {
+            const int step = key == Qt::Key_Down ? 1 : -1;
+            m_list->setCurrentRow((m_list->currentRow() + step + count) % count);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+void CommandPalette::updateMatches(const QString &query)
+{
+    const QStringList terms = query.toCaseFolded().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    QVector<quint64> termMasks;
+    termMasks.reserve(terms.size());
+    for (const QString &term : terms) {
+        termMasks.append(FuzzyMatcher::charMask(term));
+    }
+
+    QVector<ScoredEntry> scored;
+    for (int i = 0; i < m_candidates.size(); ++i) {
+        const Candidate &candidate = m_candidates.at(i);
+        int total = 0;
+        for (int t = 0; t < terms.size() && total >= 0; ++t) {
+            if (!FuzzyMatcher::mayMatch(termMasks.at(t), candidate.mask)) {
+                total = -1;
+                break;
+            }
+            const int termScore = FuzzyMatcher::score(terms.at(t), candidate.haystack);
+            total = termScore < 0 ? -1 : total + termScore;
+        }
+        if (total >= 0) {
+            scored.append(ScoredEntry{i, total});
+        }
+    }
+
+    std::stable_sort(scored.begin(), scored.end(), [](const ScoredEntry &lhs, const ScoredEntry &rhs) {
+        return lhs.score > rhs.score;
+    });
+    if (scored.size() > kMaxVisibleEntries) {
+        scored.resize(kMaxVisibleEntries);
+    }
+
+    m_list->setUpdatesEnabled(false);
+    m_list->clear();
+    m_visible.clear();
+    for (const ScoredEntry &entry : scored) {
+        const PaletteEntry &paletteEntry = m_entries.at(entry.index);
+        m_list->addItem(paletteEntry.detail.isEmpty()
+                            ? paletteEntry.title
+                            : QStringLiteral("%1    %2").arg(paletteEntry.title, paletteEntry.detail));
+        m_visible.append(entry.index);
+    }
+    if (m_list->count() > 0) {
+        m_list->setCurrentRow(0);
+    }
+    m_list->setUpdatesEnabled(true);
+}
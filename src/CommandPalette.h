@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QDialog>
+#include <QString>
+#include <QVector>
+
+class QLineEdit;
+class QListWidget;
+
+struct PaletteEntry {
+    QString title;
+    QString detail;
+};
+
+// Ctrl+K launcher: fuzzy-filters a fixed list of entries as the user types and
+// reports which one was picked.
+class CommandPalette : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit CommandPalette(QWidget *parent = nullptr);
+
+    void setEntries(const QVector<PaletteEntry> &entries);
+    int selectedEntry() const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Candidate {
+        QString haystack;
+        quint64 mask = 0;
+    };
+
+    void updateMatches(const QString &query);
+
+    QLineEdit *m_query;
+    QListWidget *m_list;
+    QVector<PaletteEntry> m_entries;
+    QVector<Candidate> m_candidates;
+    QVector<int> m_visible;
+};
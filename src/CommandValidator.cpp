@@ -0,0 +1,140 @@
+#include "CommandValidator.h"
+
+#include <QCoreApplication>
+#include <QDate>
+#include <QStringList>
+#include <QStringView>
+#include <QUrl>
+
+namespace {
+
+constexpr int kMaxUsernameLength = 32;
+
+bool isUsername(QStringView token)
+{
+    if (token.startsWith(QLatin1Char('@'))) {
+        token = token.mid(1);
+    }
+    if (token.isEmpty() || token.size() > kMaxUsernameLength) {
+        return false;
+    }
+
+    bool allDigits = true;
+    for (const QChar ch : token) {
+        if (ch.isSpace() || ch.category() == QChar::Other_Control
+            || ch == QLatin1Char('<') || ch == QLatin1Char('>')
+            || ch == QLatin1Char(':') || ch == QLatin1Char(',')) {
+            return false;
+        }
+        allDigits = allDigits && ch.isDigit();
+    }
+    return !allDigits;
+}
+
+bool isMessageId(QStringView token)
+{
+    if (token.startsWith(QLatin1Char('#'))) {
+        token = token.mid(1);
+    }
+    if (token.isEmpty()) {
+        return false;
+    }
+    for (const QChar ch : token) {
+        if (!ch.isDigit()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isWebUrl(const QString &token)
+{
+    const QUrl url(token, QUrl::StrictMode);
+    const QString scheme = url.scheme().toLower();
+    return url.isValid() && !url.host().isEmpty()
+        && (scheme == QLatin1String("http") || scheme == QLatin1String("https"));
+}
+
+} // namespace
+
+QString CommandValidator::validate(const QString &line)
+{
+    const QString trimmed = line.trimmed();
+    if (!trimmed.startsWith(QLatin1Char('/'))) {
+        return QString();
+    }
+
+    const int space = trimmed.indexOf(QLatin1Char(' '));
+    const int index = CommandCatalog::indexOf(QStringView(trimmed).left(space < 0 ? trimmed.size() : space));
+    if (index < 0 || !CommandCatalog::requiresUserInput(index)) {
+        return QString();
+    }
+
+    return validateArgument(index, space < 0 ? QString() : trimmed.mid(space + 1).trimmed());
+}
+
+QString CommandValidator::validateArgument(int index, const QString &argument)
+{
+    const ArgumentSchema schema = CommandCatalog::argumentSchema(index);
+    if (schema.kind == ArgumentKind::None || schema.kind == ArgumentKind::Text) {
+        return QString();
+    }
+
+    const QString hint = QCoreApplication::translate("QObject", CommandCatalog::argumentHint(index).data());
+    const QString trimmed = argument.trimmed();
+    if (trimmed.isEmpty()) {
+        return QObject::tr("%1 expects %2").arg(CommandCatalog::name(index), hint);
+    }
+
+    const int space = trimmed.indexOf(QLatin1Char(' '));
+    const QString token = space < 0 ? trimmed : trimmed.left(space);
+
+    switch (schema.kind) {
+    case ArgumentKind::Choice: {
+        const QStringList choices = QString::fromLatin1(schema.choices).split(QLatin1Char('|'));
+        if (!choices.contains(token, Qt::CaseInsensitive)) {
+            return QObject::tr("%1 must be one of: %2").arg(token, choices.join(QStringLiteral(", ")));
+        }
+        break;
+    }
+    case ArgumentKind::Integer: {
+        bool ok = false;
+        const int value = token.toInt(&ok);
+        if (!ok || value < schema.minimum || value > schema.maximum) {
+            return QObject::tr("Expected a number from %1 to %2").arg(schema.minimum).arg(schema.maximum);
+        }
+        break;
+    }
+    case ArgumentKind::Date:
+        if (!QDate::fromString(token, QStringLiteral("yyyy-MM-dd")).isValid()) {
+            return QObject::tr("Expected a date as YYYY-MM-DD");
+        }
+        break;
+    case ArgumentKind::Username:
+        if (!isUsername(token)) {
+            return QObject::tr("%1 is not a valid username").arg(token);
+        }
+        break;
+    case ArgumentKind::Url:
+        if (!isWebUrl(token)) {
+            return QObject::tr("Expected an http or https URL");
+        }
+        break;
+    case ArgumentKind::MessageId:
+        if (!isMessageId(token)) {
+            return QObject::tr("Expected a numeric message id");
+        }
+        break;
+    case ArgumentKind::None:
+    case ArgumentKind::Text:
+        break;
+    }
+
+    if (schema.rest == ArgumentRest::None && space >= 0) {
+        return QObject::tr("Unexpected text after %1").arg(token);
+    }
+    if (schema.rest == ArgumentRest::Required && space < 0) {
+        return QObject::tr("%1 expects %2").arg(CommandCatalog::name(index), hint);
+    }
+    return QString();
+}
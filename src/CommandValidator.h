@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CommandCatalog.h"
+
+#include <QString>
+
+// Checks slash commands against the argument schemas in the catalog. Returns an
+// empty string when the input may be sent, otherwise a message for the user.
+// Plain chat and commands the catalog does not know are passed through.
+class CommandValidator
+{
+public:
+    static QString validate(const QString &line);
+    static QString validateArgument(int index, const QString &argument);
+};
@@ -0,0 +1,103 @@
+#include "CompletionTrie.h"
+
+#include <algorithm>
+
+CompletionTrie::CompletionTrie()
+{
+    clear();
+}
+
+bool CompletionTrie::insert(const QString &word)
+{
+    const QString folded = word.toCaseFolded();
+    if (folded.isEmpty()) {
+        return false;
+    }
+
+    int node = 0;
+    for (const QChar ch : folded) {
+        const ushort unit = ch.unicode();
+        int next = findEdge(node, unit);
+        if (next < 0) {
+            next = static_cast<int>(m_nodes.size());
+            m_nodes.append(Node());
+
+            QVector<Edge> &edges = m_nodes[node].edges;
+            const auto it = std::lower_bound(edges.begin(), edges.end(), unit, [](const Edge &edge, ushort value) {
+                return edge.unit < value;
+            });
+            edges.insert(it, Edge{unit, next});
+        }
+        node = next;
+    }
+
+    if (m_nodes.at(node).word >= 0) {
+        return false;
+    }
+    m_nodes[node].word = static_cast<int>(m_words.size());
+    m_words.append(word);
+    return true;
+}
+
+bool CompletionTrie::contains(const QString &word) const
+{
+    const int node = findNode(word.toCaseFolded());
+    return node >= 0 && m_nodes.at(node).word >= 0;
+}
+
+QStringList CompletionTrie::complete(const QString &prefix, int limit) const
+{
+    QStringList out;
+    const int node = findNode(prefix.toCaseFolded());
+    if (node >= 0 && limit > 0) {
+        collect(node, limit, out);
+    }
+    return out;
+}
+
+int CompletionTrie::size() const
+{
+    return static_cast<int>(m_words.size());
+}
+
+void CompletionTrie::clear()
+{
+    m_nodes.clear();
+    m_nodes.append(Node());
+    m_words.clear();
+}
+
+int CompletionTrie::findEdge(int node, ushort unit) const
+{
+    const QVector<Edge> &edges = m_nodes.at(node).edges;
+    const auto it = std::lower_bound(edges.cbegin(), edges.cend(), unit, [](const Edge &edge, ushort value) {
+        return edge.unit < value;
+    });
+    return (it != edges.cend() && it->unit == unit) ? it->target : -1;
+}
+
+int CompletionTrie::findNode(const QString &folded) const
+{
+    int node = 0;
+    for (const QChar ch : folded) {
+        node = findEdge(node, ch.unicode());
+        if (node < 0) {
+            return -1;
+        }
+    }
+    return node;
+}
+
+void CompletionTrie::collect(int node, int limit, QStringList &out) const
+{
+    const Node &current = m_nodes.at(node);
+    if (current.word >= 0) {
+        out.append(m_words.at(current.word));
+    }
+    for (const Edge &edge : current.edges) {
+        if (out.size() >= limit) {
+            return;
+        }
+        collect(edge.target, limit, out);
+    }
+}
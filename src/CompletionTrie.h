@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Case-insensitive prefix tree. Edges are sorted per node, so a lookup walks
+// the prefix once and then visits only the matching subtree.
+class CompletionTrie
+{
+public:
+    CompletionTrie();
+
+    bool insert(const QString &word);
+    bool contains(const QString &word) const;
+    QStringList complete(const QString &prefix, int limit) const;
+    int size() const;
+    void clear();
+
+private:
+    struct Edge {
+        ushort unit;
+        int target;
+    };
+
+    struct Node {
+        QVector<Edge> edges;
+        int word = -1;
+    };
+
+    int findEdge(int node, ushort unit) const;
+    int findNode(const QString &folded) const;
+    void collect(int node, int limit, QStringList &out) const;
+
+    QVector<Node> m_nodes;
+    QStringList m_words;
+};
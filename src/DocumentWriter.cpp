@@ -0,0 +1,134 @@
+#include "DocumentWriter.h"
+
+#include "ScrollbackModel.h"
+
+#include <QApplication>
+#include <QBrush>
+#include <QPalette>
+#include <QRegularExpression>
+#include <QTextBlockFormat>
+#include <QTextCursor>
+
+#include <algorithm>
+
+namespace {
+
+// Inserts text that starts at `offset` in overlay coordinates, splitting it
+// wherever an overlay begins or ends.
+void insertOverlaid(QTextCursor &cursor, const QString &text, const QTextCharFormat &format,
+                    const DocumentWriter::Overlays &overlays, int offset)
+{
+    auto overlay = std::upper_bound(overlays.cbegin(), overlays.cend(), offset,
+                                    [](int value, const QTextLayout::FormatRange &range) {
+                                        return value < range.start + range.length;
+                                    });
+    const int end = offset + static_cast<int>(text.size());
+    if (overlay == overlays.cend() || overlay->start >= end) {
+        cursor.insertText(text, format);
+        return;
+    }
+
+    int position = 0;
+    for (; overlay != overlays.cend() && overlay->start < end; ++overlay) {
+        const int rangeStart = std::max(overlay->start - offset, position);
+        if (rangeStart > position) {
+            cursor.insertText(text.mid(position, rangeStart - position), format);
+        }
+        const int rangeEnd = std::min(overlay->start + overlay->length, end) - offset;
+        QTextCharFormat merged = format;
+        merged.merge(overlay->format);
+        cursor.insertText(text.mid(rangeStart, rangeEnd - rangeStart), merged);
+        position = rangeEnd;
+    }
+    if (position < text.size()) {
+        cursor.insertText(text.mid(position), format);
+    }
+}
+
+} // namespace
+
+void DocumentWriter::appendFragments(QTextCursor &cursor, const QVector<FormattedFragment> &fragments,
+                                     ScrollbackModel *scrollback, const Overlays &overlays)
+{
+    QTextBlockFormat blockFormat;
+    blockFormat.setTopMargin(0);
+    blockFormat.setBottomMargin(0);
+    blockFormat.setLineHeight(100, QTextBlockFormat::ProportionalHeight);
+
+    auto applyBlockFormat = [&]() {
+        cursor.setBlockFormat(blockFormat);
+    };
+
+    applyBlockFormat();
+
+    int fragmentOffset = 0;
+    for (const auto &fragment : fragments) {
+        const QString &fragmentText = fragment.text;
+        int position = 0;
+
+        while (position <= fragmentText.size()) {
+            const int newlineIndex = fragmentText.indexOf(QLatin1Char('\n'), position);
+            const bool hasNewline = newlineIndex != -1;
+            const int chunkEnd = hasNewline ? newlineIndex : fragmentText.size();
+
+            if (chunkEnd > position) {
+                const QString chunk = fragmentText.mid(position, chunkEnd - position);
+                applyBlockFormat();
+                insertFragmentWithLinks(cursor, chunk, fragment.format, overlays, fragmentOffset + position);
+                if (scrollback) {
+                    scrollback->appendText(chunk);
+                }
+            }
+
+            if (hasNewline) {
+                cursor.insertBlock();
+                if (scrollback) {
+                    scrollback->breakLine();
+                }
+                applyBlockFormat();
+                position = newlineIndex + 1;
+                continue;
+            }
+
+            break;
+        }
+        fragmentOffset += static_cast<int>(fragmentText.size());
+    }
+}
+
+void DocumentWriter::insertFragmentWithLinks(QTextCursor &cursor,
+                                             const QString &text,
+                                             const QTextCharFormat &format,
+                                             const Overlays &overlays,
+                                             int offset)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    static const QRegularExpression urlRegex(
+        QStringLiteral(R"((https?://[^\s<>"]+))"));
+
+    int lastIndex = 0;
+    auto it = urlRegex.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const int start = match.capturedStart();
+        if (start > lastIndex) {
+            insertOverlaid(cursor, text.mid(lastIndex, start - lastIndex), format, overlays, offset + lastIndex);
+        }
+
+        const QString url = match.captured();
+        QTextCharFormat linkFormat = format;
+        linkFormat.setAnchor(true);
+        linkFormat.setAnchorHref(url);
+        linkFormat.setFontUnderline(true);
+        linkFormat.setForeground(QBrush(qApp->palette().color(QPalette::Link)));
+        insertOverlaid(cursor, url, linkFormat, overlays, offset + start);
+        lastIndex = match.capturedEnd();
+    }
+
+    if (lastIndex < text.size()) {
+        insertOverlaid(cursor, text.mid(lastIndex), format, overlays, offset + lastIndex);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "AnsiText.h"
+
+#include <QString>
+#include <QTextCharFormat>
+#include <QTextLayout>
+#include <QVector>
+
+class QTextCursor;
+class ScrollbackModel;
+
+// Writes parsed terminal output into the display document: one block per
+// line, URLs turned into anchors, and the plain text mirrored into the
+// scrollback model when one is given. Overlays are sorted, disjoint ranges
+// over the concatenated fragment text whose formats are merged on insert.
+class DocumentWriter
+{
+public:
+    using Overlays = QVector<QTextLayout::FormatRange>;
+
+    static void appendFragments(QTextCursor &cursor, const QVector<FormattedFragment> &fragments,
+                                ScrollbackModel *scrollback, const Overlays &overlays = Overlays());
+    static void insertFragmentWithLinks(QTextCursor &cursor, const QString &text, const QTextCharFormat &format,
+                                        const Overlays &overlays = Overlays(), int offset = 0);
+};
@@ -0,0 +1,118 @@
+#include "EchoPredictor.h"
+
+namespace {
+constexpr int kTrustStreak = 3;
+constexpr qint64 kDisplayLatencyMs = 20;
+constexpr qint64 kPredictionTimeoutMs = 1500;
+constexpr int kMaxPending = 64;
+} // namespace
+
+void EchoPredictor::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled) {
+        abandon();
+    }
+}
+
+bool EchoPredictor::isEnabled() const
+{
+    return m_enabled;
+}
+
+void EchoPredictor::predict(QChar ch, qint64 nowMs)
+{
+    if (!m_enabled) {
+        return;
+    }
+    expire(nowMs);
+    if (m_pending.size() >= kMaxPending) {
+        mispredict();
+    }
+    m_pending.append({ch, nowMs});
+    ++m_stats.predicted;
+}
+
+void EchoPredictor::abandon()
+{
+    // Keys we cannot model (cursor keys, editing, control bytes) make the
+    // outstanding echo unpredictable without saying anything about accuracy.
+    m_stats.abandoned += m_pending.size();
+    m_pending.clear();
+}
+
+bool EchoPredictor::reconcile(const QString &plainOutput, qint64 nowMs)
+{
+    if (m_pending.isEmpty()) {
+        return false;
+    }
+
+    int confirmed = 0;
+    bool mismatch = false;
+    for (const QChar ch : plainOutput) {
+        if (confirmed == m_pending.size()) {
+            break;
+        }
+        if (ch != m_pending.at(confirmed).ch) {
+            mismatch = true;
+            break;
+        }
+        const qint64 sample = nowMs - m_pending.at(confirmed).predictedAt;
+        m_stats.smoothedLatencyMs = m_stats.smoothedLatencyMs == 0
+            ? sample
+            : (m_stats.smoothedLatencyMs * 7 + sample) / 8;
+        ++confirmed;
+    }
+
+    if (confirmed > 0) {
+        m_pending.remove(0, confirmed);
+        m_stats.confirmed += confirmed;
+        m_confirmedStreak += confirmed;
+    }
+    if (mismatch) {
+        mispredict();
+    } else {
+        expire(nowMs);
+    }
+    return confirmed > 0 || mismatch;
+}
+
+void EchoPredictor::expire(qint64 nowMs)
+{
+    if (!m_pending.isEmpty() && nowMs - m_pending.first().predictedAt > kPredictionTimeoutMs) {
+        mispredict();
+    }
+}
+
+QString EchoPredictor::pendingText() const
+{
+    QString text;
+    text.reserve(m_pending.size());
+    for (const Prediction &prediction : m_pending) {
+        text.append(prediction.ch);
+    }
+    return text;
+}
+
+bool EchoPredictor::hasPending() const
+{
+    return !m_pending.isEmpty();
+}
+
+bool EchoPredictor::shouldDisplay() const
+{
+    return m_enabled && m_confirmedStreak >= kTrustStreak
+        && m_stats.smoothedLatencyMs >= kDisplayLatencyMs;
+}
+
+EchoPredictionStats EchoPredictor::stats() const
+{
+    return m_stats;
+}
+
+void EchoPredictor::mispredict()
+{
+    m_stats.mispredicted += m_pending.size();
+    m_pending.clear();
+    m_confirmedStreak = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+struct EchoPredictionStats {
+    quint64 predicted = 0;
+    quint64 confirmed = 0;
+    quint64 mispredicted = 0;
+    quint64 abandoned = 0;
+    qint64 smoothedLatencyMs = 0;
+};
+
+// Speculative local echo for raw mode. Printable keys are predicted in order
+// and confirmed by the echoed output; the first mismatch drops every pending
+// prediction. Predictions are only worth showing once the session has been
+// echoing reliably and the round trip is long enough to notice.
+class EchoPredictor
+{
+public:
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    void predict(QChar ch, qint64 nowMs);
+    void abandon();
+    bool reconcile(const QString &plainOutput, qint64 nowMs);
+    void expire(qint64 nowMs);
+
+    QString pendingText() const;
+    bool hasPending() const;
+    bool shouldDisplay() const;
+
+    EchoPredictionStats stats() const;
+
+private:
+    struct Prediction {
+        QChar ch;
+        qint64 predictedAt = 0;
+    };
+
+    void mispredict();
+
+    QVector<Prediction> m_pending;
+    EchoPredictionStats m_stats;
+    int m_confirmedStreak = 0;
+    bool m_enabled = true;
+};
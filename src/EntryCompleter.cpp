@@ -0,0 +1,121 @@
+#include "EntryCompleter.h"
+
+#include "ChatLineParser.h"
+#include "CommandCatalog.h"
+
+#include <QLineEdit>
+#include <QRegularExpression>
+
+namespace {
+
+constexpr int kMaxCandidates = 64;
+constexpr int kMaxUsernameLength = 32;
+
+bool isUsername(const QString &word)
+{
+    static const QRegularExpression pattern(QStringLiteral("^[\\w.\\-]+$"));
+    return !word.isEmpty() && word.size() <= kMaxUsernameLength && pattern.match(word).hasMatch();
+}
+
+} // namespace
+
+EntryCompleter::EntryCompleter()
+    : m_stemStart(0)
+    , m_current(-1)
+{
+    for (int i = 0; i < CommandCatalog::commandCount(); ++i) {
+        m_commands.insert(CommandCatalog::name(i));
+    }
+}
+
+void EntryCompleter::harvestLine(const QString &plainLine)
+{
+    ChatLine chat;
+    if (ChatLineParser::parse(plainLine, &chat)) {
+        addUser(chat.handle);
+        return;
+    }
+
+    const QString trimmed = plainLine.trimmed();
+    const int colon = trimmed.indexOf(QLatin1Char(':'));
+    static const QRegularExpression listing(QStringLiteral("^(?:connected|online|users)\\b"),
+                                            QRegularExpression::CaseInsensitiveOption);
+    if (colon > 0 && listing.match(trimmed).hasMatch()) {
+        static const QRegularExpression separators(QStringLiteral("[,\\s]+"));
+        const QStringList names = trimmed.mid(colon + 1).split(separators, Qt::SkipEmptyParts);
+        for (const QString &name : names) {
+            addUser(name);
+        }
+        return;
+    }
+
+    static const QRegularExpression notice(QStringLiteral("^\\*?\\s*([\\w.\\-]+) (?:has )?(?:joined|entered|connected)"),
+                                           QRegularExpression::CaseInsensitiveOption);
+    const QRegularExpressionMatch match = notice.match(trimmed);
+    if (match.hasMatch()) {
+        addUser(match.captured(1));
+    }
+}
+
+void EntryCompleter::addUser(const QString &name)
+{
+    if (isUsername(name)) {
+        m_users.insert(name);
+    }
+}
+
+int EntryCompleter::userCount() const
+{
+    return m_users.size();
+}
+
+bool EntryCompleter::complete(QLineEdit *entry, bool backwards)
+{
+    if (!entry) {
+        return false;
+    }
+
+    const QString text = entry->text();
+    if (m_current < 0 || text != m_completedText) {
+        const int cursor = entry->cursorPosition();
+        const int wordStart = text.lastIndexOf(QLatin1Char(' '), cursor - 1) + 1;
+        QString stem = text.mid(wordStart, cursor - wordStart);
+
+        m_stemStart = wordStart;
+        if (wordStart == 0 && stem.startsWith(QLatin1Char('/'))) {
+            m_candidates = m_commands.complete(stem, kMaxCandidates);
+        } else {
+            if (stem.startsWith(QLatin1Char('@'))) {
+                stem.remove(0, 1);
+                ++m_stemStart;
+            }
+            m_candidates = stem.isEmpty() ? QStringList() : m_users.complete(stem, kMaxCandidates);
+        }
+        if (m_candidates.isEmpty()) {
+            reset();
+            return false;
+        }
+        m_current = backwards ? static_cast<int>(m_candidates.size()) - 1 : 0;
+    } else {
+        const int count = static_cast<int>(m_candidates.size());
+        m_current = (m_current + (backwards ? count - 1 : 1)) % count;
+    }
+
+    const int wordEnd = text.indexOf(QLatin1Char(' '), m_stemStart);
+    const QString tail = wordEnd < 0 ? QString() : text.mid(wordEnd + 1);
+    QString replacement = m_candidates.at(m_current);
+    replacement.append(QLatin1Char(' '));
+
+    const QString completed = text.left(m_stemStart) + replacement + tail;
+    entry->setText(completed);
+    entry->setCursorPosition(m_stemStart + static_cast<int>(replacement.size()));
+    m_completedText = completed;
+    return true;
+}
+
+void EntryCompleter::reset()
+{
+    m_candidates.clear();
+    m_completedText.clear();
+    m_current = -1;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include "CompletionTrie.h"
+
+class QLineEdit;
+
+// Tab completion for the entry line: catalog command names at the start of a
+// line, otherwise usernames seen in chat, join notices and user listings.
+class EntryCompleter
+{
+public:
+    EntryCompleter();
+
+    void harvestLine(const QString &plainLine);
+    void addUser(const QString &name);
+    int userCount() const;
+
+    bool complete(QLineEdit *entry, bool backwards);
+    void reset();
+
+private:
+    CompletionTrie m_commands;
+    CompletionTrie m_users;
+    QStringList m_candidates;
+    QString m_completedText;
+    int m_stemStart;
+    int m_current;
+};
@@ -0,0 +1,102 @@
+#include "FindBar.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QToolButton>
+
+FindBar::FindBar(QWidget *parent)
+    : QWidget(parent)
+    , m_entry(new QLineEdit(this))
+    , m_statusLabel(new QLabel(this))
+{
+    auto *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(2, 2, 2, 2);
+
+    m_entry->setObjectName(QStringLiteral("findEntry"));
+    m_entry->setPlaceholderText(tr("Find in scrollback"));
+    m_entry->setClearButtonEnabled(true);
+    m_entry->installEventFilter(this);
+
+    auto *previousButton = new QToolButton(this);
+    previousButton->setText(tr("Previous"));
+    auto *nextButton = new QToolButton(this);
+    nextButton->setText(tr("Next"));
+    auto *closeButton = new QToolButton(this);
+    closeButton->setText(tr("Close"));
+
+    layout->addWidget(m_entry, 1);
+    layout->addWidget(m_statusLabel);
+    layout->addWidget(previousButton);
+    layout->addWidget(nextButton);
+    layout->addWidget(closeButton);
+
+    connect(m_entry, &QLineEdit::textChanged, this, &FindBar::queryChanged);
+    connect(previousButton, &QToolButton::clicked, this, &FindBar::previousRequested);
+    connect(nextButton, &QToolButton::clicked, this, &FindBar::nextRequested);
+    connect(closeButton, &QToolButton::clicked, this, &FindBar::dismiss);
+}
+
+QString FindBar::query() const
+{
+    return m_entry ? m_entry->text() : QString();
+}
+
+void FindBar::activate()
+{
+    show();
+    if (m_entry) {
+        m_entry->setFocus(Qt::ShortcutFocusReason);
+        m_entry->selectAll();
+    }
+}
+
+void FindBar::setSearching()
+{
+    if (m_statusLabel) {
+        m_statusLabel->setText(tr("Searching..."));
+    }
+}
+
+void FindBar::setMatchStatus(int current, int total)
+{
+    if (!m_statusLabel) {
+        return;
+    }
+
+    if (total <= 0) {
+        m_statusLabel->setText(query().isEmpty() ? QString() : tr("No matches"));
+        return;
+    }
+    m_statusLabel->setText(tr("%1 of %2").arg(current + 1).arg(total));
+}
+
+bool FindBar::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_entry && event->type() == QEvent::KeyPress) {
+        auto *keyEvent = static_cast<QKeyEvent *>(event);
+        const int key = keyEvent->key();
+        if (key == Qt::Key_Escape) {
+            dismiss();
+            return true;
+        }
+        if (key == Qt::Key_Return || key == Qt::Key_Enter) {
+            if (keyEvent->modifiers() & Qt::ShiftModifier) {
+                emit previousRequested();
+            } else {
+                emit nextRequested();
+            }
+            return true;
+        }
+    }
+
+    return QWidget::eventFilter(watched, event);
+}
+
+void FindBar::dismiss()
+{
+    hide();
+    emit closed();
+}
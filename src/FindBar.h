@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QPointer>
+#include <QWidget>
+
+class QLabel;
+class QLineEdit;
+
+class FindBar : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FindBar(QWidget *parent = nullptr);
+
+    QString query() const;
+    void activate();
+    void setSearching();
+    void setMatchStatus(int current, int total);
+
+signals:
+    void queryChanged(const QString &query);
+    void nextRequested();
+    void previousRequested();
+    void closed();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void dismiss();
+
+    QPointer<QLineEdit> m_entry;
+    QPointer<QLabel> m_statusLabel;
+};
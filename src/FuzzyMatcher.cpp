@@ -0,0 +1,117 @@
+#include "FuzzyMatcher.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kScoreMatch = 16;
+constexpr int kScoreGapStart = -3;
+constexpr int kScoreGapExtension = -1;
+constexpr int kBonusBoundary = kScoreMatch / 2;
+constexpr int kBonusNonWord = kScoreMatch / 2;
+constexpr int kBonusConsecutive = -(kScoreGapStart + kScoreGapExtension);
+constexpr int kBonusFirstCharMultiplier = 2;
+
+enum class CharClass {
+    NonWord,
+    Word,
+    Digit
+};
+
+CharClass classOf(QChar ch)
+{
+    if (ch.isDigit()) {
+        return CharClass::Digit;
+    }
+    return ch.isLetter() ? CharClass::Word : CharClass::NonWord;
+}
+
+int bonusFor(CharClass previous, CharClass current)
+{
+    if (previous == CharClass::NonWord && current != CharClass::NonWord) {
+        return kBonusBoundary;
+    }
+    return current == CharClass::NonWord ? kBonusNonWord : 0;
+}
+
+} // namespace
+
+quint64 FuzzyMatcher::charMask(const QString &folded)
+{
+    quint64 mask = 0;
+    for (const QChar ch : folded) {
+        mask |= quint64(1) << (ch.unicode() % 64);
+    }
+    return mask;
+}
+
+bool FuzzyMatcher::mayMatch(quint64 queryMask, quint64 candidateMask)
+{
+    return (queryMask & ~candidateMask) == 0;
+}
+
+int FuzzyMatcher::score(const QString &foldedQuery, const QString &foldedCandidate, QVector<int> *positions)
+{
+    const int queryLength = static_cast<int>(foldedQuery.size());
+    const int candidateLength = static_cast<int>(foldedCandidate.size());
+    if (queryLength == 0) {
+        return 0;
+    }
+
+    int queryIndex = 0;
+    int end = -1;
+    for (int i = 0; i < candidateLength; ++i) {
+        if (foldedCandidate.at(i) == foldedQuery.at(queryIndex) && ++queryIndex == queryLength) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return -1;
+    }
+
+    int start = end;
+    queryIndex = queryLength - 1;
+    for (int i = end; i >= 0 && queryIndex >= 0; --i) {
+        if (foldedCandidate.at(i) == foldedQuery.at(queryIndex)) {
+            start = i;
+            --queryIndex;
+        }
+    }
+
+    int score = 0;
+    int consecutive = 0;
+    int firstBonus = 0;
+    bool inGap = false;
+    queryIndex = 0;
+    CharClass previous = start > 0 ? classOf(foldedCandidate.at(start - 1)) : CharClass::NonWord;
+    for (int i = start; i <= end; ++i) {
+        const QChar ch = foldedCandidate.at(i);
+        const CharClass current = classOf(ch);
+        if (queryIndex < queryLength && ch == foldedQuery.at(queryIndex)) {
+            int bonus = bonusFor(previous, current);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                if (bonus >= kBonusBoundary && bonus > firstBonus) {
+                    firstBonus = bonus;
+                }
+                bonus = std::max({bonus, firstBonus, kBonusConsecutive});
+            }
+            score += kScoreMatch + (queryIndex == 0 ? bonus * kBonusFirstCharMultiplier : bonus);
+            if (positions) {
+                positions->append(i);
+            }
+            inGap = false;
+            ++consecutive;
+            ++queryIndex;
+        } else {
+            score += inGap ? kScoreGapExtension : kScoreGapStart;
+            inGap = true;
+            consecutive = 0;
+            firstBonus = 0;
+        }
+        previous = current;
+    }
+    return score;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// fzf-style subsequence scorer. charMask() gives a 64-bit summary of the code
+// units in a string so candidates can be rejected before scoring.
+class FuzzyMatcher
+{
+public:
+    static quint64 charMask(const QString &folded);
+    static bool mayMatch(quint64 queryMask, quint64 candidateMask);
+    static int score(const QString &foldedQuery, const QString &foldedCandidate, QVector<int> *positions = nullptr);
+};
@@ -0,0 +1,177 @@
+#include "HighlightEngine.h"
+
+#include "ScrollbackModel.h"
+
+#include <algorithm>
+
+namespace {
+
+bool isWordUnit(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+} // namespace
+
+HighlightEngine::HighlightEngine()
+{
+    build();
+}
+
+void HighlightEngine::setRules(const QVector<HighlightRule> &rules)
+{
+    m_rules = rules;
+    build();
+}
+
+const QVector<HighlightRule> &HighlightEngine::rules() const
+{
+    return m_rules;
+}
+
+const HighlightRule &HighlightEngine::rule(int index) const
+{
+    return m_rules.at(index);
+}
+
+bool HighlightEngine::isEmpty() const
+{
+    return m_nodes.size() <= 1;
+}
+
+QVector<HighlightSpan> HighlightEngine::scan(const QString &text) const
+{
+    QVector<HighlightSpan> spans;
+    if (isEmpty()) {
+        return spans;
+    }
+
+    const QString folded = ScrollbackModel::foldCase(text);
+    int node = 0;
+    for (int i = 0; i < folded.size(); ++i) {
+        node = step(node, folded.at(i).unicode());
+
+        int output = m_nodes.at(node).rule >= 0 ? node : m_nodes.at(node).outputLink;
+        while (output >= 0) {
+            const Node &match = m_nodes.at(output);
+            const int start = i + 1 - match.depth;
+            const int end = i + 1;
+            const HighlightRule &matchedRule = m_rules.at(match.rule);
+            const bool bounded = !matchedRule.wholeWord
+                || ((start == 0 || !isWordUnit(folded.at(start - 1)))
+                    && (end == folded.size() || !isWordUnit(folded.at(end))));
+            if (bounded) {
+                spans.append(HighlightSpan{start, match.depth, match.rule});
+            }
+            output = match.outputLink;
+        }
+    }
+
+    if (spans.size() < 2) {
+        return spans;
+    }
+
+    std::sort(spans.begin(), spans.end(), [](const HighlightSpan &lhs, const HighlightSpan &rhs) {
+        if (lhs.start != rhs.start) {
+            return lhs.start < rhs.start;
+        }
+        return lhs.length > rhs.length;
+    });
+
+    QVector<HighlightSpan> resolved;
+    int coveredUntil = 0;
+    for (const HighlightSpan &span : spans) {
+        if (span.start >= coveredUntil) {
+            resolved.append(span);
+            coveredUntil = span.start + span.length;
+        }
+    }
+    return resolved;
+}
+
+int HighlightEngine::findEdge(int node, ushort unit) const
+{
+    const QVector<Edge> &edges = m_nodes.at(node).edges;
+    const auto it = std::lower_bound(edges.cbegin(), edges.cend(), unit, [](const Edge &edge, ushort value) {
+        return edge.unit < value;
+    });
+    if (it == edges.cend() || it->unit != unit) {
+        return -1;
+    }
+    return it->target;
+}
+
+int HighlightEngine::step(int node, ushort unit) const
+{
+    while (true) {
+        const int next = findEdge(node, unit);
+        if (next >= 0) {
+            return next;
+        }
+        if (node == 0) {
+            return 0;
+        }
+        node = m_nodes.at(node).fail;
+    }
+}
+
+void HighlightEngine::build()
+{
+    m_nodes.clear();
+    m_nodes.append(Node());
+
+    for (int ruleIndex = 0; ruleIndex < m_rules.size(); ++ruleIndex) {
+        const QString pattern = ScrollbackModel::foldCase(m_rules.at(ruleIndex).pattern);
+        if (pattern.isEmpty()) {
+            continue;
+        }
+
+        int node = 0;
+        for (const QChar ch : pattern) {
+            const ushort unit = ch.unicode();
+            int next = findEdge(node, unit);
+            if (next < 0) {
+                next = static_cast<int>(m_nodes.size());
+                Node child;
+                child.depth = m_nodes.at(node).depth + 1;
+                m_nodes.append(child);
+
+                QVector<Edge> &edges = m_nodes[node].edges;
+                const auto it = std::lower_bound(edges.begin(), edges.end(), unit, [](const Edge &edge, ushort value) {
+                    return edge.unit < value;
+                });
+                edges.insert(it, Edge{unit, next});
+            }
+            node = next;
+        }
+
+        if (m_nodes.at(node).rule < 0) {
+            m_nodes[node].rule = ruleIndex;
+        }
+    }
+
+    QVector<int> queue;
+    queue.reserve(m_nodes.size());
+    for (const Edge &edge : m_nodes.at(0).edges) {
+        m_nodes[edge.target].fail = 0;
+        queue.append(edge.target);
+    }
+
+    for (int head = 0; head < queue.size(); ++head) {
+        const int node = queue.at(head);
+        const QVector<Edge> edges = m_nodes.at(node).edges;
+        for (const Edge &edge : edges) {
+            int fallback = m_nodes.at(node).fail;
+            while (fallback != 0 && findEdge(fallback, edge.unit) < 0) {
+                fallback = m_nodes.at(fallback).fail;
+            }
+            const int failTarget = findEdge(fallback, edge.unit);
+            Node &child = m_nodes[edge.target];
+            child.fail = (failTarget >= 0 && failTarget != edge.target) ? failTarget : 0;
+
+            const Node &failNode = m_nodes.at(child.fail);
+            child.outputLink = failNode.rule >= 0 ? child.fail : failNode.outputLink;
+            queue.append(edge.target);
+        }
+    }
+}
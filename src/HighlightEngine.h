@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QColor>
+#include <QString>
+#include <QVector>
+
+struct HighlightRule {
+    QString pattern;
+    QColor color;
+    bool notify = false;
+    bool wholeWord = true;
+};
+
+struct HighlightSpan {
+    int start = 0;
+    int length = 0;
+    int rule = 0;
+};
+
+// Compiles every rule into one case-insensitive Aho-Corasick automaton so a
+// line is scanned once regardless of how many rules are configured.
+class HighlightEngine
+{
+public:
+    HighlightEngine();
+
+    void setRules(const QVector<HighlightRule> &rules);
+    const QVector<HighlightRule> &rules() const;
+    const HighlightRule &rule(int index) const;
+    bool isEmpty() const;
+
+    QVector<HighlightSpan> scan(const QString &text) const;
+
+private:
+    struct Edge {
+        ushort unit;
+        int target;
+    };
+
+    struct Node {
+        QVector<Edge> edges;
+        int fail = 0;
+        int outputLink = -1;
+        int rule = -1;
+        int depth = 0;
+    };
+
+    int findEdge(int node, ushort unit) const;
+    int step(int node, ushort unit) const;
+    void build();
+
+    QVector<HighlightRule> m_rules;
+    QVector<Node> m_nodes;
+};
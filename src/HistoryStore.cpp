@@ -0,0 +1,366 @@
+#include "HistoryStore.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr char kIndexMagic[] = "CHTRIDX1";
+constexpr qint64 kIndexHeaderSize = sizeof(kIndexMagic) - 1;
+constexpr qint64 kIndexEntrySize = sizeof(quint64);
+
+QByteArray encodeOffset(quint64 offset)
+{
+    QByteArray entry(kIndexEntrySize, Qt::Uninitialized);
+    qToLittleEndian<quint64>(offset, entry.data());
+    return entry;
+}
+
+} // namespace
+
+HistoryStore::HistoryStore()
+    : m_dataMap(nullptr)
+    , m_indexMap(nullptr)
+    , m_mappedDataSize(0)
+    , m_mappedLines(0)
+    , m_nextOffset(0)
+{
+}
+
+HistoryStore::~HistoryStore()
+{
+    close();
+}
+
+bool HistoryStore::open(const QString &directory, const QString &key)
+{
+    close();
+
+    if (key.isEmpty() || !QDir().mkpath(directory)) {
+        return false;
+    }
+
+    const QDir dir(directory);
+    m_dataWriter.setFileName(dir.filePath(key + QStringLiteral(".log")));
+    m_indexWriter.setFileName(dir.filePath(key + QStringLiteral(".idx")));
+    m_dataReader.setFileName(m_dataWriter.fileName());
+    m_indexReader.setFileName(m_indexWriter.fileName());
+
+    if (!m_dataWriter.open(QIODevice::WriteOnly | QIODevice::Append)
+        || !m_indexWriter.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        close();
+        return false;
+    }
+
+    if (m_indexWriter.size() == 0) {
+        m_indexWriter.write(kIndexMagic, kIndexHeaderSize);
+        m_indexWriter.flush();
+    }
+
+    if (!mapFiles() || !indexMatchesData()) {
+        if (!rebuildIndex() || !mapFiles()) {
+            close();
+            return false;
+        }
+    }
+
+    m_key = key;
+    m_nextOffset = static_cast<quint64>(m_mappedDataSize);
+    return true;
+}
+
+// Maps the files of a store another HistoryStore writes to. Nothing is ever
+// written or rebuilt; lines appended after this call are not visible.
+bool HistoryStore::openReadOnly(const QString &directory, const QString &key)
+{
+    close();
+
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    const QDir dir(directory);
+    m_dataReader.setFileName(dir.filePath(key + QStringLiteral(".log")));
+    m_indexReader.setFileName(dir.filePath(key + QStringLiteral(".idx")));
+    if (!mapFiles()) {
+        unmapFiles();
+        return false;
+    }
+
+    m_key = key;
+    return true;
+}
+
+void HistoryStore::close()
+{
+    unmapFiles();
+    m_dataWriter.close();
+    m_indexWriter.close();
+    m_key.clear();
+    m_pendingLine.clear();
+    m_nextOffset = 0;
+}
+
+bool HistoryStore::isOpen() const
+{
+    return m_dataWriter.isOpen() && m_indexWriter.isOpen();
+}
+
+QString HistoryStore::key() const
+{
+    return m_key;
+}
+
+int HistoryStore::mappedLineCount() const
+{
+    return m_mappedLines;
+}
+
+QStringList HistoryStore::readLines(int firstLine, int count) const
+{
+    QStringList lines;
+    firstLine = std::max(0, firstLine);
+    const int lastLine = std::min(m_mappedLines, firstLine + count);
+    if (!m_dataMap || !m_indexMap || firstLine >= lastLine) {
+        return lines;
+    }
+
+    lines.reserve(lastLine - firstLine);
+    const uchar *entries = m_indexMap + kIndexHeaderSize;
+    quint64 start = qFromLittleEndian<quint64>(entries + firstLine * kIndexEntrySize);
+    for (int line = firstLine; line < lastLine; ++line) {
+        if (start >= static_cast<quint64>(m_mappedDataSize)) {
+            break;
+        }
+        // The last indexed line ends at its own newline: a read-only mapping
+        // may have caught the writer between a data and an index write.
+        quint64 next = static_cast<quint64>(m_mappedDataSize);
+        if (line + 1 < m_mappedLines) {
+            next = qFromLittleEndian<quint64>(entries + (line + 1) * kIndexEntrySize);
+        } else if (const void *newline = ::memchr(m_dataMap + start, '\n', m_mappedDataSize - start)) {
+            next = static_cast<quint64>(static_cast<const uchar *>(newline) - m_dataMap) + 1;
+        }
+        const quint64 end = next > start ? next - 1 : start;
+        lines.append(QString::fromUtf8(reinterpret_cast<const char *>(m_dataMap + start),
+                                       static_cast<int>(end - start)));
+        start = next;
+    }
+    return lines;
+}
+
+void HistoryStore::append(const QString &text)
+{
+    if (!isOpen() || text.isEmpty()) {
+        return;
+    }
+
+    m_pendingLine.append(text);
+
+    int start = 0;
+    int newline = m_pendingLine.indexOf(QLatin1Char('\n'));
+    while (newline != -1) {
+        QString line = m_pendingLine.mid(start, newline - start);
+        if (line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+        writeLine(line);
+        start = newline + 1;
+        newline = m_pendingLine.indexOf(QLatin1Char('\n'), start);
+    }
+
+    if (start > 0) {
+        m_pendingLine.remove(0, start);
+    }
+}
+
+void HistoryStore::flush()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    m_dataWriter.flush();
+    m_indexWriter.flush();
+}
+
+// Replaces the log with its newest lines. The tail is copied straight out of
+// the mapping into QSaveFile replacements, so a crash leaves either the old or
+// the new log; the index is removed first and rebuilt on open if it is lost.
+bool HistoryStore::retainNewest(int lineCount)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    flush();
+    if (!mapFiles()) {
+        return false;
+    }
+    if (m_mappedLines <= lineCount) {
+        return true;
+    }
+
+    const QFileInfo dataInfo(m_dataWriter.fileName());
+    const QString directory = dataInfo.absolutePath();
+    const QString key = m_key;
+    const QString indexPath = m_indexWriter.fileName();
+    const int firstLine = m_mappedLines - std::max(0, lineCount);
+    const uchar *entries = m_indexMap + kIndexHeaderSize;
+    const quint64 base = qFromLittleEndian<quint64>(entries + firstLine * kIndexEntrySize);
+
+    QSaveFile data(dataInfo.filePath());
+    if (!data.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const qint64 tailSize = m_mappedDataSize - static_cast<qint64>(base);
+    if (data.write(reinterpret_cast<const char *>(m_dataMap + base), tailSize) != tailSize) {
+        data.cancelWriting();
+        return false;
+    }
+
+    QByteArray index(kIndexMagic, kIndexHeaderSize);
+    index.reserve(kIndexHeaderSize + (m_mappedLines - firstLine) * kIndexEntrySize);
+    for (int line = firstLine; line < m_mappedLines; ++line) {
+        index.append(encodeOffset(qFromLittleEndian<quint64>(entries + line * kIndexEntrySize) - base));
+    }
+
+    close();
+    QFile::remove(indexPath);
+    bool replaced = data.commit();
+    if (replaced) {
+        QSaveFile indexFile(indexPath);
+        replaced = indexFile.open(QIODevice::WriteOnly)
+            && indexFile.write(index) == index.size()
+            && indexFile.commit();
+    }
+    return open(directory, key) && replaced;
+}
+
+QString HistoryStore::sanitizedKey(const QString &host, const QString &nickname)
+{
+    static const QRegularExpression unsafe(QStringLiteral("[^A-Za-z0-9._-]"));
+    QString key = QStringLiteral("%1-%2").arg(host, nickname);
+    key.replace(unsafe, QStringLiteral("_"));
+    return key;
+}
+
+bool HistoryStore::mapFiles()
+{
+    unmapFiles();
+
+    if (!m_dataReader.open(QIODevice::ReadOnly) || !m_indexReader.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_mappedDataSize = m_dataReader.size();
+    if (m_mappedDataSize > 0) {
+        m_dataMap = m_dataReader.map(0, m_mappedDataSize);
+        if (!m_dataMap) {
+            return false;
+        }
+    }
+
+    const qint64 indexSize = m_indexReader.size();
+    if (indexSize < kIndexHeaderSize) {
+        return false;
+    }
+
+    m_indexMap = m_indexReader.map(0, indexSize);
+    if (!m_indexMap || ::memcmp(m_indexMap, kIndexMagic, kIndexHeaderSize) != 0) {
+        return false;
+    }
+
+    m_mappedLines = static_cast<int>((indexSize - kIndexHeaderSize) / kIndexEntrySize);
+    return true;
+}
+
+bool HistoryStore::indexMatchesData() const
+{
+    if (!m_indexMap) {
+        return false;
+    }
+    if (m_mappedLines == 0) {
+        return m_mappedDataSize == 0;
+    }
+    if (!m_dataMap || m_dataMap[m_mappedDataSize - 1] != '\n') {
+        return false;
+    }
+
+    const uchar *entries = m_indexMap + kIndexHeaderSize;
+    const quint64 lastStart = qFromLittleEndian<quint64>(entries + (m_mappedLines - 1) * kIndexEntrySize);
+    if (lastStart >= static_cast<quint64>(m_mappedDataSize)) {
+        return false;
+    }
+
+    const void *newline = ::memchr(m_dataMap + lastStart, '\n', m_mappedDataSize - lastStart);
+    return newline == m_dataMap + m_mappedDataSize - 1;
+}
+
+bool HistoryStore::rebuildIndex()
+{
+    if (m_mappedDataSize > 0 && !m_dataMap) {
+        return false;
+    }
+
+    QByteArray index(kIndexMagic, kIndexHeaderSize);
+
+    qint64 start = 0;
+    while (m_dataMap && start < m_mappedDataSize) {
+        const void *found = ::memchr(m_dataMap + start, '\n', m_mappedDataSize - start);
+        if (!found) {
+            break;
+        }
+        index.append(encodeOffset(static_cast<quint64>(start)));
+        start = static_cast<const uchar *>(found) - m_dataMap + 1;
+    }
+
+    unmapFiles();
+
+    if (start < m_dataWriter.size() && !m_dataWriter.resize(start)) {
+        return false;
+    }
+
+    m_indexWriter.close();
+    if (!m_indexWriter.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    const bool written = m_indexWriter.write(index) == index.size();
+    m_indexWriter.close();
+
+    return written && m_indexWriter.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void HistoryStore::unmapFiles()
+{
+    if (m_dataMap) {
+        m_dataReader.unmap(const_cast<uchar *>(m_dataMap));
+        m_dataMap = nullptr;
+    }
+    if (m_indexMap) {
+        m_indexReader.unmap(const_cast<uchar *>(m_indexMap));
+        m_indexMap = nullptr;
+    }
+    m_dataReader.close();
+    m_indexReader.close();
+    m_mappedDataSize = 0;
+    m_mappedLines = 0;
+}
+
+void HistoryStore::writeLine(const QString &line)
+{
+    QByteArray bytes = line.toUtf8();
+    bytes.append('\n');
+
+    if (m_dataWriter.write(bytes) != bytes.size()) {
+        return;
+    }
+    m_indexWriter.write(encodeOffset(m_nextOffset));
+    m_nextOffset += static_cast<quint64>(bytes.size());
+}
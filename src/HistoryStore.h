@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+// Append-only UTF-8 line log plus a little-endian offset index, both memory-mapped on open.
+class HistoryStore
+{
+public:
+    HistoryStore();
+    ~HistoryStore();
+
+    bool open(const QString &directory, const QString &key);
+    bool openReadOnly(const QString &directory, const QString &key);
+    void close();
+    bool isOpen() const;
+    QString key() const;
+
+    int mappedLineCount() const;
+    QStringList readLines(int firstLine, int count) const;
+
+    void append(const QString &text);
+    void flush();
+    bool retainNewest(int lineCount);
+
+    static QString sanitizedKey(const QString &host, const QString &nickname);
+
+private:
+    bool mapFiles();
+    bool indexMatchesData() const;
+    bool rebuildIndex();
+    void unmapFiles();
+    void writeLine(const QString &line);
+
+    QFile m_dataReader;
+    QFile m_indexReader;
+    QFile m_dataWriter;
+    QFile m_indexWriter;
+    QString m_key;
+    QString m_pendingLine;
+    const uchar *m_dataMap;
+    const uchar *m_indexMap;
+    qint64 m_mappedDataSize;
+    int m_mappedLines;
+    quint64 m_nextOffset;
+};
@@ -0,0 +1,106 @@
+#include "KeyLatencyProbe.h"
+
+#include <QStringList>
+
+namespace {
+constexpr qint64 kAbandonAfterUs = 2000000;
+
+const char *const kStageNames[kLatencyStageCount] = {
+    "key",
+    "key -> write",
+    "write -> read",
+    "read -> parse",
+    "parse -> paint",
+};
+
+QString formatMillis(qint64 micros)
+{
+    return QString::number(double(micros) / 1000.0, 'f', 2);
+}
+
+QString reportRow(const QString &name, const LatencyHistogram &histogram)
+{
+    return QStringLiteral("%1 %2 %3 %4 %5 %6")
+        .arg(name, -16)
+        .arg(histogram.count(), 8)
+        .arg(formatMillis(histogram.percentile(0.50)), 9)
+        .arg(formatMillis(histogram.percentile(0.99)), 9)
+        .arg(formatMillis(histogram.percentile(0.999)), 9)
+        .arg(formatMillis(histogram.maximum()), 9);
+}
+} // namespace
+
+KeyLatencyProbe::KeyLatencyProbe()
+{
+    m_clock.start();
+}
+
+void KeyLatencyProbe::mark(LatencyStage stage)
+{
+    const int index = static_cast<int>(stage);
+    const qint64 now = m_clock.nsecsElapsed() / 1000;
+    if (m_next > 0 && now - m_stamps[0] > kAbandonAfterUs) {
+        ++m_abandoned;
+        m_next = 0;
+    }
+    if (index != m_next) {
+        return;
+    }
+
+    m_stamps[index] = now;
+    if (stage != LatencyStage::Paint) {
+        ++m_next;
+        return;
+    }
+
+    for (int i = 1; i < kLatencyStageCount; ++i) {
+        m_stages[i].record(m_stamps[i] - m_stamps[i - 1]);
+    }
+    m_total.record(now - m_stamps[0]);
+    m_next = 0;
+}
+
+void KeyLatencyProbe::reset()
+{
+    for (LatencyHistogram &histogram : m_stages) {
+        histogram.reset();
+    }
+    m_total.reset();
+    m_next = 0;
+    m_abandoned = 0;
+}
+
+const LatencyHistogram &KeyLatencyProbe::stage(LatencyStage stage) const
+{
+    return m_stages[static_cast<int>(stage)];
+}
+
+const LatencyHistogram &KeyLatencyProbe::total() const
+{
+    return m_total;
+}
+
+quint64 KeyLatencyProbe::abandoned() const
+{
+    return m_abandoned;
+}
+
+QString KeyLatencyProbe::report() const
+{
+    QStringList lines;
+    lines.append(QStringLiteral("Keystroke-to-echo latency in ms (%1 samples, %2 abandoned)")
+                     .arg(m_total.count())
+                     .arg(m_abandoned));
+    lines.append(QStringLiteral("%1 %2 %3 %4 %5 %6")
+                     .arg(QStringLiteral("stage"), -16)
+                     .arg(QStringLiteral("count"), 8)
+                     .arg(QStringLiteral("p50"), 9)
+                     .arg(QStringLiteral("p99"), 9)
+                     .arg(QStringLiteral("p99.9"), 9)
+                     .arg(QStringLiteral("max"), 9));
+    for (int i = 1; i < kLatencyStageCount; ++i) {
+        lines.append(reportRow(QString::fromLatin1(kStageNames[i]), m_stages[i]));
+    }
+    lines.append(reportRow(QStringLiteral("key -> paint"), m_total));
+    return lines.join(QLatin1Char('\n')) + QLatin1Char('\n');
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <array>
+
+enum class LatencyStage {
+    Key,
+    Write,
+    Read,
+    Parse,
+    Paint
+};
+
+constexpr int kLatencyStageCount = 5;
+
+// Samples one keystroke at a time through the echo path: key event, pty
+// write, first read after the write, parse/insert, and the next paint. Keys
+// pressed while a sample is in flight are not tracked, so every stamp is
+// unambiguous. Each stage records the time since the previous one, plus a
+// key-to-paint total.
+class KeyLatencyProbe
+{
+public:
+    KeyLatencyProbe();
+
+    void mark(LatencyStage stage);
+    void reset();
+
+    const LatencyHistogram &stage(LatencyStage stage) const;
+    const LatencyHistogram &total() const;
+    quint64 abandoned() const;
+
+    QString report() const;
+
+private:
+    QElapsedTimer m_clock;
+    std::array<qint64, kLatencyStageCount> m_stamps {};
+    std::array<LatencyHistogram, kLatencyStageCount> m_stages;
+    LatencyHistogram m_total;
+    int m_next = 0;
+    quint64 m_abandoned = 0;
+};
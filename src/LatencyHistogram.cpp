@@ -0,0 +1,101 @@
+#include "LatencyHistogram.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kSubBucketBits = 6;
+constexpr int kSubBucketCount = 1 << kSubBucketBits;
+constexpr int kHighestExponent = 36;
+constexpr int kBucketCount = kSubBucketCount * (kHighestExponent - kSubBucketBits + 2);
+constexpr qint64 kHighestTrackable = (qint64(1) << (kHighestExponent + 1)) - 1;
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : m_counts(kBucketCount, 0)
+{
+}
+
+void LatencyHistogram::record(qint64 micros)
+{
+    micros = std::clamp<qint64>(micros, 0, kHighestTrackable);
+    ++m_counts[bucketFor(micros)];
+    if (m_count == 0 || micros < m_minimum) {
+        m_minimum = micros;
+    }
+    m_maximum = std::max(m_maximum, micros);
+    m_total += micros;
+    ++m_count;
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_total = 0;
+    m_minimum = 0;
+    m_maximum = 0;
+}
+
+quint64 LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::minimum() const
+{
+    return m_minimum;
+}
+
+qint64 LatencyHistogram::maximum() const
+{
+    return m_maximum;
+}
+
+qint64 LatencyHistogram::mean() const
+{
+    return m_count > 0 ? m_total / qint64(m_count) : 0;
+}
+
+qint64 LatencyHistogram::percentile(double fraction) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const quint64 target = std::max<quint64>(
+        1, static_cast<quint64>(std::ceil(std::clamp(fraction, 0.0, 1.0) * double(m_count))));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < kBucketCount; ++bucket) {
+        seen += m_counts.at(bucket);
+        if (seen >= target) {
+            // Report the highest value the bucket stands for, as HdrHistogram does.
+            const qint64 highest = bucket + 1 < kBucketCount ? lowestValueAt(bucket + 1) - 1 : m_maximum;
+            return std::clamp(highest, m_minimum, m_maximum);
+        }
+    }
+    return m_maximum;
+}
+
+int LatencyHistogram::bucketFor(qint64 micros)
+{
+    if (micros < 2 * kSubBucketCount) {
+        return static_cast<int>(micros);
+    }
+    const int exponent = 63 - qCountLeadingZeroBits(quint64(micros));
+    const int shift = exponent - kSubBucketBits;
+    return kSubBucketCount * (exponent - kSubBucketBits + 1)
+        + static_cast<int>((micros >> shift) - kSubBucketCount);
+}
+
+qint64 LatencyHistogram::lowestValueAt(int bucket)
+{
+    if (bucket < 2 * kSubBucketCount) {
+        return bucket;
+    }
+    const int exponent = bucket / kSubBucketCount + kSubBucketBits - 1;
+    const qint64 subBucket = bucket % kSubBucketCount + kSubBucketCount;
+    return subBucket << (exponent - kSubBucketBits);
+}
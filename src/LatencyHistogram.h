@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+// Log-linear histogram of microsecond samples in the style of HdrHistogram:
+// 64 linear sub-buckets per power of two keep every percentile within about
+// 1.6% of the recorded value while the table stays a fixed 16 KiB.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 micros);
+    void reset();
+
+    quint64 count() const;
+    qint64 minimum() const;
+    qint64 maximum() const;
+    qint64 mean() const;
+    qint64 percentile(double fraction) const;
+
+private:
+    static int bucketFor(qint64 micros);
+    static qint64 lowestValueAt(int bucket);
+
+    QVector<quint64> m_counts;
+    quint64 m_count = 0;
+    qint64 m_total = 0;
+    qint64 m_minimum = 0;
+    qint64 m_maximum = 0;
+};
@@ -1,18 +1,37 @@
 #include "MainWindow.h"
 
+#include "AnsiText.h"
+#include "AsciiArtLibrary.h"
+#include "AsciiImageConverter.h"
 #include "ChatterClient.h"
+#include "CommandPalette.h"
+#include "CommandValidator.h"
 #include "CommandCatalog.h"
+#include "DocumentWriter.h"
+#include "KeyLatencyProbe.h"
+#include "MessageFilter.h"
+#include "MessageStore.h"
+#include "PerfCounters.h"
+#include "ScrollbackExporter.h"
+#include "ScrollbackModel.h"
 #include "TerminalWidget.h"
+#include "TraceRecorder.h"
 
 #include <QAction>
+#include <QActionGroup>
 #include <QByteArray>
 #include <QApplication>
+#include <QCheckBox>
 #include <QBrush>
 #include <QColor>
+#include <QComboBox>
+#include <QDateTime>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QDir>
 #include <QDoubleSpinBox>
+#include <QElapsedTimer>
+#include <QEvent>
 #include <QFileDialog>
 #include <QFont>
 #include <QFontComboBox>
@@ -21,17 +40,33 @@
 #include <QFormLayout>
 #include <QFrame>
 #include <QHBoxLayout>
+#include <QHeaderView>
+#include <QImageReader>
 #include <QInputDialog>
+#include <QKeySequence>
 #include <QLabel>
+#include <QLineEdit>
 #include <QList>
+#include <QListWidget>
+#include <QLocale>
 #include <QMenuBar>
 #include <QPalette>
 #include <QPlainTextEdit>
+#include <QProgressDialog>
 #include <QProcessEnvironment>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QSaveFile>
+#include <QSettings>
+#include <QSignalBlocker>
+#include <QScrollBar>
+#include <QSlider>
+#include <QSortFilterProxyModel>
 #include <QStatusBar>
+#include <QStyle>
+#include <QSystemTrayIcon>
+#include <QTableView>
+#include <QTableWidget>
 #include <QMessageBox>
 #include <QTextBrowser>
 #include <QTextCharFormat>
@@ -39,7 +74,7 @@
 #include <QTextBlockFormat>
 #include <QTextEdit>
 #include <QTextOption>
-#include <QTextStream>
+#include <QThread>
 #include <QTextDocument>
 #include <QTimer>
 #include <QVariant>
@@ -51,10 +86,130 @@
 #include <QByteArray>
 
 #include <algorithm>
+#include <functional>
 
 namespace {
 
 constexpr int kAsciiMaxLines = 64;
+constexpr int kHistoryRestoreScreens = 5;
+constexpr int kHistoryPageLines = 1000;
+constexpr int kHistoryFlushIntervalMs = 1000;
+// How long a filtered partial line may wait for its newline before it is
+// judged as is; long enough to bridge split pty reads, short for prompts.
+constexpr int kFilterFlushDelayMs = 50;
+constexpr int kRecentCommandLimit = 50;
+
+class AsciiImageDialog : public QDialog
+{
+public:
+    AsciiImageDialog(const AsciiImageConverter *converter, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_converter(converter)
+        , m_preview(new QTextEdit(this))
+        , m_widthSlider(new QSlider(Qt::Horizontal, this))
+        , m_contrastSlider(new QSlider(Qt::Horizontal, this))
+        , m_brightnessSlider(new QSlider(Qt::Horizontal, this))
+        , m_edgesCheck(new QCheckBox(tr("Trace edges"), this))
+        , m_colourCheck(new QCheckBox(tr("256 colours"), this))
+        , m_sizeLabel(new QLabel(this))
+        , m_previewTimer(new QTimer(this))
+    {
+        setWindowTitle(tr("Import Image"));
+        setModal(true);
+
+        m_preview->setReadOnly(true);
+        m_preview->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        m_preview->setLineWrapMode(QTextEdit::NoWrap);
+
+        m_widthSlider->setRange(16, 200);
+        m_widthSlider->setValue(80);
+        m_contrastSlider->setRange(20, 300);
+        m_contrastSlider->setValue(100);
+        m_brightnessSlider->setRange(-50, 50);
+        m_brightnessSlider->setValue(0);
+
+        auto *form = new QFormLayout();
+        form->addRow(tr("Width:"), m_widthSlider);
+        form->addRow(tr("Contrast:"), m_contrastSlider);
+        form->addRow(tr("Brightness:"), m_brightnessSlider);
+        form->addRow(QString(), m_edgesCheck);
+        form->addRow(QString(), m_colourCheck);
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addWidget(m_preview, 1);
+        layout->addLayout(form);
+
+        auto *footerLayout = new QHBoxLayout();
+        footerLayout->addWidget(m_sizeLabel);
+        footerLayout->addStretch();
+        footerLayout->addWidget(buttonBox);
+        layout->addLayout(footerLayout);
+
+        m_previewTimer->setSingleShot(true);
+        m_previewTimer->setInterval(0);
+        connect(m_previewTimer, &QTimer::timeout, this, [this]() { updatePreview(); });
+        connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+        for (QSlider *slider : {m_widthSlider, m_contrastSlider, m_brightnessSlider}) {
+            connect(slider, &QSlider::valueChanged, m_previewTimer, qOverload<>(&QTimer::start));
+        }
+        for (QCheckBox *check : {m_edgesCheck, m_colourCheck}) {
+            connect(check, &QCheckBox::toggled, m_previewTimer, qOverload<>(&QTimer::start));
+        }
+
+        resize(720, 560);
+        updatePreview();
+    }
+
+    QStringList lines() const
+    {
+        return m_lines;
+    }
+
+private:
+    void updatePreview()
+    {
+        AsciiImageOptions options;
+        options.columns = m_widthSlider->value();
+        options.maxRows = kAsciiMaxLines;
+        options.contrast = m_contrastSlider->value() / 100.0;
+        options.brightness = m_brightnessSlider->value() / 100.0;
+        options.edges = m_edgesCheck->isChecked();
+        options.colour = m_colourCheck->isChecked();
+
+        QElapsedTimer timer;
+        timer.start();
+        m_lines = m_converter->convert(options);
+
+        m_preview->clear();
+        QTextCursor cursor(m_preview->document());
+        QTextCharFormat baseFormat;
+        baseFormat.setForeground(m_preview->palette().color(QPalette::Text));
+        for (int i = 0; i < m_lines.size(); ++i) {
+            if (i > 0) {
+                cursor.insertBlock();
+            }
+            for (const FormattedFragment &fragment : AnsiText::parse(m_lines.at(i), baseFormat)) {
+                cursor.insertText(fragment.text, fragment.format);
+            }
+        }
+
+        m_sizeLabel->setText(tr("%1 lines, %2 ms").arg(m_lines.size()).arg(timer.elapsed()));
+    }
+
+    const AsciiImageConverter *m_converter;
+    QTextEdit *m_preview;
+    QSlider *m_widthSlider;
+    QSlider *m_contrastSlider;
+    QSlider *m_brightnessSlider;
+    QCheckBox *m_edgesCheck;
+    QCheckBox *m_colourCheck;
+    QLabel *m_sizeLabel;
+    QTimer *m_previewTimer;
+    QStringList m_lines;
+};
 
 class AsciiComposerDialog : public QDialog
 {
@@ -76,6 +231,8 @@ public:
         m_commitButton = buttonBox->addButton(tr("Commit"), QDialogButtonBox::AcceptRole);
         m_commitButton->setDefault(true);
         buttonBox->addButton(QDialogButtonBox::Cancel);
+        QPushButton *importButton = buttonBox->addButton(tr("Import Image..."), QDialogButtonBox::ActionRole);
+        connect(importButton, &QPushButton::clicked, this, [this]() { importImage(); });
 
         auto *layout = new QVBoxLayout(this);
         layout->addWidget(m_editor);
@@ -102,6 +259,9 @@ public:
         if (text.isEmpty()) {
             return {};
         }
+        if (hasColour()) {
+            return m_colourLines;
+        }
         QStringList collected = text.split('\n', Qt::KeepEmptyParts);
         if (collected.size() > kAsciiMaxLines) {
             collected = collected.mid(0, kAsciiMaxLines);
@@ -110,6 +270,52 @@ public:
     }
 
 private:
+    void importImage()
+    {
+        QStringList patterns;
+        for (const QByteArray &format : QImageReader::supportedImageFormats()) {
+            patterns.append(QStringLiteral("*.") + QString::fromLatin1(format));
+        }
+        const QString picturesDir = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
+        const QString filePath = QFileDialog::getOpenFileName(this,
+                                                              tr("Import Image"),
+                                                              picturesDir.isEmpty() ? QDir::homePath() : picturesDir,
+                                                              tr("Images (%1)").arg(patterns.join(QLatin1Char(' '))));
+        if (filePath.isEmpty()) {
+            return;
+        }
+
+        AsciiImageConverter converter;
+        if (!converter.load(filePath)) {
+            QMessageBox::warning(this,
+                                 tr("Import Failed"),
+                                 tr("Couldn't read %1 as an image.").arg(QDir::toNativeSeparators(filePath)));
+            return;
+        }
+
+        AsciiImageDialog dialog(&converter, this);
+        if (dialog.exec() != QDialog::Accepted) {
+            return;
+        }
+
+        // The editor only ever holds plain text; a coloured import is kept
+        // aside and sent as long as the text is left as imported.
+        const QStringList imported = dialog.lines();
+        QStringList plain;
+        plain.reserve(imported.size());
+        for (const QString &line : imported) {
+            plain.append(MessageFilter::stripAnsi(line));
+        }
+        m_colourLines = plain == imported ? QStringList() : imported;
+        m_importedText = plain.join(QLatin1Char('\n'));
+        m_editor->setPlainText(m_importedText);
+    }
+
+    bool hasColour() const
+    {
+        return !m_colourLines.isEmpty() && m_editor->toPlainText() == m_importedText;
+    }
+
     void enforceLineLimit()
     {
         QString text = m_editor->toPlainText();
@@ -138,7 +344,8 @@ private:
         QStringList collected = text.isEmpty() ? QStringList() : text.split('\n', Qt::KeepEmptyParts);
         const int count = text.isEmpty() ? 0 : collected.size();
 
-        m_lineCountLabel->setText(tr("Lines: %1 / %2").arg(count).arg(kAsciiMaxLines));
+        m_lineCountLabel->setText(hasColour() ? tr("Lines: %1 / %2, 256 colours").arg(count).arg(kAsciiMaxLines)
+                                              : tr("Lines: %1 / %2").arg(count).arg(kAsciiMaxLines));
 
         const bool hasContent = std::any_of(collected.cbegin(), collected.cend(), [](const QString &line) {
             return !line.isEmpty();
@@ -151,6 +358,228 @@ private:
     QPlainTextEdit *m_editor;
     QLabel *m_lineCountLabel;
     QPushButton *m_commitButton;
+    QStringList m_colourLines;
+    QString m_importedText;
+};
+
+class ArgumentDialog : public QDialog
+{
+public:
+    ArgumentDialog(const QString &hint, int commandIndex, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_editor(new QLineEdit(this))
+        , m_errorLabel(new QLabel(this))
+        , m_commandIndex(commandIndex)
+    {
+        setWindowTitle(tr("Command Argument"));
+        setModal(true);
+
+        QPalette palette = m_errorLabel->palette();
+        palette.setColor(QPalette::WindowText, AnsiText::basicColor(1, true));
+        m_errorLabel->setPalette(palette);
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+        m_okButton = buttonBox->button(QDialogButtonBox::Ok);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addWidget(new QLabel(hint, this));
+        layout->addWidget(m_editor);
+        layout->addWidget(m_errorLabel);
+        layout->addWidget(buttonBox);
+
+        connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+        connect(m_editor, &QLineEdit::textChanged, this, [this]() { updateStatus(); });
+
+        updateStatus();
+    }
+
+    QString value() const
+    {
+        return m_editor->text();
+    }
+
+private:
+    void updateStatus()
+    {
+        const QString text = m_editor->text();
+        const QString error = (m_commandIndex >= 0 && !text.trimmed().isEmpty())
+            ? CommandValidator::validateArgument(m_commandIndex, text)
+            : QString();
+        m_errorLabel->setText(error);
+        m_errorLabel->setVisible(!error.isEmpty());
+        m_okButton->setEnabled(!text.trimmed().isEmpty() && error.isEmpty());
+    }
+
+    QLineEdit *m_editor;
+    QLabel *m_errorLabel;
+    QPushButton *m_okButton;
+    int m_commandIndex;
+};
+
+class AsciiArtLibraryDialog : public QDialog
+{
+public:
+    AsciiArtLibraryDialog(AsciiArtLibrary *library, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_library(library)
+        , m_list(new QListWidget(this))
+        , m_preview(new QPlainTextEdit(this))
+    {
+        setWindowTitle(tr("ASCII Art Library"));
+        setModal(true);
+
+        m_preview->setReadOnly(true);
+        m_preview->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        m_preview->setWordWrapMode(QTextOption::NoWrap);
+
+        const QVector<AsciiArtEntry> entries = library->entries();
+        for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+            auto *item = new QListWidgetItem(QStringLiteral("%1  %2")
+                                                 .arg(QLocale().toString(it->created, QLocale::ShortFormat),
+                                                      it->preview),
+                                             m_list);
+            item->setData(Qt::UserRole, it->hash);
+            item->setToolTip(tr("%n line(s)", nullptr, it->lineCount));
+        }
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+        m_sendButton = buttonBox->addButton(tr("Send"), QDialogButtonBox::AcceptRole);
+        m_sendButton->setEnabled(false);
+
+        auto *splitLayout = new QHBoxLayout();
+        splitLayout->addWidget(m_list, 1);
+        splitLayout->addWidget(m_preview, 2);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addLayout(splitLayout);
+        layout->addWidget(buttonBox);
+
+        connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+        connect(m_list, &QListWidget::currentItemChanged, this, [this](QListWidgetItem *current) {
+            m_selectedHash = current ? current->data(Qt::UserRole).toString() : QString();
+            showLines(QStringList());
+            if (!m_selectedHash.isEmpty()) {
+                m_library->requestLines(m_selectedHash);
+            }
+        });
+        connect(library, &AsciiArtLibrary::linesLoaded, this, [this](const QString &hash, const QStringList &lines) {
+            if (hash == m_selectedHash) {
+                showLines(lines);
+            }
+        });
+        connect(m_list, &QListWidget::itemDoubleClicked, this, &QDialog::accept);
+
+        resize(760, 480);
+        m_list->setCurrentRow(0);
+    }
+
+    QStringList selectedLines() const
+    {
+        return m_lines;
+    }
+
+private:
+    void showLines(const QStringList &lines)
+    {
+        m_lines = lines;
+        m_preview->setPlainText(MessageFilter::stripAnsi(m_lines.join(QLatin1Char('\n'))));
+        m_sendButton->setEnabled(!m_lines.isEmpty());
+    }
+
+    AsciiArtLibrary *m_library;
+    QListWidget *m_list;
+    QPlainTextEdit *m_preview;
+    QPushButton *m_sendButton;
+    QString m_selectedHash;
+    QStringList m_lines;
+};
+
+class LatencyDiagnosticsDialog : public QDialog
+{
+public:
+    LatencyDiagnosticsDialog(KeyLatencyProbe *probe, const TerminalWidget *terminal, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_probe(probe)
+        , m_terminal(terminal)
+        , m_report(new QPlainTextEdit(this))
+    {
+        setWindowTitle(tr("Latency Diagnostics"));
+
+        m_report->setReadOnly(true);
+        m_report->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        m_report->setWordWrapMode(QTextOption::NoWrap);
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+        QPushButton *resetButton = buttonBox->addButton(tr("Reset"), QDialogButtonBox::ResetRole);
+        QPushButton *saveButton = buttonBox->addButton(tr("Save..."), QDialogButtonBox::ActionRole);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addWidget(m_report);
+        layout->addWidget(buttonBox);
+
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+        connect(resetButton, &QPushButton::clicked, this, [this]() {
+            m_probe->reset();
+            refresh();
+        });
+        connect(saveButton, &QPushButton::clicked, this, &LatencyDiagnosticsDialog::save);
+
+        auto *refreshTimer = new QTimer(this);
+        connect(refreshTimer, &QTimer::timeout, this, &LatencyDiagnosticsDialog::refresh);
+        refreshTimer->start(1000);
+
+        resize(640, 260);
+        refresh();
+    }
+
+private:
+    QString reportText() const
+    {
+        QString text = m_probe->report();
+        if (m_terminal) {
+            const EchoPredictionStats echo = m_terminal->echoStats();
+            text += tr("\nPredictive echo: %1 predicted, %2 confirmed, %3 mispredicted, %4 abandoned, %5 ms smoothed\n")
+                        .arg(echo.predicted)
+                        .arg(echo.confirmed)
+                        .arg(echo.mispredicted)
+                        .arg(echo.abandoned)
+                        .arg(echo.smoothedLatencyMs);
+        }
+        return text;
+    }
+
+    void refresh()
+    {
+        m_report->setPlainText(reportText());
+    }
+
+    void save()
+    {
+        const QString documentsDir = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+        const QString basePath = documentsDir.isEmpty() ? QDir::homePath() : documentsDir;
+        const QString filePath = QFileDialog::getSaveFileName(this,
+                                                              tr("Save Latency Report"),
+                                                              QDir(basePath).filePath(QStringLiteral("chatter-latency.txt")),
+                                                              tr("Plain Text (*.txt)"));
+        if (filePath.isEmpty()) {
+            return;
+        }
+
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)
+            || file.write(reportText().toUtf8()) < 0
+            || !file.commit()) {
+            QMessageBox::warning(this,
+                                 tr("Save Failed"),
+                                 tr("Couldn't save %1: %2").arg(QDir::toNativeSeparators(filePath), file.errorString()));
+        }
+    }
+
+    KeyLatencyProbe *m_probe;
+    const TerminalWidget *m_terminal;
+    QPlainTextEdit *m_report;
 };
 
 class AppearanceDialog : public QDialog
@@ -227,297 +656,345 @@ private:
     QLabel *m_previewLabel;
 };
 
-struct FormattedFragment {
-    QString text;
-    QTextCharFormat format;
-};
+class HighlightRulesDialog : public QDialog
+{
+public:
+    explicit HighlightRulesDialog(const QVector<HighlightRule> &rules, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_table(new QTableWidget(0, 3, this))
+    {
+        setWindowTitle(tr("Highlight Rules"));
+        setModal(true);
 
-QColor basicAnsiColor(int index, bool bright)
-{
-    static const QColor normal[] = {
-        QColor(0, 0, 0),         // black
-        QColor(128, 0, 0),       // red
-        QColor(0, 128, 0),       // green
-        QColor(128, 128, 0),     // yellow
-        QColor(0, 0, 128),       // blue
-        QColor(128, 0, 128),     // magenta
-        QColor(0, 128, 128),     // cyan
-        QColor(192, 192, 192)    // white
-    };
-    static const QColor brightColors[] = {
-        QColor(128, 128, 128),   // bright black / gray
-        QColor(255, 0, 0),       // bright red
-        QColor(0, 255, 0),       // bright green
-        QColor(255, 255, 0),     // bright yellow
-        QColor(0, 0, 255),       // bright blue
-        QColor(255, 0, 255),     // bright magenta
-        QColor(0, 255, 255),     // bright cyan
-        QColor(255, 255, 255)    // bright white
-    };
+        m_table->setHorizontalHeaderLabels({tr("Pattern"), tr("Color"), tr("Notify")});
+        m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_table->verticalHeader()->setVisible(false);
+        for (const auto &rule : rules) {
+            addRow(rule);
+        }
 
-    index = qBound(0, index, 7);
-    return bright ? brightColors[index] : normal[index];
-}
+        auto *addButton = new QPushButton(tr("Add"), this);
+        auto *removeButton = new QPushButton(tr("Remove"), this);
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
 
-QColor colorFrom256Palette(int index)
-{
-    if (index < 0) {
-        index = 0;
-    }
-    if (index > 255) {
-        index = 255;
-    }
+        auto *footerLayout = new QHBoxLayout();
+        footerLayout->addWidget(addButton);
+        footerLayout->addWidget(removeButton);
+        footerLayout->addStretch();
+        footerLayout->addWidget(buttonBox);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addWidget(new QLabel(tr("Your nickname is always highlighted. Colors use #rrggbb."), this));
+        layout->addWidget(m_table);
+        layout->addLayout(footerLayout);
 
-    if (index < 16) {
-        const bool bright = index >= 8;
-        return basicAnsiColor(index % 8, bright);
+        connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+        connect(addButton, &QPushButton::clicked, this, [this]() {
+            HighlightRule rule;
+            rule.color = QColor(128, 128, 0);
+            addRow(rule);
+            m_table->editItem(m_table->item(m_table->rowCount() - 1, 0));
+        });
+        connect(removeButton, &QPushButton::clicked, this, [this]() {
+            const int row = m_table->currentRow();
+            if (row >= 0) {
+                m_table->removeRow(row);
+            }
+        });
     }
 
-    if (index < 232) {
-        const int base = index - 16;
-        const int r = base / 36;
-        const int g = (base / 6) % 6;
-        const int b = base % 6;
-        auto component = [](int value) {
-            if (value == 0) {
-                return 0;
+    QVector<HighlightRule> rules() const
+    {
+        QVector<HighlightRule> collected;
+        for (int row = 0; row < m_table->rowCount(); ++row) {
+            HighlightRule rule;
+            rule.pattern = m_table->item(row, 0)->text().trimmed();
+            if (rule.pattern.isEmpty()) {
+                continue;
             }
-            return 55 + (value * 40);
-        };
-        return QColor(component(r), component(g), component(b));
+            rule.color = QColor(m_table->item(row, 1)->text().trimmed());
+            rule.notify = m_table->item(row, 2)->checkState() == Qt::Checked;
+            collected.append(rule);
+        }
+        return collected;
     }
 
-    const int gray = 8 + ((index - 232) * 10);
-    return QColor(gray, gray, gray);
-}
+private:
+    void addRow(const HighlightRule &rule)
+    {
+        const int row = m_table->rowCount();
+        m_table->insertRow(row);
+        m_table->setItem(row, 0, new QTableWidgetItem(rule.pattern));
+        m_table->setItem(row, 1, new QTableWidgetItem(rule.color.isValid() ? rule.color.name() : QString()));
+
+        auto *notifyItem = new QTableWidgetItem();
+        notifyItem->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+        notifyItem->setCheckState(rule.notify ? Qt::Checked : Qt::Unchecked);
+        m_table->setItem(row, 2, notifyItem);
+    }
+
+    QTableWidget *m_table;
+};
 
-void applyExtendedColor(QTextCharFormat &format,
-                        bool isForeground,
-                        const QTextCharFormat &baseFormat,
-                        int mode,
-                        const QList<int> &params,
-                        int &i)
+class MessageFilterDialog : public QDialog
 {
-    if (mode == 5) {
-        if (i + 1 >= params.size()) {
-            return;
-        }
-        const QColor color = colorFrom256Palette(params.at(++i));
-        if (isForeground) {
-            format.setForeground(color);
-        } else {
-            format.setBackground(color);
-        }
-    } else if (mode == 2) {
-        if (i + 3 >= params.size()) {
-            return;
-        }
-        const int r = params.at(++i);
-        const int g = params.at(++i);
-        const int b = params.at(++i);
-        const QColor color(r, g, b);
-        if (!color.isValid()) {
-            return;
-        }
-        if (isForeground) {
-            format.setForeground(color);
-        } else {
-            format.setBackground(color);
-        }
-    } else {
-        if (isForeground) {
-            format.setForeground(baseFormat.foreground());
-        } else {
-            format.setBackground(baseFormat.background());
-        }
-    }
-}
-
-void applySgr(const QList<int> &params,
-              QTextCharFormat &currentFormat,
-              const QTextCharFormat &baseFormat)
-{
-    if (params.isEmpty()) {
-        currentFormat = baseFormat;
-        return;
-    }
-
-    for (int i = 0; i < params.size(); ++i) {
-        const int code = params.at(i);
-        switch (code) {
-        case 0:
-            currentFormat = baseFormat;
-            break;
-        case 1:
-            currentFormat.setFontWeight(QFont::Bold);
-            break;
-        case 3:
-            currentFormat.setFontItalic(true);
-            break;
-        case 4:
-            currentFormat.setFontUnderline(true);
-            break;
-        case 22:
-            currentFormat.setFontWeight(baseFormat.fontWeight());
-            break;
-        case 23:
-            currentFormat.setFontItalic(baseFormat.fontItalic());
-            break;
-        case 24:
-            currentFormat.setFontUnderline(baseFormat.fontUnderline());
-            break;
-        case 30: case 31: case 32: case 33:
-        case 34: case 35: case 36: case 37:
-            currentFormat.setForeground(basicAnsiColor(code - 30, false));
-            break;
-        case 39:
-            currentFormat.setForeground(baseFormat.foreground());
-            break;
-        case 40: case 41: case 42: case 43:
-        case 44: case 45: case 46: case 47:
-            currentFormat.setBackground(basicAnsiColor(code - 40, false));
-            break;
-        case 49:
-            currentFormat.setBackground(baseFormat.background());
-            break;
-        case 90: case 91: case 92: case 93:
-        case 94: case 95: case 96: case 97:
-            currentFormat.setForeground(basicAnsiColor(code - 90, true));
-            break;
-        case 100: case 101: case 102: case 103:
-        case 104: case 105: case 106: case 107:
-            currentFormat.setBackground(basicAnsiColor(code - 100, true));
-            break;
-        case 38:
-        case 48:
-            if (i + 1 < params.size()) {
-                const bool isForeground = (code == 38);
-                const int mode = params.at(++i);
-                applyExtendedColor(currentFormat, isForeground, baseFormat, mode, params, i);
+public:
+    explicit MessageFilterDialog(const FilterSettings &settings, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_systemCombo(createActionCombo(settings.systemAction))
+        , m_joinLeaveCombo(createActionCombo(settings.joinLeaveAction))
+        , m_gameFrameCombo(createActionCombo(settings.gameFrameAction))
+        , m_speakersEdit(new QPlainTextEdit(settings.mutedSpeakers.join(QLatin1Char('\n')), this))
+        , m_keywordsEdit(new QPlainTextEdit(settings.mutedKeywords.join(QLatin1Char('\n')), this))
+        , m_enabled(settings.enabled)
+    {
+        setWindowTitle(tr("Message Filters"));
+        setModal(true);
+
+        auto *formLayout = new QFormLayout();
+        formLayout->addRow(tr("System notices"), m_systemCombo);
+        formLayout->addRow(tr("Join/leave notices"), m_joinLeaveCombo);
+        formLayout->addRow(tr("Game frames"), m_gameFrameCombo);
+        formLayout->addRow(tr("Muted users"), m_speakersEdit);
+        formLayout->addRow(tr("Muted keywords"), m_keywordsEdit);
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+        connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+        auto *layout = new QVBoxLayout(this);
+        layout->addLayout(formLayout);
+        layout->addWidget(new QLabel(tr("One entry per line. Collapse keeps the first line of each run."), this));
+        layout->addWidget(buttonBox);
+    }
+
+    FilterSettings settings() const
+    {
+        FilterSettings settings;
+        settings.systemAction = static_cast<FilterAction>(m_systemCombo->currentData().toInt());
+        settings.joinLeaveAction = static_cast<FilterAction>(m_joinLeaveCombo->currentData().toInt());
+        settings.gameFrameAction = static_cast<FilterAction>(m_gameFrameCombo->currentData().toInt());
+        settings.mutedSpeakers = entries(m_speakersEdit);
+        settings.mutedKeywords = entries(m_keywordsEdit);
+        settings.enabled = m_enabled;
+        return settings;
+    }
+
+private:
+    QComboBox *createActionCombo(FilterAction action)
+    {
+        auto *combo = new QComboBox(this);
+        combo->addItem(tr("Show"), static_cast<int>(FilterAction::Show));
+        combo->addItem(tr("Collapse"), static_cast<int>(FilterAction::Collapse));
+        combo->addItem(tr("Hide"), static_cast<int>(FilterAction::Hide));
+        combo->setCurrentIndex(combo->findData(static_cast<int>(action)));
+        return combo;
+    }
+
+    static QStringList entries(const QPlainTextEdit *edit)
+    {
+        QStringList collected;
+        const QStringList lines = edit->toPlainText().split(QLatin1Char('\n'));
+        for (const QString &line : lines) {
+            const QString entry = line.trimmed();
+            if (!entry.isEmpty()) {
+                collected.append(entry);
             }
-            break;
-        default:
-            break;
         }
+        return collected;
     }
-}
 
-void insertFragmentWithLinks(QTextCursor &cursor,
-                             const QString &text,
-                             const QTextCharFormat &format)
+    QComboBox *m_systemCombo;
+    QComboBox *m_joinLeaveCombo;
+    QComboBox *m_gameFrameCombo;
+    QPlainTextEdit *m_speakersEdit;
+    QPlainTextEdit *m_keywordsEdit;
+    bool m_enabled;
+};
+
+class MessageQueryProxy : public QSortFilterProxyModel
 {
-    if (text.isEmpty()) {
-        return;
+public:
+    explicit MessageQueryProxy(MessageStore *store, QObject *parent = nullptr)
+        : QSortFilterProxyModel(parent)
+        , m_store(store)
+    {
+        setSourceModel(store);
+        connect(store, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+            m_accepted.clear();
+        });
     }
 
-    static const QRegularExpression urlRegex(
-        QStringLiteral(R"((https?://[^\s<>"]+))"));
-
-    int lastIndex = 0;
-    auto it = urlRegex.globalMatch(text);
-    while (it.hasNext()) {
-        const QRegularExpressionMatch match = it.next();
-        const int start = match.capturedStart();
-        if (start > lastIndex) {
-            cursor.insertText(text.mid(lastIndex, start - lastIndex), format);
+    void setQuery(const MessageStore::Query &query)
+    {
+        m_query = query;
+        m_accepted.fill(false, m_store->rowCount());
+        const QVector<int> rows = m_store->select(query);
+        for (const int row : rows) {
+            m_accepted[row] = true;
         }
-
-        const QString url = match.captured();
-        QTextCharFormat linkFormat = format;
-        linkFormat.setAnchor(true);
-        linkFormat.setAnchorHref(url);
-        linkFormat.setFontUnderline(true);
-        linkFormat.setForeground(QBrush(qApp->palette().color(QPalette::Link)));
-        cursor.insertText(url, linkFormat);
-        lastIndex = match.capturedEnd();
+        invalidateFilter();
     }
 
-    if (lastIndex < text.size()) {
-        cursor.insertText(text.mid(lastIndex), format);
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &) const override
+    {
+        if (sourceRow < m_accepted.size()) {
+            return m_accepted.at(sourceRow);
+        }
+        return m_store->matches(sourceRow, m_query);
     }
-}
 
-QVector<FormattedFragment> parseAnsiText(const QString &input,
-                                         const QTextCharFormat &baseFormat)
+private:
+    MessageStore *m_store;
+    MessageStore::Query m_query;
+    QVector<bool> m_accepted;
+};
+
+class MessageBrowserDialog : public QDialog
 {
-    QVector<FormattedFragment> fragments;
-    QTextCharFormat currentFormat = baseFormat;
-    QString buffer;
+public:
+    MessageBrowserDialog(MessageStore *store, std::function<void(int)> jumpToLine, QWidget *parent = nullptr)
+        : QDialog(parent)
+        , m_proxy(new MessageQueryProxy(store, this))
+        , m_handleEdit(new QLineEdit(this))
+        , m_periodCombo(new QComboBox(this))
+        , m_privateCheck(new QCheckBox(tr("Private messages only"), this))
+        , m_countLabel(new QLabel(this))
+        , m_jumpToLine(std::move(jumpToLine))
+    {
+        setWindowTitle(tr("Message Browser"));
+        setModal(true);
+        resize(760, 480);
+
+        m_handleEdit->setPlaceholderText(tr("Any user"));
+        m_periodCombo->addItem(tr("Any time"), 0);
+        m_periodCombo->addItem(tr("Last hour"), 60 * 60);
+        m_periodCombo->addItem(tr("Last 24 hours"), 24 * 60 * 60);
+
+        auto *view = new QTableView(this);
+        view->setModel(m_proxy);
+        view->setSortingEnabled(true);
+        view->setSelectionBehavior(QAbstractItemView::SelectRows);
+        view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        view->verticalHeader()->setVisible(false);
+        view->horizontalHeader()->setSectionResizeMode(MessageStore::BodyColumn, QHeaderView::Stretch);
+
+        auto *queryLayout = new QHBoxLayout();
+        queryLayout->addWidget(new QLabel(tr("From"), this));
+        queryLayout->addWidget(m_handleEdit);
+        queryLayout->addWidget(m_periodCombo);
+        queryLayout->addWidget(m_privateCheck);
+        queryLayout->addStretch();
+        queryLayout->addWidget(m_countLabel);
+
+        auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+        connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
 
-    auto flushBuffer = [&]() {
-        if (buffer.isEmpty()) {
-            return;
-        }
-        fragments.append({buffer, currentFormat});
-        buffer.clear();
-    };
+        auto *layout = new QVBoxLayout(this);
+        layout->addLayout(queryLayout);
+        layout->addWidget(view);
+        layout->addWidget(buttonBox);
 
-    for (int i = 0; i < input.size(); ++i) {
-        const QChar ch = input.at(i);
-        if (ch == QLatin1Char('\x1b')) {
-            flushBuffer();
-            if (i + 1 >= input.size()) {
-                continue;
-            }
-            if (input.at(i + 1) != QLatin1Char('[')) {
-                continue;
-            }
+        connect(m_handleEdit, &QLineEdit::textChanged, this, [this]() { runQuery(); });
+        connect(m_periodCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, [this]() { runQuery(); });
+        connect(m_privateCheck, &QCheckBox::toggled, this, [this]() { runQuery(); });
+        connect(view, &QTableView::doubleClicked, this, [this](const QModelIndex &index) {
+            m_jumpToLine(index.data(MessageStore::LineRole).toInt());
+            accept();
+        });
 
-            int j = i + 2;
-            QString number;
-            QList<int> params;
-            for (; j < input.size(); ++j) {
-                const QChar c = input.at(j);
-                if (c.isDigit()) {
-                    number.append(c);
-                    continue;
-                }
-                if (c == QLatin1Char(';')) {
-                    params.append(number.isEmpty() ? 0 : number.toInt());
-                    number.clear();
-                    continue;
-                }
-                if (c == QLatin1Char('?')) {
-                    continue;
-                }
-                if (!number.isEmpty() || params.isEmpty()) {
-                    params.append(number.isEmpty() ? 0 : number.toInt());
-                    number.clear();
-                }
-                if (c == QLatin1Char('m')) {
-                    applySgr(params, currentFormat, baseFormat);
-                }
-                break;
-            }
-            i = j;
-            continue;
-        }
+        runQuery();
+    }
 
-        if (ch == QLatin1Char('\r')) {
-            if (i + 1 < input.size() && input.at(i + 1) == QLatin1Char('\n')) {
-                continue;
-            }
-            buffer.append(QLatin1Char('\n'));
-            flushBuffer();
-            continue;
+private:
+    void runQuery()
+    {
+        MessageStore::Query query;
+        query.handle = m_handleEdit->text().trimmed();
+        query.privateOnly = m_privateCheck->isChecked();
+        const int period = m_periodCombo->currentData().toInt();
+        if (period > 0) {
+            query.since = QDateTime::currentSecsSinceEpoch() - period;
         }
 
-        if (ch == QLatin1Char('\b')) {
-            if (!buffer.isEmpty()) {
-                buffer.chop(1);
-            }
-            continue;
-        }
+        m_proxy->setQuery(query);
+        m_countLabel->setText(tr("%1 messages").arg(m_proxy->rowCount()));
+    }
 
-        if (ch == QLatin1Char('\a')) {
-            continue;
-        }
+    MessageQueryProxy *m_proxy;
+    QLineEdit *m_handleEdit;
+    QComboBox *m_periodCombo;
+    QCheckBox *m_privateCheck;
+    QLabel *m_countLabel;
+    std::function<void(int)> m_jumpToLine;
+};
+
+FilterSettings loadFilterSettings()
+{
+    QSettings settings;
+    settings.beginGroup(QStringLiteral("messageFilters"));
+    FilterSettings filters;
+    filters.mutedSpeakers = settings.value(QStringLiteral("mutedSpeakers")).toStringList();
+    filters.mutedKeywords = settings.value(QStringLiteral("mutedKeywords")).toStringList();
+    filters.systemAction = static_cast<FilterAction>(
+        settings.value(QStringLiteral("systemAction"), static_cast<int>(FilterAction::Show)).toInt());
+    filters.joinLeaveAction = static_cast<FilterAction>(
+        settings.value(QStringLiteral("joinLeaveAction"), static_cast<int>(FilterAction::Show)).toInt());
+    filters.gameFrameAction = static_cast<FilterAction>(
+        settings.value(QStringLiteral("gameFrameAction"), static_cast<int>(FilterAction::Show)).toInt());
+    filters.enabled = settings.value(QStringLiteral("enabled"), true).toBool();
+    settings.endGroup();
+    return filters;
+}
+
+void saveFilterSettings(const FilterSettings &filters)
+{
+    QSettings settings;
+    settings.beginGroup(QStringLiteral("messageFilters"));
+    settings.setValue(QStringLiteral("mutedSpeakers"), filters.mutedSpeakers);
+    settings.setValue(QStringLiteral("mutedKeywords"), filters.mutedKeywords);
+    settings.setValue(QStringLiteral("systemAction"), static_cast<int>(filters.systemAction));
+    settings.setValue(QStringLiteral("joinLeaveAction"), static_cast<int>(filters.joinLeaveAction));
+    settings.setValue(QStringLiteral("gameFrameAction"), static_cast<int>(filters.gameFrameAction));
+    settings.setValue(QStringLiteral("enabled"), filters.enabled);
+    settings.endGroup();
+}
 
-        buffer.append(ch);
+QVector<HighlightRule> loadHighlightRules()
+{
+    QVector<HighlightRule> rules;
+    QSettings settings;
+    const int count = settings.beginReadArray(QStringLiteral("highlightRules"));
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        HighlightRule rule;
+        rule.pattern = settings.value(QStringLiteral("pattern")).toString();
+        rule.color = QColor(settings.value(QStringLiteral("color")).toString());
+        rule.notify = settings.value(QStringLiteral("notify"), false).toBool();
+        rule.wholeWord = settings.value(QStringLiteral("wholeWord"), true).toBool();
+        if (!rule.pattern.isEmpty()) {
+            rules.append(rule);
+        }
     }
+    settings.endArray();
+    return rules;
+}
 
-    flushBuffer();
-    return fragments;
+void saveHighlightRules(const QVector<HighlightRule> &rules)
+{
+    QSettings settings;
+    settings.beginWriteArray(QStringLiteral("highlightRules"), rules.size());
+    for (int i = 0; i < rules.size(); ++i) {
+        const HighlightRule &rule = rules.at(i);
+        settings.setArrayIndex(i);
+        settings.setValue(QStringLiteral("pattern"), rule.pattern);
+        settings.setValue(QStringLiteral("color"), rule.color.isValid() ? rule.color.name() : QString());
+        settings.setValue(QStringLiteral("notify"), rule.notify);
+        settings.setValue(QStringLiteral("wholeWord"), rule.wholeWord);
+    }
+    settings.endArray();
 }
 
 QString formatCommand(const CommandDescriptor &descriptor, const QString &argument)
@@ -533,10 +1010,19 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_connectAction(nullptr)
     , m_disconnectAction(nullptr)
+    , m_filtersAction(nullptr)
+    , m_trayIcon(nullptr)
+    , m_highlightRules(loadHighlightRules())
+    , m_historyFlushTimer(new QTimer(this))
+    , m_filterFlushTimer(new QTimer(this))
+    , m_artLibrary(new AsciiArtLibrary(this))
+    , m_artAutoSaveAction(nullptr)
+    , m_historyLoadedFrom(0)
     , m_isConnected(false)
     , m_nicknameConfirmed(false)
 {
     m_client = new ChatterClient(this);
+    m_client->setLatencyProbe(&m_latencyProbe);
 
     QFont retroFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
     retroFont.setPointSizeF(10.0);
@@ -545,32 +1031,76 @@ MainWindow::MainWindow(QWidget *parent)
     m_terminal = new TerminalWidget(this);
     if (m_terminal) {
         m_terminal->setTerminalFont(retroFont);
+        m_terminal->setLatencyProbe(&m_latencyProbe);
+        m_terminal->setEchoCheck([this]() {
+            return !m_client || m_client->isEchoEnabled();
+        });
     }
     setCentralWidget(m_terminal);
 
     m_display = m_terminal ? m_terminal->display() : nullptr;
     if (m_display) {
-        m_display->setReadOnly(true);
         m_display->setOpenLinks(true);
         m_display->setOpenExternalLinks(true);
-        m_display->setLineWrapMode(QTextEdit::NoWrap);
-        m_display->setWordWrapMode(QTextOption::NoWrap);
-        m_display->setUndoRedoEnabled(false);
-
-        QTextOption textOption = m_display->document()->defaultTextOption();
-        textOption.setFlags(textOption.flags() & ~QTextOption::AddSpaceForLineAndParagraphSeparators);
-        m_display->document()->setDefaultTextOption(textOption);
     }
 
     if (m_terminal) {
         connect(m_terminal.data(), &TerminalWidget::bytesGenerated,
                 this, &MainWindow::handleTerminalInput);
+        connect(m_terminal.data(), &TerminalWidget::keysGenerated,
+                this, &MainWindow::handleTerminalKeys);
         connect(m_terminal.data(), &TerminalWidget::terminalSizeChanged,
                 this, &MainWindow::handleTerminalSizeChanged);
+        connect(m_terminal.data(), &TerminalWidget::historyRequested,
+                this, &MainWindow::loadOlderHistory);
+        connect(m_terminal.data(), &TerminalWidget::mentionDetected,
+                this, &MainWindow::handleMention);
+        updateHighlightRules();
     }
 
+    m_historyFlushTimer->setInterval(kHistoryFlushIntervalMs);
+    connect(m_historyFlushTimer, &QTimer::timeout, this, [this]() {
+        m_history.flush();
+    });
+
+    m_filterFlushTimer->setSingleShot(true);
+    m_filterFlushTimer->setInterval(kFilterFlushDelayMs);
+    connect(m_filterFlushTimer, &QTimer::timeout, this, [this]() {
+        const QString shown = m_filter.flushPending();
+        if (!shown.isEmpty()) {
+            appendMessage(shown);
+        }
+        updateFilterStatus();
+    });
+
     m_statusLabel = new QLabel(this);
     statusBar()->addWidget(m_statusLabel);
+    m_filterLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_filterLabel);
+    m_outboundLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_outboundLabel);
+
+    m_filter.setSettings(loadFilterSettings());
+
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (!dataDir.isEmpty()) {
+        m_artLibrary->open(QDir(dataDir).filePath(QStringLiteral("ascii-art")));
+    }
+    connect(m_artLibrary, &AsciiArtLibrary::stored, this, [this](const QString &, bool duplicate, const QString &error) {
+        if (!error.isEmpty()) {
+            statusBar()->showMessage(tr("Library save failed: %1").arg(error), 5000);
+        } else {
+            statusBar()->showMessage(duplicate ? tr("ASCII art is already in the library")
+                                               : tr("Saved ASCII art to the library"), 3000);
+        }
+    });
+    connect(m_artLibrary, &AsciiArtLibrary::saved, this, [this](const QString &filePath, bool success, const QString &error) {
+        if (success) {
+            statusBar()->showMessage(tr("Saved ASCII art to %1").arg(QDir::toNativeSeparators(filePath)), 5000);
+        } else {
+            statusBar()->showMessage(tr("Couldn't save %1: %2").arg(QDir::toNativeSeparators(filePath), error), 5000);
+        }
+    });
 
     createMenus();
     applyRetroPalette();
@@ -585,19 +1115,58 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::handleClientError);
     connect(m_client.data(), &ChatterClient::connectionStateChanged,
             this, &MainWindow::handleConnectionStateChanged);
+    connect(m_client.data(), &ChatterClient::outboundStatsChanged,
+            this, &MainWindow::updateOutboundStatus);
+
+    QTimer::singleShot(0, this, [this]() {
+        if (ensureNickname(true)) {
+            initiateConnection();
+        } else if (m_statusLabel) {
+            m_statusLabel->setText(tr("Set a nickname to connect"));
+        }
+    });
+}
+
+MainWindow::~MainWindow()
+{
+    if (m_client) {
+        m_client->setLatencyProbe(nullptr);
+    }
+    if (m_terminal) {
+        m_terminal->setLatencyProbe(nullptr);
+    }
+    if (m_exporter) {
+        m_exporter->cancel();
+    }
+    if (m_exportThread) {
+        m_exportThread->quit();
+        m_exportThread->wait();
+    }
+}
 
-    QTimer::singleShot(0, this, [this]() {
-        if (ensureNickname(true)) {
-            initiateConnection();
-        } else if (m_statusLabel) {
-            m_statusLabel->setText(tr("Set a nickname to connect"));
-        }
-    });
+bool MainWindow::event(QEvent *event)
+{
+    // Widgets paint a frame while the window handles this; document layout
+    // is traced where output is inserted.
+    if (event->type() == QEvent::UpdateRequest) {
+        const TraceScope trace("paint");
+        return QMainWindow::event(event);
+    }
+    return QMainWindow::event(event);
 }
 
 void MainWindow::handleClientOutput(const QString &text)
 {
-    appendMessage(text);
+    if (m_terminal) {
+        m_terminal->receiveOutput(text, &m_filter, &m_history);
+    }
+    if (!m_filter.hasUndecidedLine()) {
+        m_filterFlushTimer->stop();
+    } else if (!m_filterFlushTimer->isActive()) {
+        m_filterFlushTimer->start();
+    }
+    m_latencyProbe.mark(LatencyStage::Parse);
+    updateFilterStatus();
 }
 
 void MainWindow::handleClientError(const QString &text)
@@ -611,6 +1180,9 @@ void MainWindow::handleConnectionStateChanged(bool connected)
         m_statusLabel->setText(tr("Connected as %1").arg(m_client->username()));
     } else {
         m_statusLabel->setText(tr("Disconnected"));
+        if (m_terminal) {
+            m_terminal->resetInputModes();
+        }
     }
     m_isConnected = connected;
     m_connectAction->setEnabled(!connected);
@@ -633,7 +1205,15 @@ void MainWindow::handleCommandActionTriggered()
         return;
     }
 
-    const CommandDescriptor descriptor = data.value<CommandDescriptor>();
+    runCommand(data.value<CommandDescriptor>());
+}
+
+void MainWindow::runCommand(const CommandDescriptor &descriptor)
+{
+    if (!m_client) {
+        return;
+    }
+
     if (descriptor.command == QStringLiteral("/asciiart")) {
         openAsciiArtComposer();
         return;
@@ -641,13 +1221,61 @@ void MainWindow::handleCommandActionTriggered()
 
     QString argument;
     if (CommandCatalog::requiresUserInput(descriptor)) {
-        argument = promptForArgument(descriptor.placeholderHint);
+        argument = promptForArgument(descriptor.placeholderHint,
+                                     CommandCatalog::indexOf(descriptor.command.section(QLatin1Char(' '), 0, 0)));
         if (argument.isEmpty()) {
             return;
         }
     }
 
-    m_client->sendCommand(formatCommand(descriptor, argument));
+    const QString command = formatCommand(descriptor, argument);
+    rememberCommand(command);
+    m_client->sendCommand(command);
+}
+
+void MainWindow::rememberCommand(const QString &command)
+{
+    if (m_terminal) {
+        m_terminal->commandHistory()->add(command);
+    }
+}
+
+void MainWindow::openCommandPalette()
+{
+    const QVector<CommandDescriptor> descriptors = CommandCatalog::allCommands();
+    const QStringList recentCommands = m_terminal
+        ? m_terminal->commandHistory()->recent(kRecentCommandLimit, QStringLiteral("/"))
+        : QStringList();
+
+    QVector<PaletteEntry> entries;
+    entries.reserve(recentCommands.size() + descriptors.size());
+    for (const QString &command : recentCommands) {
+        entries.append(PaletteEntry{command, tr("recent")});
+    }
+    for (const CommandDescriptor &descriptor : descriptors) {
+        entries.append(PaletteEntry{descriptor.label, descriptor.command.section(QLatin1Char(' '), 0, 0)});
+    }
+
+    CommandPalette palette(this);
+    palette.setEntries(entries);
+    if (palette.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    const int selected = palette.selectedEntry();
+    const int recentCount = static_cast<int>(recentCommands.size());
+    if (selected < 0) {
+        return;
+    }
+    if (selected < recentCount) {
+        const QString command = recentCommands.at(selected);
+        if (m_client) {
+            rememberCommand(command);
+            m_client->sendCommand(command);
+        }
+        return;
+    }
+    runCommand(descriptors.at(selected - recentCount));
 }
 
 void MainWindow::handleTerminalInput(const QByteArray &data)
@@ -656,7 +1284,16 @@ void MainWindow::handleTerminalInput(const QByteArray &data)
         return;
     }
 
-    m_client->sendRawData(data);
+    m_client->sendRawData(data, OutboundPriority::Line);
+}
+
+void MainWindow::handleTerminalKeys(const QByteArray &data)
+{
+    if (!m_client || data.isEmpty()) {
+        return;
+    }
+
+    m_client->sendRawData(data, OutboundPriority::Interactive);
 }
 
 void MainWindow::handleTerminalSizeChanged(int columns, int rows)
@@ -680,6 +1317,8 @@ void MainWindow::initiateConnection()
         return;
     }
     if (m_client) {
+        openHistory();
+        openCommandHistory();
         m_client->start();
     }
 }
@@ -717,6 +1356,73 @@ void MainWindow::changeNickname()
     }
 }
 
+void MainWindow::exportTranscript()
+{
+    if (m_exportThread) {
+        statusBar()->showMessage(tr("An export is already running"), 3000);
+        return;
+    }
+
+    const QString documentsDir = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    const QString basePath = documentsDir.isEmpty() ? QDir::homePath() : documentsDir;
+    const QString plainFilter = tr("Plain Text (*.txt)");
+    const QString ansiFilter = tr("ANSI Text (*.ans)");
+    const QString htmlFilter = tr("HTML (*.html)");
+
+    QString selectedFilter = plainFilter;
+    const QString filePath = QFileDialog::getSaveFileName(this,
+                                                          tr("Export Transcript"),
+                                                          QDir(basePath).filePath(QStringLiteral("chatter-transcript.txt")),
+                                                          QStringList({plainFilter, ansiFilter, htmlFilter}).join(QStringLiteral(";;")),
+                                                          &selectedFilter);
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    ScrollbackExporter::Format format = ScrollbackExporter::Format::PlainText;
+    if (selectedFilter == ansiFilter || filePath.endsWith(QStringLiteral(".ans"), Qt::CaseInsensitive)) {
+        format = ScrollbackExporter::Format::Ansi;
+    } else if (selectedFilter == htmlFilter || filePath.endsWith(QStringLiteral(".html"), Qt::CaseInsensitive)) {
+        format = ScrollbackExporter::Format::Html;
+    }
+
+    auto *progress = new QProgressDialog(tr("Exporting transcript..."), tr("Cancel"), 0,
+                                         std::max(1, m_filter.lineCount()), this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+
+    m_exportThread = new QThread(this);
+    m_exporter = new ScrollbackExporter(m_filter, format, filePath);
+    m_exporter->moveToThread(m_exportThread);
+
+    connect(m_exportThread, &QThread::started, m_exporter.data(), &ScrollbackExporter::run);
+    connect(m_exportThread, &QThread::finished, m_exporter.data(), &QObject::deleteLater);
+    connect(m_exportThread, &QThread::finished, m_exportThread.data(), &QObject::deleteLater);
+    connect(m_exporter.data(), &ScrollbackExporter::progressChanged, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, this, [this]() {
+        if (m_exporter) {
+            m_exporter->cancel();
+        }
+    });
+    connect(m_exporter.data(), &ScrollbackExporter::finished, this,
+            [this, dialog = QPointer<QProgressDialog>(progress), filePath](bool success, const QString &error) {
+        if (dialog) {
+            dialog->close();
+        }
+        if (m_exportThread) {
+            m_exportThread->quit();
+        }
+        if (success) {
+            statusBar()->showMessage(tr("Exported transcript to %1").arg(QDir::toNativeSeparators(filePath)), 5000);
+        } else {
+            statusBar()->showMessage(tr("Export failed: %1").arg(error), 5000);
+        }
+    });
+
+    m_exportThread->start();
+}
+
 void MainWindow::openAppearanceSettings()
 {
     if (!m_terminal) {
@@ -745,13 +1451,95 @@ void MainWindow::createMenus()
     auto *sessionMenu = menuBar()->addMenu(tr("Session"));
     m_connectAction = sessionMenu->addAction(tr("Connect"), this, &MainWindow::initiateConnection);
     sessionMenu->addAction(tr("Set Nickname..."), this, &MainWindow::changeNickname);
+    sessionMenu->addAction(tr("Export Transcript..."), this, &MainWindow::exportTranscript);
+    sessionMenu->addAction(tr("ASCII Art Library..."), this, &MainWindow::openAsciiArtLibrary);
+    m_artAutoSaveAction = sessionMenu->addAction(tr("Auto-save ASCII Art to Library"));
+    m_artAutoSaveAction->setCheckable(true);
+    m_artAutoSaveAction->setChecked(QSettings().value(QStringLiteral("asciiArt/autoSave"), false).toBool());
+    connect(m_artAutoSaveAction, &QAction::toggled, this, [](bool enabled) {
+        QSettings().setValue(QStringLiteral("asciiArt/autoSave"), enabled);
+    });
+    auto *historyMenu = sessionMenu->addMenu(tr("Save Command History"));
+    auto *historyGroup = new QActionGroup(historyMenu);
+    const QString savedPersistence = QSettings().value(QStringLiteral("history/persistCommands"),
+                                                       QStringLiteral("all")).toString();
+    const QList<QPair<QString, QString>> persistenceModes = {
+        {QStringLiteral("all"), tr("All Lines")},
+        {QStringLiteral("commands"), tr("Commands Only")},
+        {QStringLiteral("off"), tr("Off")},
+    };
+    for (const auto &mode : persistenceModes) {
+        QAction *action = historyMenu->addAction(mode.second);
+        action->setCheckable(true);
+        action->setChecked(mode.first == savedPersistence);
+        historyGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, value = mode.first]() {
+            QSettings().setValue(QStringLiteral("history/persistCommands"), value);
+            applyHistoryPersistence();
+        });
+    }
+    applyHistoryPersistence();
     m_disconnectAction = sessionMenu->addAction(tr("Disconnect"), this, &MainWindow::stopConnection);
     m_disconnectAction->setEnabled(false);
 
     auto *viewMenu = menuBar()->addMenu(tr("View"));
     viewMenu->addAction(tr("Font && Appearance..."), this, &MainWindow::openAppearanceSettings);
 
+    QAction *findAction = viewMenu->addAction(tr("Find in Scrollback..."));
+    findAction->setShortcut(QKeySequence::Find);
+    connect(findAction, &QAction::triggered, this, [this]() {
+        if (m_terminal) {
+            m_terminal->showFindBar();
+        }
+    });
+    viewMenu->addAction(tr("Jump to Message..."), this, &MainWindow::jumpToMessage);
+    viewMenu->addAction(tr("Message Browser..."), this, &MainWindow::openMessageBrowser);
+    viewMenu->addAction(tr("Highlight Rules..."), this, &MainWindow::openHighlightRules);
+    viewMenu->addAction(tr("Message Filters..."), this, &MainWindow::openMessageFilters);
+    m_filtersAction = viewMenu->addAction(tr("Apply Filters"));
+    m_filtersAction->setCheckable(true);
+    m_filtersAction->setChecked(m_filter.settings().enabled);
+    connect(m_filtersAction, &QAction::toggled, this, &MainWindow::setFiltersEnabled);
+
+    QAction *rawModeAction = viewMenu->addAction(tr("Raw Keyboard Mode"));
+    rawModeAction->setCheckable(true);
+    rawModeAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_R));
+    if (m_terminal) {
+        connect(rawModeAction, &QAction::toggled, m_terminal.data(), &TerminalWidget::setRawMode);
+        connect(m_terminal.data(), &TerminalWidget::rawModeChanged, rawModeAction, [rawModeAction](bool enabled) {
+            const QSignalBlocker blocker(rawModeAction);
+            rawModeAction->setChecked(enabled);
+        });
+    }
+
+    viewMenu->addAction(tr("Latency Diagnostics..."), this, &MainWindow::openLatencyDiagnostics);
+    if (TraceRecorder::isEnabled()) {
+        viewMenu->addAction(tr("Export Trace..."), this, &MainWindow::exportTrace);
+    }
+    QAction *perfOverlayAction = viewMenu->addAction(tr("Performance HUD"));
+    perfOverlayAction->setCheckable(true);
+    perfOverlayAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_H));
+    if (m_terminal) {
+        connect(perfOverlayAction, &QAction::toggled, m_terminal.data(), &TerminalWidget::setPerfOverlayVisible);
+    }
+
+    QAction *predictiveEchoAction = viewMenu->addAction(tr("Predictive Echo"));
+    predictiveEchoAction->setCheckable(true);
+    predictiveEchoAction->setChecked(QSettings().value(QStringLiteral("terminal/predictiveEcho"), true).toBool());
+    if (m_terminal) {
+        m_terminal->setPredictiveEcho(predictiveEchoAction->isChecked());
+    }
+    connect(predictiveEchoAction, &QAction::toggled, this, [this](bool enabled) {
+        QSettings().setValue(QStringLiteral("terminal/predictiveEcho"), enabled);
+        if (m_terminal) {
+            m_terminal->setPredictiveEcho(enabled);
+        }
+    });
+
     auto *commandsMenu = menuBar()->addMenu(tr("Commands"));
+    QAction *paletteAction = commandsMenu->addAction(tr("Command Palette..."), this, &MainWindow::openCommandPalette);
+    paletteAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_K));
+    commandsMenu->addSeparator();
     populateCommandMenu(commandsMenu);
 }
 
@@ -767,88 +1555,312 @@ void MainWindow::populateCommandMenu(QMenu *menu)
 
 void MainWindow::appendMessage(const QString &text, bool isError)
 {
-    if (!m_display) {
-        return;
+    if (m_terminal) {
+        m_terminal->appendOutput(text, isError);
     }
+}
 
-    QString sanitized = text;
-    sanitized.replace("\r\n", "\n");
-
-    const bool hadTrailingNewline = sanitized.endsWith(QLatin1Char('\n'));
-    if (hadTrailingNewline) {
-        sanitized.chop(1);
+void MainWindow::prependHistoryLines(const QStringList &lines)
+{
+    if (!m_display || !m_terminal || lines.isEmpty()) {
+        return;
     }
 
-    const bool hasContent = !sanitized.isEmpty();
-
-    QTextCharFormat baseFormat;
-    baseFormat.setForeground(isError ? QBrush(Qt::red)
-                                    : QBrush(m_display->palette().color(QPalette::Text)));
-    baseFormat.setBackground(Qt::NoBrush);
-    baseFormat.setFont(m_display->font());
-    baseFormat.setFontWeight(QFont::Normal);
-    baseFormat.setFontItalic(false);
-    baseFormat.setFontUnderline(false);
-
-    const QVector<FormattedFragment> fragments = parseAnsiText(sanitized, baseFormat);
-
-    QTextCursor cursor = m_display->textCursor();
-    cursor.movePosition(QTextCursor::End);
+    const QTextCharFormat baseFormat = m_terminal->baseTextFormat(false);
 
     QTextBlockFormat blockFormat;
     blockFormat.setTopMargin(0);
     blockFormat.setBottomMargin(0);
     blockFormat.setLineHeight(100, QTextBlockFormat::ProportionalHeight);
 
-    auto applyBlockFormat = [&]() {
-        cursor.setBlockFormat(blockFormat);
-    };
+    QScrollBar *scrollBar = m_display->verticalScrollBar();
+    const int distanceFromBottom = scrollBar->maximum() - scrollBar->value();
 
+    QStringList plainLines;
+    plainLines.reserve(lines.size());
+
+    QTextCursor cursor(m_display->document());
+    cursor.movePosition(QTextCursor::Start);
     cursor.beginEditBlock();
-    applyBlockFormat();
+    for (const QString &line : lines) {
+        QVector<FormattedFragment> fragments = AnsiText::parse(line, baseFormat);
+        QString plain;
+        for (auto &fragment : fragments) {
+            fragment.text.remove(QLatin1Char('\n'));
+            plain.append(fragment.text);
+        }
+        const DocumentWriter::Overlays highlights = m_terminal->highlightLine(plain);
 
-    for (const auto &fragment : fragments) {
-        const QString &fragmentText = fragment.text;
-        int position = 0;
+        cursor.setBlockFormat(blockFormat);
+        int offset = 0;
+        for (const auto &fragment : fragments) {
+            DocumentWriter::insertFragmentWithLinks(cursor, fragment.text, fragment.format, highlights, offset);
+            offset += static_cast<int>(fragment.text.size());
+        }
+        cursor.insertBlock();
+        plainLines.append(plain);
+    }
+    m_terminal->linesPrepended(plainLines);
+    cursor.endEditBlock();
 
-        while (position <= fragmentText.size()) {
-            const int newlineIndex = fragmentText.indexOf(QLatin1Char('\n'), position);
-            const bool hasNewline = newlineIndex != -1;
-            const int chunkEnd = hasNewline ? newlineIndex : fragmentText.size();
+    scrollBar->setValue(scrollBar->maximum() - distanceFromBottom);
+}
 
-            if (chunkEnd > position) {
-                const QString chunk = fragmentText.mid(position, chunkEnd - position);
-                applyBlockFormat();
-                insertFragmentWithLinks(cursor, chunk, fragment.format);
-            }
+void MainWindow::openHistory()
+{
+    if (!m_client || qEnvironmentVariableIsSet("CHATTER_FRONTEND_DISABLE_HISTORY")) {
+        return;
+    }
 
-            if (hasNewline) {
-                cursor.insertBlock();
-                applyBlockFormat();
-                position = newlineIndex + 1;
-                continue;
-            }
+    const QString key = HistoryStore::sanitizedKey(m_client->host(), m_client->username());
+    if (m_history.isOpen() && m_history.key() == key) {
+        return;
+    }
+
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataDir.isEmpty() || !m_history.open(QDir(dataDir).filePath(QStringLiteral("history")), key)) {
+        m_historyFlushTimer->stop();
+        return;
+    }
+    m_historyFlushTimer->start();
+
+    const bool displayIsEmpty = m_display && m_display->document()->isEmpty();
+    if (!displayIsEmpty || !m_terminal) {
+        m_historyLoadedFrom = 0;
+        return;
+    }
+
+    const int rows = std::max(1, m_terminal->computeTerminalSize().height());
+    const int total = m_history.mappedLineCount();
+    m_historyLoadedFrom = std::max(0, total - rows * kHistoryRestoreScreens);
+
+    const QStringList lines = m_history.readLines(m_historyLoadedFrom, total - m_historyLoadedFrom);
+    if (!lines.isEmpty()) {
+        const QSignalBlocker blocker(m_terminal.data());
+        m_terminal->setReplayingHistory(true);
+        appendMessage(m_filter.process(lines.join(QLatin1Char('\n')) + QLatin1Char('\n')) + QLatin1Char('\n'));
+        m_terminal->setReplayingHistory(false);
+        updateFilterStatus();
+    }
+}
+
+void MainWindow::openCommandHistory()
+{
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (!m_terminal || !m_client || dataDir.isEmpty()) {
+        return;
+    }
+
+    const QString key = HistoryStore::sanitizedKey(m_client->host(), m_client->username());
+    if (key == m_commandHistoryKey) {
+        return;
+    }
+    m_commandHistoryKey = key;
+    m_terminal->commandHistory()->open(QDir(dataDir).filePath(QStringLiteral("commands")), key);
+}
+
+void MainWindow::applyHistoryPersistence()
+{
+    if (!m_terminal) {
+        return;
+    }
+
+    const QString mode = QSettings().value(QStringLiteral("history/persistCommands"), QStringLiteral("all")).toString();
+    m_terminal->commandHistory()->setPersistence(mode == QStringLiteral("off")
+                                                     ? CommandHistory::Persistence::Off
+                                                     : mode == QStringLiteral("commands")
+                                                     ? CommandHistory::Persistence::CommandsOnly
+                                                     : CommandHistory::Persistence::All);
+}
+
+void MainWindow::loadOlderHistory()
+{
+    if (!m_history.isOpen() || m_historyLoadedFrom <= 0 || m_filter.isFull()) {
+        return;
+    }
+
+    const int first = std::max(0, m_historyLoadedFrom - kHistoryPageLines);
+    const QStringList lines = m_history.readLines(first, m_historyLoadedFrom - first);
+    m_historyLoadedFrom = first;
+    prependHistoryLines(m_filter.prependLines(lines));
+    updateFilterStatus();
+}
+
+void MainWindow::jumpToMessage()
+{
+    if (!m_terminal) {
+        return;
+    }
+
+    QString id = promptForArgument(tr("message-id")).trimmed();
+    if (id.startsWith(QLatin1Char('#'))) {
+        id.remove(0, 1);
+    }
+    if (id.isEmpty()) {
+        return;
+    }
+
+    if (!m_terminal->jumpToMessage(id)) {
+        statusBar()->showMessage(tr("Message %1 is not in the scrollback").arg(id), 3000);
+    }
+}
+
+void MainWindow::openMessageBrowser()
+{
+    if (!m_terminal) {
+        return;
+    }
 
-            break;
+    MessageBrowserDialog dialog(m_terminal->messages(), [this](int line) {
+        if (m_terminal) {
+            m_terminal->jumpToLine(line);
         }
+    }, this);
+    dialog.exec();
+}
+
+void MainWindow::openHighlightRules()
+{
+    HighlightRulesDialog dialog(m_highlightRules, this);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
     }
 
-    cursor.endEditBlock();
-    m_display->setTextCursor(cursor);
-    m_display->ensureCursorVisible();
+    m_highlightRules = dialog.rules();
+    saveHighlightRules(m_highlightRules);
+    updateHighlightRules();
+    statusBar()->showMessage(tr("Highlight rules updated"), 2000);
 }
 
-QString MainWindow::promptForArgument(const QString &hint) const
+void MainWindow::openMessageFilters()
 {
-    bool ok = false;
-    const QString value = QInputDialog::getText(const_cast<MainWindow *>(this),
-                                                tr("Command Argument"),
-                                                hint,
-                                                QLineEdit::Normal,
-                                                QString(),
-                                                &ok);
-    if (ok) {
-        return value;
+    MessageFilterDialog dialog(m_filter.settings(), this);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    m_filter.setSettings(dialog.settings());
+    saveFilterSettings(m_filter.settings());
+    rerenderScrollback();
+    statusBar()->showMessage(tr("Message filters updated"), 2000);
+}
+
+void MainWindow::setFiltersEnabled(bool enabled)
+{
+    FilterSettings settings = m_filter.settings();
+    if (settings.enabled == enabled) {
+        return;
+    }
+
+    settings.enabled = enabled;
+    m_filter.setSettings(settings);
+    saveFilterSettings(settings);
+    rerenderScrollback();
+}
+
+void MainWindow::rerenderScrollback()
+{
+    if (!m_display || !m_terminal) {
+        return;
+    }
+
+    QString text = m_filter.renderAll();
+    if (text.endsWith(QLatin1Char('\n'))) {
+        text.append(QLatin1Char('\n'));
+    }
+    const QSignalBlocker blocker(m_terminal.data());
+    m_display->clear();
+    m_terminal->resetScrollback();
+    m_terminal->setReplayingHistory(true);
+    appendMessage(text);
+    m_terminal->setReplayingHistory(false);
+    updateFilterStatus();
+}
+
+void MainWindow::updateFilterStatus()
+{
+    if (!m_filterLabel) {
+        return;
+    }
+
+    const quint64 hidden = m_filter.isActive() ? m_filter.hiddenLineCount() : 0;
+    m_filterLabel->setText(hidden > 0 ? tr("%1 lines filtered").arg(hidden) : QString());
+}
+
+void MainWindow::updateOutboundStatus()
+{
+    if (!m_outboundLabel || !m_client) {
+        return;
+    }
+
+    const QString names[kOutboundPriorityCount] = {tr("keys"), tr("lines"), tr("bulk")};
+    QStringList details;
+    int queued = 0;
+    for (int i = 0; i < kOutboundPriorityCount; ++i) {
+        const OutboundStats stats = m_client->outboundStats(static_cast<OutboundPriority>(i));
+        const qint64 average = stats.sent > 0 ? stats.totalLatencyMs / qint64(stats.sent) : 0;
+        queued += stats.depth;
+        details.append(tr("%1: %2 queued, %3 sent, %4 ms avg, %5 ms max")
+                           .arg(names[i])
+                           .arg(stats.depth)
+                           .arg(stats.sent)
+                           .arg(average)
+                           .arg(stats.maxLatencyMs));
+    }
+    if (m_terminal) {
+        const EchoPredictionStats echo = m_terminal->echoStats();
+        details.append(tr("echo: %1 confirmed, %2 mispredicted, %3 abandoned, %4 ms smoothed")
+                           .arg(echo.confirmed)
+                           .arg(echo.mispredicted)
+                           .arg(echo.abandoned)
+                           .arg(echo.smoothedLatencyMs));
+    }
+
+    PerfCounters::instance().outboundDepth.store(queued, std::memory_order_relaxed);
+    m_outboundLabel->setText(queued > 0 ? tr("%1 queued").arg(queued) : QString());
+    m_outboundLabel->setToolTip(details.join(QLatin1Char('\n')));
+}
+
+void MainWindow::handleMention(const QString &text)
+{
+    QApplication::alert(this);
+    if (isActiveWindow() || !QSystemTrayIcon::isSystemTrayAvailable()) {
+        return;
+    }
+
+    if (!m_trayIcon) {
+        m_trayIcon = new QSystemTrayIcon(style()->standardIcon(QStyle::SP_MessageBoxInformation), this);
+        m_trayIcon->show();
+    }
+    if (QSystemTrayIcon::supportsMessages()) {
+        m_trayIcon->showMessage(tr("Mentioned in chat"), text.trimmed());
+    }
+}
+
+void MainWindow::updateHighlightRules()
+{
+    if (!m_terminal) {
+        return;
+    }
+
+    QVector<HighlightRule> rules;
+    const QString nickname = m_client ? m_client->username().trimmed() : QString();
+    if (!nickname.isEmpty()) {
+        HighlightRule nicknameRule;
+        nicknameRule.pattern = nickname;
+        nicknameRule.color = AnsiText::basicColor(1, false);
+        nicknameRule.notify = true;
+        rules.append(nicknameRule);
+    }
+    rules.append(m_highlightRules);
+    m_terminal->setHighlightRules(rules);
+}
+
+QString MainWindow::promptForArgument(const QString &hint, int commandIndex) const
+{
+    ArgumentDialog dialog(hint, commandIndex, const_cast<MainWindow *>(this));
+    if (dialog.exec() == QDialog::Accepted) {
+        return dialog.value();
     }
     return QString();
 }
@@ -889,6 +1901,7 @@ bool MainWindow::ensureNickname(bool forcePrompt)
 
         m_client->setUsername(nickname);
         m_nicknameConfirmed = true;
+        updateHighlightRules();
         if (m_statusLabel && !m_isConnected) {
             m_statusLabel->setText(tr("Ready as %1").arg(nickname));
         }
@@ -919,11 +1932,44 @@ void MainWindow::sendAsciiArtLines(const QStringList &lines)
         return;
     }
 
-    m_client->sendCommand(QStringLiteral("/asciiart"));
-    for (const QString &line : lines) {
-        m_client->sendCommand(line);
+    QStringList batch{QStringLiteral("/asciiart")};
+    batch.append(lines);
+    const quint64 batchId = m_client->sendLineBatch(batch, QStringLiteral(">/__ARTWORK_END>"));
+    if (batchId == 0) {
+        return;
     }
-    m_client->sendCommand(QStringLiteral(">/__ARTWORK_END>"));
+
+    auto *progress = new QProgressDialog(tr("Submitting ASCII art..."), tr("Cancel"), 0, 1, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(m_client.data(), &ChatterClient::batchProgress, progress,
+            [progress, batchId](quint64 id, qint64 written, qint64 total) {
+        if (id == batchId) {
+            progress->setMaximum(static_cast<int>(total));
+            progress->setValue(static_cast<int>(written));
+        }
+    });
+    connect(progress, &QProgressDialog::canceled, this, [this, batchId]() {
+        if (m_client) {
+            m_client->cancelBatch(batchId);
+        }
+    });
+    connect(m_client.data(), &ChatterClient::batchFinished, progress,
+            [this, progress, batchId](quint64 id, bool delivered) {
+        if (id != batchId) {
+            return;
+        }
+        if (progress->wasCanceled()) {
+            statusBar()->showMessage(tr("ASCII art submission cancelled"), 3000);
+        } else if (delivered) {
+            statusBar()->showMessage(tr("ASCII art submitted"), 3000);
+        } else {
+            statusBar()->showMessage(tr("ASCII art submission failed"), 5000);
+        }
+        progress->close();
+    });
 }
 
 void MainWindow::saveAsciiArtLocally(const QStringList &lines)
@@ -932,6 +1978,11 @@ void MainWindow::saveAsciiArtLocally(const QStringList &lines)
         return;
     }
 
+    if (m_artAutoSaveAction && m_artAutoSaveAction->isChecked() && !m_artLibrary->directory().isEmpty()) {
+        m_artLibrary->store(lines);
+        return;
+    }
+
     const QString documentsDir = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
     QString basePath = documentsDir.isEmpty() ? QDir::homePath() : documentsDir;
     if (basePath.isEmpty()) {
@@ -948,59 +1999,69 @@ void MainWindow::saveAsciiArtLocally(const QStringList &lines)
         return;
     }
 
-    QSaveFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this,
-                             tr("Save Failed"),
-                             tr("Couldn't open %1 for writing.").arg(QDir::toNativeSeparators(filePath)));
+    m_artLibrary->saveAs(lines, filePath);
+}
+
+void MainWindow::openAsciiArtLibrary()
+{
+    AsciiArtLibraryDialog dialog(m_artLibrary, this);
+    if (dialog.exec() != QDialog::Accepted) {
         return;
     }
 
-    QTextStream stream(&file);
-    for (int i = 0; i < lines.size(); ++i) {
-        stream << lines.at(i);
-        if (i + 1 < lines.size()) {
-            stream << '\n';
-        }
+    const QStringList lines = dialog.selectedLines();
+    if (!lines.isEmpty()) {
+        statusBar()->showMessage(tr("Submitting ASCII art"), 2000);
+        sendAsciiArtLines(lines);
     }
+}
 
-    if (stream.status() != QTextStream::Ok) {
-        QMessageBox::warning(this,
-                             tr("Save Failed"),
-                             tr("An error occurred while writing %1.")
-                                 .arg(QDir::toNativeSeparators(filePath)));
-        file.cancelWriting();
+void MainWindow::exportTrace()
+{
+    const QString documentsDir = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    const QString basePath = documentsDir.isEmpty() ? QDir::homePath() : documentsDir;
+    const QString filePath = QFileDialog::getSaveFileName(this,
+                                                          tr("Export Trace"),
+                                                          QDir(basePath).filePath(QStringLiteral("chatter-trace.json")),
+                                                          tr("Chrome Trace (*.json)"));
+    if (filePath.isEmpty()) {
         return;
     }
 
-    if (!file.commit()) {
+    QString error;
+    if (TraceRecorder::exportChromeTrace(filePath, &error)) {
+        statusBar()->showMessage(tr("Saved trace to %1").arg(QDir::toNativeSeparators(filePath)), 5000);
+    } else {
         QMessageBox::warning(this,
-                             tr("Save Failed"),
-                             tr("Couldn't finalize %1.").arg(QDir::toNativeSeparators(filePath)));
-        return;
+                             tr("Export Failed"),
+                             tr("Couldn't save %1: %2").arg(QDir::toNativeSeparators(filePath), error));
     }
+}
 
-    statusBar()->showMessage(tr("Saved ASCII art to %1").arg(QDir::toNativeSeparators(filePath)), 5000);
+void MainWindow::openLatencyDiagnostics()
+{
+    LatencyDiagnosticsDialog dialog(&m_latencyProbe, m_terminal.data(), this);
+    dialog.exec();
 }
 
 void MainWindow::applyRetroPalette()
 {
     QPalette palette = qApp->palette();
-    const QColor background = basicAnsiColor(0, false);
-    const QColor foreground = basicAnsiColor(7, false);
+    const QColor background = AnsiText::basicColor(0, false);
+    const QColor foreground = AnsiText::basicColor(7, false);
 
     palette.setColor(QPalette::Base, background);
-    palette.setColor(QPalette::AlternateBase, basicAnsiColor(0, true));
+    palette.setColor(QPalette::AlternateBase, AnsiText::basicColor(0, true));
     palette.setColor(QPalette::Text, foreground);
     palette.setColor(QPalette::Window, background);
     palette.setColor(QPalette::WindowText, foreground);
     palette.setColor(QPalette::Button, background);
     palette.setColor(QPalette::ButtonText, foreground);
-    palette.setColor(QPalette::BrightText, basicAnsiColor(7, true));
-    palette.setColor(QPalette::Highlight, basicAnsiColor(4, true));
-    palette.setColor(QPalette::HighlightedText, basicAnsiColor(7, true));
-    palette.setColor(QPalette::Link, basicAnsiColor(6, true));
-    palette.setColor(QPalette::LinkVisited, basicAnsiColor(5, true));
+    palette.setColor(QPalette::BrightText, AnsiText::basicColor(7, true));
+    palette.setColor(QPalette::Highlight, AnsiText::basicColor(4, true));
+    palette.setColor(QPalette::HighlightedText, AnsiText::basicColor(7, true));
+    palette.setColor(QPalette::Link, AnsiText::basicColor(6, true));
+    palette.setColor(QPalette::LinkVisited, AnsiText::basicColor(5, true));
 
     qApp->setPalette(palette);
 }
@@ -4,11 +4,23 @@
 #include <QMainWindow>
 #include <QPointer>
 #include <QStringList>
+#include <QTextCharFormat>
+
+#include "CommandCatalog.h"
+#include "HighlightEngine.h"
+#include "HistoryStore.h"
+#include "KeyLatencyProbe.h"
+#include "MessageFilter.h"
 
 class QTextBrowser;
 class QLabel;
 class QAction;
 class QMenu;
+class QSystemTrayIcon;
+class QThread;
+class QTimer;
+class AsciiArtLibrary;
+class ScrollbackExporter;
 class TerminalWidget;
 
 class ChatterClient;
@@ -18,36 +30,79 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 public:
     explicit MainWindow(QWidget *parent = nullptr);
+    ~MainWindow() override;
+
+protected:
+    bool event(QEvent *event) override;
 
 private slots:
     void handleClientOutput(const QString &text);
     void handleClientError(const QString &text);
     void handleConnectionStateChanged(bool connected);
     void handleCommandActionTriggered();
+    void openCommandPalette();
     void handleTerminalInput(const QByteArray &data);
+    void handleTerminalKeys(const QByteArray &data);
     void handleTerminalSizeChanged(int columns, int rows);
     void initiateConnection();
     void stopConnection();
     void changeNickname();
+    void exportTranscript();
     void openAppearanceSettings();
+    void loadOlderHistory();
+    void jumpToMessage();
+    void openMessageBrowser();
+    void openHighlightRules();
+    void openMessageFilters();
+    void setFiltersEnabled(bool enabled);
+    void handleMention(const QString &text);
 
 private:
     void createMenus();
     void populateCommandMenu(QMenu *menu);
+    void runCommand(const CommandDescriptor &descriptor);
+    void rememberCommand(const QString &command);
     void appendMessage(const QString &text, bool isError = false);
-    QString promptForArgument(const QString &hint) const;
+    void prependHistoryLines(const QStringList &lines);
+    void openHistory();
+    void openCommandHistory();
+    void applyHistoryPersistence();
+    void updateHighlightRules();
+    void rerenderScrollback();
+    void updateFilterStatus();
+    void updateOutboundStatus();
+    QString promptForArgument(const QString &hint, int commandIndex = -1) const;
     void applyRetroPalette();
     bool ensureNickname(bool forcePrompt = false);
     void openAsciiArtComposer();
     void sendAsciiArtLines(const QStringList &lines);
     void saveAsciiArtLocally(const QStringList &lines);
+    void openAsciiArtLibrary();
+    void openLatencyDiagnostics();
+    void exportTrace();
 
     QPointer<TerminalWidget> m_terminal;
     QPointer<QTextBrowser> m_display;
     QPointer<QLabel> m_statusLabel;
+    QPointer<QLabel> m_filterLabel;
+    QPointer<QLabel> m_outboundLabel;
     QPointer<ChatterClient> m_client;
     QAction *m_connectAction;
     QAction *m_disconnectAction;
+    QAction *m_filtersAction;
+    QSystemTrayIcon *m_trayIcon;
+    QVector<HighlightRule> m_highlightRules;
+    QTimer *m_historyFlushTimer;
+    QTimer *m_filterFlushTimer;
+    AsciiArtLibrary *m_artLibrary;
+    QAction *m_artAutoSaveAction;
+    HistoryStore m_history;
+    MessageFilter m_filter;
+    KeyLatencyProbe m_latencyProbe;
+    QPointer<QThread> m_exportThread;
+    QPointer<ScrollbackExporter> m_exporter;
+    int m_historyLoadedFrom;
+    QString m_commandHistoryKey;
     bool m_isConnected;
     bool m_nicknameConfirmed;
 };
@@ -0,0 +1,385 @@
+#include "MessageFilter.h"
+
+#include "ChatLineParser.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kMaxStoredLines = 200000;
+constexpr int kPageLines = 1024;
+
+bool isCsiFinal(QChar ch)
+{
+    return ch.unicode() >= 0x40 && ch.unicode() <= 0x7E;
+}
+
+bool containsScreenControl(const QString &raw)
+{
+    int escape = raw.indexOf(QLatin1Char('\x1b'));
+    while (escape != -1 && escape + 1 < raw.size()) {
+        if (raw.at(escape + 1) == QLatin1Char('[')) {
+            int end = escape + 2;
+            while (end < raw.size() && !isCsiFinal(raw.at(end))) {
+                ++end;
+            }
+            if (end < raw.size()) {
+                const QChar final = raw.at(end);
+                if (final == QLatin1Char('H') || final == QLatin1Char('f') || final == QLatin1Char('J')) {
+                    return true;
+                }
+                if ((final == QLatin1Char('h') || final == QLatin1Char('l'))
+                    && raw.mid(escape + 2, end - escape - 2) == QStringLiteral("?1049")) {
+                    return true;
+                }
+            }
+        }
+        escape = raw.indexOf(QLatin1Char('\x1b'), escape + 1);
+    }
+    return false;
+}
+
+// Server notices name the user first and end with the verb phrase, e.g.
+// "* alice joined the chat" or "[12:00] bob has left"; a chat line that
+// merely mentions someone connecting must not match.
+bool isJoinLeaveNotice(const QString &plain)
+{
+    static const QRegularExpression notice(
+        QStringLiteral("^\\s*(?:\\[[^\\]]{1,12}\\]\\s*)?\\*{0,3}\\s*[\\w.\\-]+ (?:has )?"
+                       "(?:joined|entered|left|connected|disconnected)(?: the \\w+)?[.!]?\\s*$"),
+        QRegularExpression::CaseInsensitiveOption);
+    return notice.match(plain).hasMatch();
+}
+
+} // namespace
+
+MessageFilter::MessageFilter()
+    : m_lineCount(0)
+    , m_streaming(false)
+    , m_pendingDecided(false)
+    , m_pendingShown(false)
+    , m_hiddenLines(0)
+{
+}
+
+void MessageFilter::setSettings(const FilterSettings &settings)
+{
+    m_settings = settings;
+}
+
+const FilterSettings &MessageFilter::settings() const
+{
+    return m_settings;
+}
+
+bool MessageFilter::isActive() const
+{
+    return m_settings.enabled
+        && (!m_settings.mutedSpeakers.isEmpty()
+            || !m_settings.mutedKeywords.isEmpty()
+            || m_settings.systemAction != FilterAction::Show
+            || m_settings.joinLeaveAction != FilterAction::Show
+            || m_settings.gameFrameAction != FilterAction::Show);
+}
+
+void MessageFilter::setStreaming(bool streaming)
+{
+    m_streaming = streaming;
+}
+
+QString MessageFilter::process(const QString &text)
+{
+    const bool active = isActive();
+    QString output;
+
+    int start = 0;
+    int newline = text.indexOf(QLatin1Char('\n'));
+    while (newline != -1) {
+        const QString segment = text.mid(start, newline - start + 1);
+        m_pendingLine.append(segment);
+
+        Line line;
+        line.raw = m_pendingLine;
+        line.raw.chop(1);
+        if (line.raw.endsWith(QLatin1Char('\r'))) {
+            line.raw.chop(1);
+        }
+
+        // The completed line gets the verdict. If its start is already on
+        // screen only the rest is added, or just the line end when the whole
+        // line turns out to be hidden.
+        const bool prefixShown = m_pendingDecided && m_pendingShown;
+        if (!active || accepts(line, m_run)) {
+            output.append(prefixShown ? segment : m_pendingLine);
+        } else if (prefixShown) {
+            output.append(QLatin1Char('\n'));
+        }
+        store(line);
+
+        m_pendingLine.clear();
+        m_pendingDecided = false;
+        m_pendingShown = false;
+        start = newline + 1;
+        newline = text.indexOf(QLatin1Char('\n'), start);
+    }
+
+    if (start < text.size()) {
+        const QString rest = text.mid(start);
+        m_pendingLine.append(rest);
+        if (!m_pendingDecided && (!active || m_streaming)) {
+            // Whatever was held before this read goes out with it.
+            m_pendingDecided = true;
+            m_pendingShown = true;
+            output.append(m_pendingLine);
+        } else if (m_pendingDecided && m_pendingShown) {
+            output.append(rest);
+        }
+    }
+
+    return output;
+}
+
+bool MessageFilter::hasUndecidedLine() const
+{
+    return !m_pendingLine.isEmpty() && !m_pendingDecided;
+}
+
+QString MessageFilter::flushPending()
+{
+    if (!hasUndecidedLine()) {
+        return QString();
+    }
+
+    // A preview only: the run and hidden count are left for the completed line.
+    Line line;
+    line.raw = m_pendingLine;
+    ensureClassified(line);
+    RunState run = m_run;
+    m_pendingShown = !isActive() || judge(line, run);
+    m_pendingDecided = true;
+    return m_pendingShown ? m_pendingLine : QString();
+}
+
+QStringList MessageFilter::prependLines(const QStringList &rawLines)
+{
+    // History beyond the cap is dropped from its oldest end instead of
+    // evicting newer lines.
+    const int total = static_cast<int>(rawLines.size());
+    const int first = std::max(0, total - std::max(0, kMaxStoredLines - m_lineCount));
+    const bool active = isActive();
+
+    QVector<Line> page;
+    page.reserve(total - first);
+    QStringList shown;
+    RunState run;
+    for (int i = first; i < total; ++i) {
+        Line line;
+        line.raw = rawLines.at(i);
+        if (!active || accepts(line, run)) {
+            shown.append(line.raw);
+        }
+        page.append(line);
+    }
+
+    if (!page.isEmpty()) {
+        m_lineCount += static_cast<int>(page.size());
+        m_pages.prepend(page);
+    }
+    return shown;
+}
+
+QString MessageFilter::renderAll()
+{
+    const bool active = isActive();
+    m_hiddenLines = 0;
+    m_run = RunState();
+
+    QString output;
+    for (QVector<Line> &page : m_pages) {
+        for (Line &line : page) {
+            if (!active || accepts(line, m_run)) {
+                output.append(line.raw);
+                output.append(QLatin1Char('\n'));
+            }
+        }
+    }
+    m_pendingDecided = false;
+    output.append(flushPending());
+    return output;
+}
+
+int MessageFilter::lineCount() const
+{
+    return m_lineCount;
+}
+
+bool MessageFilter::isFull() const
+{
+    return m_lineCount >= kMaxStoredLines;
+}
+
+QStringList MessageFilter::visibleLines(Cursor *cursor, int maxLines) const
+{
+    const bool active = isActive();
+
+    // Pages are few, so finding the cursor's page by walking is cheap.
+    int page = 0;
+    int index = cursor->line;
+    while (page < m_pages.size() && index >= m_pages.at(page).size()) {
+        index -= static_cast<int>(m_pages.at(page).size());
+        ++page;
+    }
+
+    QStringList shown;
+    while (page < m_pages.size() && shown.size() < maxLines) {
+        const QVector<Line> &lines = m_pages.at(page);
+        while (index < lines.size() && shown.size() < maxLines) {
+            // Classify a shallow copy; the stored line keeps whatever it had.
+            Line line = lines.at(index++);
+            ++cursor->line;
+            ensureClassified(line);
+            if (!active || judge(line, cursor->run)) {
+                shown.append(line.raw);
+            }
+        }
+        if (index >= lines.size()) {
+            ++page;
+            index = 0;
+        }
+    }
+    return shown;
+}
+
+quint64 MessageFilter::hiddenLineCount() const
+{
+    return m_hiddenLines;
+}
+
+LineClass MessageFilter::classify(const QString &rawLine, QString *speaker)
+{
+    if (containsScreenControl(rawLine)) {
+        return LineClass::GameFrame;
+    }
+
+    const QString plain = stripAnsi(rawLine);
+    ChatLine chat;
+    if (ChatLineParser::parse(plain, &chat)) {
+        if (speaker) {
+            *speaker = chat.handle;
+        }
+        return LineClass::Chat;
+    }
+
+    if (plain.trimmed().isEmpty()) {
+        return LineClass::Chat;
+    }
+    return isJoinLeaveNotice(plain) ? LineClass::JoinLeave : LineClass::System;
+}
+
+QString MessageFilter::stripAnsi(const QString &text)
+{
+    QString plain;
+    plain.reserve(text.size());
+
+    for (int i = 0; i < text.size(); ++i) {
+        const QChar ch = text.at(i);
+        if (ch == QLatin1Char('\x1b')) {
+            if (i + 1 < text.size() && text.at(i + 1) == QLatin1Char('[')) {
+                i += 2;
+                while (i < text.size() && !isCsiFinal(text.at(i))) {
+                    ++i;
+                }
+            } else {
+                ++i;
+            }
+            continue;
+        }
+        if (ch == QLatin1Char('\r') || ch == QLatin1Char('\a')) {
+            continue;
+        }
+        plain.append(ch);
+    }
+    return plain;
+}
+
+void MessageFilter::ensureClassified(Line &line) const
+{
+    if (line.classified) {
+        return;
+    }
+    line.lineClass = classify(line.raw, &line.speaker);
+    line.classified = true;
+}
+
+FilterAction MessageFilter::actionFor(const Line &line) const
+{
+    if (!line.speaker.isEmpty() && m_settings.mutedSpeakers.contains(line.speaker, Qt::CaseInsensitive)) {
+        return FilterAction::Hide;
+    }
+
+    if (!m_settings.mutedKeywords.isEmpty()) {
+        const QString plain = stripAnsi(line.raw);
+        for (const QString &keyword : m_settings.mutedKeywords) {
+            if (plain.contains(keyword, Qt::CaseInsensitive)) {
+                return FilterAction::Hide;
+            }
+        }
+    }
+
+    switch (line.lineClass) {
+    case LineClass::System:
+        return m_settings.systemAction;
+    case LineClass::JoinLeave:
+        return m_settings.joinLeaveAction;
+    case LineClass::GameFrame:
+        return m_settings.gameFrameAction;
+    case LineClass::Chat:
+        break;
+    }
+    return FilterAction::Show;
+}
+
+bool MessageFilter::judge(const Line &line, RunState &run) const
+{
+    const FilterAction action = actionFor(line);
+    const bool continuesRun = line.lineClass == run.lineClass && line.speaker == run.speaker;
+    run.lineClass = line.lineClass;
+    run.speaker = line.speaker;
+
+    return action == FilterAction::Show
+        || (action == FilterAction::Collapse && !continuesRun);
+}
+
+bool MessageFilter::accepts(Line &line, RunState &run)
+{
+    ensureClassified(line);
+
+    const bool shown = judge(line, run);
+    if (!shown) {
+        ++m_hiddenLines;
+    }
+    return shown;
+}
+
+void MessageFilter::store(const Line &line)
+{
+    if (m_lineCount >= kMaxStoredLines) {
+        // Evict whole pages from the oldest end, about a tenth of the cap.
+        int pages = 0;
+        int evicted = 0;
+        while (pages < m_pages.size() - 1 && evicted < kMaxStoredLines / 10) {
+            evicted += static_cast<int>(m_pages.at(pages++).size());
+        }
+        m_pages.remove(0, pages);
+        m_lineCount -= evicted;
+    }
+
+    if (m_pages.isEmpty() || m_pages.last().size() >= kPageLines) {
+        m_pages.append(QVector<Line>());
+        m_pages.last().reserve(kPageLines);
+    }
+    m_pages.last().append(line);
+    ++m_lineCount;
+}
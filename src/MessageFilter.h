@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+enum class LineClass {
+    Chat,
+    System,
+    JoinLeave,
+    GameFrame
+};
+
+enum class FilterAction {
+    Show,
+    Collapse,
+    Hide
+};
+
+struct FilterSettings {
+    QStringList mutedSpeakers;
+    QStringList mutedKeywords;
+    FilterAction systemAction = FilterAction::Show;
+    FilterAction joinLeaveAction = FilterAction::Show;
+    FilterAction gameFrameAction = FilterAction::Show;
+    bool enabled = true;
+};
+
+// Sits between the client and the display: every completed line is classified
+// and kept, and only lines that pass the current settings are forwarded. While
+// filtering, a partial line is held until its newline or until flushPending()
+// (a prompt that never gets one); in streaming mode (raw input, full-screen
+// programs) it passes straight through. Either way the completed line is
+// judged as a whole. Lines are stored in pages so history can be prepended a
+// page at a time.
+class MessageFilter
+{
+    struct RunState {
+        LineClass lineClass = LineClass::Chat;
+        QString speaker;
+    };
+
+public:
+    // Resumable read position for pulling visible lines a chunk at a time
+    // without touching the live filter state.
+    struct Cursor {
+        int line = 0;
+        RunState run;
+    };
+
+    MessageFilter();
+
+    void setSettings(const FilterSettings &settings);
+    const FilterSettings &settings() const;
+    bool isActive() const;
+    void setStreaming(bool streaming);
+
+    QString process(const QString &text);
+    bool hasUndecidedLine() const;
+    QString flushPending();
+    QStringList prependLines(const QStringList &rawLines);
+    QString renderAll();
+    int lineCount() const;
+    bool isFull() const;
+    QStringList visibleLines(Cursor *cursor, int maxLines) const;
+    quint64 hiddenLineCount() const;
+
+    static LineClass classify(const QString &rawLine, QString *speaker = nullptr);
+    static QString stripAnsi(const QString &text);
+
+private:
+    struct Line {
+        QString raw;
+        QString speaker;
+        LineClass lineClass = LineClass::Chat;
+        bool classified = false;
+    };
+
+    void ensureClassified(Line &line) const;
+    FilterAction actionFor(const Line &line) const;
+    bool judge(const Line &line, RunState &run) const;
+    bool accepts(Line &line, RunState &run);
+    void store(const Line &line);
+
+    FilterSettings m_settings;
+    QVector<QVector<Line>> m_pages;
+    int m_lineCount;
+    QString m_pendingLine;
+    RunState m_run;
+    bool m_streaming;
+    bool m_pendingDecided;
+    bool m_pendingShown;
+    quint64 m_hiddenLines;
+};
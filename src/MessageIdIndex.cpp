@@ -0,0 +1,92 @@
+#include "MessageIdIndex.h"
+
+#include <QtGlobal>
+
+namespace {
+
+constexpr int kMessageIdScanLimit = 48;
+
+QString messageIdPrefix()
+{
+    static const QString prefix = []() {
+        const QString configured = qEnvironmentVariable("CHATTER_MESSAGE_ID_PREFIX");
+        return configured.isEmpty() ? QStringLiteral("#") : configured;
+    }();
+    return prefix;
+}
+
+bool isIdBoundary(QChar ch)
+{
+    return !ch.isLetterOrNumber() && ch != QLatin1Char('_');
+}
+
+} // namespace
+
+MessageIdIndex::MessageIdIndex()
+    : m_prependedLines(0)
+{
+}
+
+void MessageIdIndex::addLine(int line, const QString &text)
+{
+    const QString id = extractId(text);
+    if (!id.isEmpty()) {
+        m_lines.insert(id, line - m_prependedLines);
+    }
+}
+
+void MessageIdIndex::prependLines(const QStringList &texts)
+{
+    const int count = static_cast<int>(texts.size());
+    m_prependedLines += count;
+
+    for (int line = 0; line < count; ++line) {
+        const QString id = extractId(texts.at(line));
+        if (!id.isEmpty() && !m_lines.contains(id)) {
+            m_lines.insert(id, line - m_prependedLines);
+        }
+    }
+}
+
+void MessageIdIndex::clear()
+{
+    m_lines.clear();
+    m_prependedLines = 0;
+}
+
+int MessageIdIndex::lineForId(const QString &id) const
+{
+    const auto it = m_lines.constFind(id);
+    if (it == m_lines.constEnd()) {
+        return -1;
+    }
+    return it.value() + m_prependedLines;
+}
+
+int MessageIdIndex::count() const
+{
+    return m_lines.size();
+}
+
+QString MessageIdIndex::extractId(const QString &text)
+{
+    const QString prefix = messageIdPrefix();
+    const QString head = text.left(kMessageIdScanLimit);
+
+    int from = head.indexOf(prefix);
+    while (from >= 0) {
+        const int digitsStart = from + static_cast<int>(prefix.size());
+        int digitsEnd = digitsStart;
+        while (digitsEnd < text.size() && text.at(digitsEnd).isDigit()) {
+            ++digitsEnd;
+        }
+
+        const bool startsToken = from == 0 || isIdBoundary(text.at(from - 1));
+        const bool endsToken = digitsEnd == text.size() || isIdBoundary(text.at(digitsEnd));
+        if (digitsEnd > digitsStart && startsToken && endsToken) {
+            return text.mid(digitsStart, digitsEnd - digitsStart);
+        }
+        from = head.indexOf(prefix, from + 1);
+    }
+    return QString();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Maps server message IDs to scrollback lines. Stored line numbers are relative
+// to the number of lines prepended so far, so paging in history is O(1).
+class MessageIdIndex
+{
+public:
+    MessageIdIndex();
+
+    void addLine(int line, const QString &text);
+    void prependLines(const QStringList &texts);
+    void clear();
+
+    int lineForId(const QString &id) const;
+    int count() const;
+
+    static QString extractId(const QString &text);
+
+private:
+    QHash<QString, int> m_lines;
+    int m_prependedLines;
+};
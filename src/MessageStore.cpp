@@ -0,0 +1,404 @@
+#include "MessageStore.h"
+
+#include "ChatLineParser.h"
+
+#include <QDateTime>
+#include <QTime>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr int kCheckpointInterval = 16;
+constexpr int kMaxRows = 200000;
+constexpr quint32 kNoHandle = std::numeric_limits<quint32>::max();
+constexpr quint8 kPrivateFlag = 0x1;
+constexpr quint8 kUntimedFlag = 0x2;
+constexpr qint64 kSecondsPerDay = 24 * 60 * 60;
+constexpr qint64 kClockSkewSeconds = 60 * 60;
+
+qint64 resolveTimestamp(const QString &text, qint64 now)
+{
+    QTime time = QTime::fromString(text, QStringLiteral("H:mm:ss"));
+    if (!time.isValid()) {
+        time = QTime::fromString(text, QStringLiteral("H:mm"));
+    }
+    if (!time.isValid()) {
+        return 0;
+    }
+
+    const QDateTime today(QDateTime::fromSecsSinceEpoch(now).date(), time);
+    qint64 seconds = today.toSecsSinceEpoch();
+    if (seconds > now + kClockSkewSeconds) {
+        seconds -= kSecondsPerDay;
+    }
+    return seconds;
+}
+
+} // namespace
+
+MessageStore::MessageStore(QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_rowCount(0)
+    , m_prependedLines(0)
+{
+    resetColumns();
+}
+
+void MessageStore::addLines(int firstLine, const QStringList &texts, qint64 receivedAt)
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVector<Record> records;
+    for (int i = 0; i < texts.size(); ++i) {
+        Record record;
+        if (parseRecord(firstLine + i, texts.at(i), now, receivedAt, &record)) {
+            records.append(record);
+        }
+    }
+    if (records.isEmpty()) {
+        return;
+    }
+
+    if (rowCount() + records.size() > kMaxRows) {
+        const int keep = kMaxRows - kMaxRows / 10;
+        QVector<Record> retained;
+        for (int row = std::max(0, rowCount() - keep); row < rowCount(); ++row) {
+            retained.append(recordAt(row));
+        }
+
+        beginResetModel();
+        resetColumns();
+        for (const Record &record : retained) {
+            appendRecord(m_segments.last(), record);
+        }
+        for (const Record &record : records) {
+            appendRecord(m_segments.last(), record);
+        }
+        updateSegmentStarts();
+        endResetModel();
+        return;
+    }
+
+    const int first = rowCount();
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(records.size()) - 1);
+    for (const Record &record : records) {
+        appendRecord(m_segments.last(), record);
+    }
+    m_rowCount += static_cast<int>(records.size());
+    endInsertRows();
+}
+
+void MessageStore::prependLines(const QStringList &texts)
+{
+    const int count = static_cast<int>(texts.size());
+    if (count == 0) {
+        return;
+    }
+
+    // Stored line numbers are relative to the prepended total, so existing
+    // rows move down without being touched.
+    m_prependedLines += count;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVector<Record> records;
+    for (int line = 0; line < count; ++line) {
+        Record record;
+        if (parseRecord(line, texts.at(line), now, 0, &record)) {
+            records.append(record);
+        }
+    }
+
+    // A full store keeps the newest of the page and drops the rest.
+    const int room = std::max(0, kMaxRows - rowCount());
+    if (records.size() > room) {
+        records.remove(0, static_cast<int>(records.size()) - room);
+    }
+    if (records.isEmpty()) {
+        return;
+    }
+
+    Segment segment;
+    for (const Record &record : records) {
+        appendRecord(segment, record);
+    }
+
+    beginInsertRows(QModelIndex(), 0, static_cast<int>(records.size()) - 1);
+    m_segments.prepend(segment);
+    updateSegmentStarts();
+    endInsertRows();
+}
+
+void MessageStore::clear()
+{
+    beginResetModel();
+    resetColumns();
+    m_handles.clear();
+    m_handleIds.clear();
+    endResetModel();
+}
+
+QVector<int> MessageStore::select(const Query &query) const
+{
+    QVector<int> rows;
+    const quint32 handle = query.handle.isEmpty() ? kNoHandle : handleIdFor(query.handle);
+    if (!query.handle.isEmpty() && handle == kNoHandle) {
+        return rows;
+    }
+
+    int row = 0;
+    for (const Segment &segment : m_segments) {
+        qint64 timestamp = 0;
+        for (int local = 0; local < segment.rowCount(); ++local, ++row) {
+            timestamp = (local % kCheckpointInterval == 0)
+                ? segment.timeCheckpoints.at(local / kCheckpointInterval)
+                : timestamp + segment.timeDeltas.at(local);
+            if (handle != kNoHandle && segment.handleColumn.at(local) != handle) {
+                continue;
+            }
+            if (query.privateOnly && !(segment.flags.at(local) & kPrivateFlag)) {
+                continue;
+            }
+            if (query.since > 0 && ((segment.flags.at(local) & kUntimedFlag) || timestamp < query.since)) {
+                continue;
+            }
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+bool MessageStore::matches(int row, const Query &query) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return false;
+    }
+    int local = 0;
+    const Segment &segment = segmentFor(row, &local);
+    if (!query.handle.isEmpty() && segment.handleColumn.at(local) != handleIdFor(query.handle)) {
+        return false;
+    }
+    if (query.privateOnly && !(segment.flags.at(local) & kPrivateFlag)) {
+        return false;
+    }
+    return query.since <= 0 || timestampAt(row) >= query.since;
+}
+
+qint64 MessageStore::timestampAt(int row) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return 0;
+    }
+    int local = 0;
+    if (segmentFor(row, &local).flags.at(local) & kUntimedFlag) {
+        return 0;
+    }
+    return encodedTimestampAt(row);
+}
+
+qint64 MessageStore::encodedTimestampAt(int row) const
+{
+    int local = 0;
+    const Segment &segment = segmentFor(row, &local);
+    const int checkpoint = local / kCheckpointInterval;
+    qint64 timestamp = segment.timeCheckpoints.at(checkpoint);
+    for (int i = checkpoint * kCheckpointInterval + 1; i <= local; ++i) {
+        timestamp += segment.timeDeltas.at(i);
+    }
+    return timestamp;
+}
+
+int MessageStore::lineAt(int row) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return -1;
+    }
+    int local = 0;
+    return segmentFor(row, &local).lineColumn.at(local) + m_prependedLines;
+}
+
+int MessageStore::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+int MessageStore::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant MessageStore::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const int row = index.row();
+    if (role == LineRole) {
+        return lineAt(row);
+    }
+    if (role == TimestampRole) {
+        return timestampAt(row);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    int local = 0;
+    const Segment &segment = segmentFor(row, &local);
+    switch (index.column()) {
+    case TimeColumn:
+        if (segment.flags.at(local) & kUntimedFlag) {
+            return QVariant();
+        }
+        return QDateTime::fromSecsSinceEpoch(timestampAt(row));
+    case HandleColumn:
+        return m_handles.value(static_cast<int>(segment.handleColumn.at(local)));
+    case IdColumn:
+        return segment.idColumn.at(local) ? QString::number(segment.idColumn.at(local)) : QString();
+    case BodyColumn:
+        return bodyAt(row);
+    case ReactionsColumn:
+        return segment.reactions.value(local);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant MessageStore::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case TimeColumn:
+        return tr("Time");
+    case HandleColumn:
+        return tr("From");
+    case IdColumn:
+        return tr("ID");
+    case BodyColumn:
+        return tr("Message");
+    case ReactionsColumn:
+        return tr("Reactions");
+    default:
+        return QVariant();
+    }
+}
+
+bool MessageStore::parseRecord(int line, const QString &text, qint64 now, qint64 receivedAt,
+                               Record *record) const
+{
+    ChatLine chat;
+    if (!ChatLineParser::parse(text, &chat)) {
+        return false;
+    }
+
+    const qint64 stamped = chat.timestamp.isEmpty() ? 0 : resolveTimestamp(chat.timestamp, now);
+    record->timestamp = stamped > 0 ? stamped : receivedAt;
+    record->handle = chat.handle;
+    record->messageId = chat.messageId;
+    record->body = chat.body;
+    record->reactions = chat.reactions;
+    record->isPrivate = chat.isPrivate;
+    record->line = line;
+    return true;
+}
+
+const MessageStore::Segment &MessageStore::segmentFor(int row, int *local) const
+{
+    const auto it = std::upper_bound(m_segmentStarts.cbegin(), m_segmentStarts.cend(), row);
+    const int segment = static_cast<int>(it - m_segmentStarts.cbegin()) - 1;
+    *local = row - m_segmentStarts.at(segment);
+    return m_segments.at(segment);
+}
+
+MessageStore::Record MessageStore::recordAt(int row) const
+{
+    int local = 0;
+    const Segment &segment = segmentFor(row, &local);
+    Record record;
+    record.timestamp = timestampAt(row);
+    record.handle = m_handles.value(static_cast<int>(segment.handleColumn.at(local)));
+    record.messageId = segment.idColumn.at(local) ? QString::number(segment.idColumn.at(local)) : QString();
+    record.body = bodyAt(row);
+    record.reactions = segment.reactions.value(local);
+    record.isPrivate = segment.flags.at(local) & kPrivateFlag;
+    record.line = lineAt(row);
+    return record;
+}
+
+void MessageStore::appendRecord(Segment &segment, const Record &record)
+{
+    // Untimed rows repeat the previous time so the delta column stays small.
+    const bool untimed = record.timestamp <= 0;
+    const qint64 timestamp = untimed ? segment.lastTimestamp : record.timestamp;
+    const int row = segment.rowCount();
+    if (row % kCheckpointInterval == 0) {
+        segment.timeCheckpoints.append(timestamp);
+        segment.timeDeltas.append(0);
+    } else {
+        const qint64 delta = timestamp - segment.lastTimestamp;
+        segment.timeDeltas.append(static_cast<qint32>(qBound<qint64>(std::numeric_limits<qint32>::min(), delta,
+                                                                    std::numeric_limits<qint32>::max())));
+    }
+    segment.lastTimestamp = timestamp;
+
+    segment.handleColumn.append(internHandle(record.handle));
+    segment.idColumn.append(record.messageId.toULongLong());
+    segment.bodyArena.append(record.body);
+    segment.bodyOffsets.append(static_cast<int>(segment.bodyArena.size()));
+    if (!record.reactions.isEmpty()) {
+        segment.reactions.insert(row, record.reactions);
+    }
+    segment.flags.append((record.isPrivate ? kPrivateFlag : 0) | (untimed ? kUntimedFlag : 0));
+    segment.lineColumn.append(record.line - m_prependedLines);
+}
+
+void MessageStore::resetColumns()
+{
+    m_segments.clear();
+    m_segments.append(Segment());
+    m_segmentStarts = {0};
+    m_rowCount = 0;
+    m_prependedLines = 0;
+}
+
+void MessageStore::updateSegmentStarts()
+{
+    m_segmentStarts.resize(m_segments.size());
+    int start = 0;
+    for (int i = 0; i < m_segments.size(); ++i) {
+        m_segmentStarts[i] = start;
+        start += m_segments.at(i).rowCount();
+    }
+    m_rowCount = start;
+}
+
+quint32 MessageStore::internHandle(const QString &handle)
+{
+    const QString folded = handle.toCaseFolded();
+    const auto it = m_handleIds.constFind(folded);
+    if (it != m_handleIds.constEnd()) {
+        return it.value();
+    }
+
+    const quint32 id = static_cast<quint32>(m_handles.size());
+    m_handles.append(handle);
+    m_handleIds.insert(folded, id);
+    return id;
+}
+
+quint32 MessageStore::handleIdFor(const QString &handle) const
+{
+    return m_handleIds.value(handle.toCaseFolded(), kNoHandle);
+}
+
+QString MessageStore::bodyAt(int row) const
+{
+    int local = 0;
+    const Segment &segment = segmentFor(row, &local);
+    const int start = segment.bodyOffsets.at(local);
+    return segment.bodyArena.mid(start, segment.bodyOffsets.at(local + 1) - start);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Column-oriented store of parsed chat lines. Handles are interned, timestamps
+// are kept as deltas with an absolute checkpoint every few rows, and bodies
+// share one text arena so queries scan flat arrays. A line with no timestamp
+// of its own and no known arrival time (restored history) stays untimed and
+// never matches a time-bounded query. Rows live in segments, one per prepended
+// history page plus the live tail, so paging in older lines never rewrites the
+// rows already stored.
+class MessageStore : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        TimeColumn,
+        HandleColumn,
+        IdColumn,
+        BodyColumn,
+        ReactionsColumn,
+        ColumnCount
+    };
+
+    enum Role {
+        LineRole = Qt::UserRole + 1,
+        TimestampRole
+    };
+
+    struct Query {
+        QString handle;
+        qint64 since = 0;
+        bool privateOnly = false;
+    };
+
+    explicit MessageStore(QObject *parent = nullptr);
+
+    void addLines(int firstLine, const QStringList &texts, qint64 receivedAt);
+    void prependLines(const QStringList &texts);
+    void clear();
+
+    QVector<int> select(const Query &query) const;
+    bool matches(int row, const Query &query) const;
+    qint64 timestampAt(int row) const;
+    int lineAt(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Record {
+        qint64 timestamp = 0;
+        QString handle;
+        QString messageId;
+        QString body;
+        QString reactions;
+        bool isPrivate = false;
+        int line = 0;
+    };
+
+    struct Segment {
+        QVector<quint32> handleColumn;
+        QVector<qint64> timeCheckpoints;
+        QVector<qint32> timeDeltas;
+        QVector<quint64> idColumn;
+        QString bodyArena;
+        QVector<int> bodyOffsets = {0};
+        QHash<int, QString> reactions;
+        QVector<quint8> flags;
+        QVector<int> lineColumn;
+        qint64 lastTimestamp = 0;
+
+        int rowCount() const { return static_cast<int>(handleColumn.size()); }
+    };
+
+    bool parseRecord(int line, const QString &text, qint64 now, qint64 receivedAt, Record *record) const;
+    const Segment &segmentFor(int row, int *local) const;
+    qint64 encodedTimestampAt(int row) const;
+    Record recordAt(int row) const;
+    void appendRecord(Segment &segment, const Record &record);
+    void resetColumns();
+    void updateSegmentStarts();
+    quint32 internHandle(const QString &handle);
+    quint32 handleIdFor(const QString &handle) const;
+    QString bodyAt(int row) const;
+
+    QStringList m_handles;
+    QHash<QString, quint32> m_handleIds;
+    QVector<Segment> m_segments;
+    QVector<int> m_segmentStarts;
+    int m_rowCount;
+    int m_prependedLines;
+};
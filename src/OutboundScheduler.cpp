@@ -0,0 +1,138 @@
+#include "OutboundScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kDefaultRate = 20.0;
+constexpr int kDefaultBurst = 16;
+
+int indexOf(OutboundPriority priority)
+{
+    return static_cast<int>(priority);
+}
+
+} // namespace
+
+OutboundScheduler::OutboundScheduler()
+    : m_rate(kDefaultRate)
+    , m_tokens(kDefaultBurst)
+    , m_burst(kDefaultBurst)
+    , m_lastRefill(0)
+{
+}
+
+void OutboundScheduler::setRate(double messagesPerSecond, int burst)
+{
+    m_rate = std::max(0.0, messagesPerSecond);
+    m_burst = std::max(1, burst);
+    m_tokens = std::min<double>(m_tokens, m_burst);
+}
+
+double OutboundScheduler::rate() const
+{
+    return m_rate;
+}
+
+int OutboundScheduler::burst() const
+{
+    return m_burst;
+}
+
+void OutboundScheduler::enqueue(const QByteArray &data, OutboundPriority priority, qint64 nowMs,
+                                int cost, quint64 batchId)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    const int index = indexOf(priority);
+    m_queues[index].enqueue(OutboundMessage{data, priority, nowMs, std::max(1, cost), batchId});
+    ++m_stats[index].depth;
+    m_stats[index].queuedBytes += data.size();
+}
+
+bool OutboundScheduler::remove(quint64 batchId)
+{
+    for (int index = 0; index < kOutboundPriorityCount; ++index) {
+        QQueue<OutboundMessage> &queue = m_queues[index];
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (it->batchId == batchId) {
+                --m_stats[index].depth;
+                m_stats[index].queuedBytes -= it->data.size();
+                queue.erase(it);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool OutboundScheduler::takeNext(qint64 nowMs, OutboundMessage *message, qint64 *waitMs)
+{
+    *waitMs = 0;
+    refill(nowMs);
+
+    for (int index = 0; index < kOutboundPriorityCount; ++index) {
+        QQueue<OutboundMessage> &queue = m_queues[index];
+        if (queue.isEmpty()) {
+            continue;
+        }
+
+        const bool paced = index != indexOf(OutboundPriority::Interactive) && m_rate > 0.0;
+        const double needed = std::min(queue.head().cost, m_burst);
+        if (paced && m_tokens < needed) {
+            *waitMs = static_cast<qint64>(std::ceil((needed - m_tokens) * 1000.0 / m_rate));
+            return false;
+        }
+        if (paced) {
+            m_tokens = std::max(0.0, m_tokens - queue.head().cost);
+        }
+
+        *message = queue.dequeue();
+        --m_stats[index].depth;
+        m_stats[index].queuedBytes -= message->data.size();
+        return true;
+    }
+    return false;
+}
+
+void OutboundScheduler::recordSent(const OutboundMessage &message, qint64 nowMs)
+{
+    OutboundStats &stats = m_stats[indexOf(message.priority)];
+    const qint64 latency = std::max<qint64>(0, nowMs - message.enqueuedAt);
+    ++stats.sent;
+    stats.lastLatencyMs = latency;
+    stats.maxLatencyMs = std::max(stats.maxLatencyMs, latency);
+    stats.totalLatencyMs += latency;
+}
+
+void OutboundScheduler::clear()
+{
+    for (int index = 0; index < kOutboundPriorityCount; ++index) {
+        m_queues[index].clear();
+        m_stats[index].depth = 0;
+        m_stats[index].queuedBytes = 0;
+    }
+}
+
+bool OutboundScheduler::isEmpty() const
+{
+    return std::all_of(m_queues.cbegin(), m_queues.cend(), [](const QQueue<OutboundMessage> &queue) {
+        return queue.isEmpty();
+    });
+}
+
+OutboundStats OutboundScheduler::stats(OutboundPriority priority) const
+{
+    return m_stats[indexOf(priority)];
+}
+
+void OutboundScheduler::refill(qint64 nowMs)
+{
+    if (nowMs > m_lastRefill) {
+        m_tokens = std::min<double>(m_burst, m_tokens + (nowMs - m_lastRefill) * m_rate / 1000.0);
+    }
+    m_lastRefill = std::max(m_lastRefill, nowMs);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QByteArray>
+#include <QQueue>
+#include <QtGlobal>
+
+#include <array>
+
+enum class OutboundPriority {
+    Interactive,
+    Line,
+    Bulk
+};
+
+constexpr int kOutboundPriorityCount = 3;
+
+struct OutboundMessage {
+    QByteArray data;
+    OutboundPriority priority = OutboundPriority::Line;
+    qint64 enqueuedAt = 0;
+    int cost = 1;
+    quint64 batchId = 0;
+};
+
+struct OutboundStats {
+    int depth = 0;
+    qint64 queuedBytes = 0;
+    quint64 sent = 0;
+    qint64 lastLatencyMs = 0;
+    qint64 maxLatencyMs = 0;
+    qint64 totalLatencyMs = 0;
+};
+
+// Strict-priority outbound queue. Lines and bulk traffic draw tokens from a
+// shared bucket (one per line); keystrokes go first and are never paced. A
+// batch costing more than the burst waits for a full bucket and empties it;
+// the excess is not carried as debt, so a chat line typed after a paste waits
+// at most one token's worth.
+class OutboundScheduler
+{
+public:
+    OutboundScheduler();
+
+    void setRate(double messagesPerSecond, int burst);
+    double rate() const;
+    int burst() const;
+
+    void enqueue(const QByteArray &data, OutboundPriority priority, qint64 nowMs,
+                 int cost = 1, quint64 batchId = 0);
+    bool remove(quint64 batchId);
+    bool takeNext(qint64 nowMs, OutboundMessage *message, qint64 *waitMs);
+    void recordSent(const OutboundMessage &message, qint64 nowMs);
+    void clear();
+    bool isEmpty() const;
+
+    OutboundStats stats(OutboundPriority priority) const;
+
+private:
+    void refill(qint64 nowMs);
+
+    std::array<QQueue<OutboundMessage>, kOutboundPriorityCount> m_queues;
+    std::array<OutboundStats, kOutboundPriorityCount> m_stats;
+    double m_rate;
+    double m_tokens;
+    int m_burst;
+    qint64 m_lastRefill;
+};
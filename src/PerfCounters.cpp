@@ -0,0 +1,27 @@
+#include "PerfCounters.h"
+
+PerfCounters &PerfCounters::instance()
+{
+    static PerfCounters counters;
+    return counters;
+}
+
+PerfCounters::PerfCounters()
+{
+    m_clock.start();
+}
+
+void PerfCounters::setTimingEnabled(bool enabled)
+{
+    m_timing.store(enabled, std::memory_order_relaxed);
+}
+
+bool PerfCounters::timingEnabled() const
+{
+    return m_timing.load(std::memory_order_relaxed);
+}
+
+qint64 PerfCounters::nowNanos() const
+{
+    return m_clock.nsecsElapsed();
+}
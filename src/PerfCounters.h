@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include <atomic>
+
+// Process-wide pipeline counters read by the performance HUD. Producers bump
+// them with relaxed atomics; the clock is only read for timed sections while
+// timing is switched on, so the hidden HUD costs one branch per batch.
+class PerfCounters
+{
+public:
+    static PerfCounters &instance();
+
+    void setTimingEnabled(bool enabled);
+    bool timingEnabled() const;
+    qint64 nowNanos() const;
+
+    std::atomic<quint64> bytesRead {0};
+    std::atomic<quint64> decodeNanos {0};
+    std::atomic<quint64> decodeBatches {0};
+    std::atomic<quint64> parseNanos {0};
+    std::atomic<quint64> parseBatches {0};
+    std::atomic<quint64> insertNanos {0};
+    std::atomic<quint64> insertBatches {0};
+    std::atomic<quint64> frames {0};
+    std::atomic<qint64> outboundDepth {0};
+
+private:
+    PerfCounters();
+
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_timing {false};
+};
+
+// Adds the lifetime of the scope to a nanosecond total and bumps its batch
+// count, but only when the HUD has switched timing on.
+class PerfTimer
+{
+public:
+    PerfTimer(std::atomic<quint64> &nanos, std::atomic<quint64> &batches)
+        : m_nanos(nanos)
+        , m_batches(batches)
+        , m_start(PerfCounters::instance().timingEnabled() ? PerfCounters::instance().nowNanos() : -1)
+    {
+    }
+
+    ~PerfTimer()
+    {
+        if (m_start >= 0) {
+            const qint64 elapsed = PerfCounters::instance().nowNanos() - m_start;
+            m_nanos.fetch_add(static_cast<quint64>(elapsed), std::memory_order_relaxed);
+            m_batches.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PerfTimer(const PerfTimer &) = delete;
+    PerfTimer &operator=(const PerfTimer &) = delete;
+
+private:
+    std::atomic<quint64> &m_nanos;
+    std::atomic<quint64> &m_batches;
+    const qint64 m_start;
+};
@@ -0,0 +1,184 @@
+#include "PerfOverlay.h"
+
+#include "AnsiText.h"
+#include "PerfCounters.h"
+#include "ScrollbackModel.h"
+
+#include <QEvent>
+#include <QFontMetrics>
+#include <QLocale>
+#include <QPainter>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+constexpr int kRefreshIntervalMs = 500;
+constexpr int kMargin = 6;
+constexpr int kPadding = 6;
+
+quint64 load(const std::atomic<quint64> &counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+QString perBatch(quint64 nanos, quint64 batches)
+{
+    if (batches == 0) {
+        return QStringLiteral("-");
+    }
+    return QStringLiteral("%1 ms").arg(double(nanos) / double(batches) / 1e6, 0, 'f', 3);
+}
+} // namespace
+
+PerfOverlay::PerfOverlay(const ScrollbackModel *scrollback, QWidget *viewport, QWidget *parent)
+    : QWidget(parent)
+    , m_scrollback(scrollback)
+    , m_viewport(viewport)
+    , m_refreshTimer(new QTimer(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+    hide();
+
+    viewport->installEventFilter(this);
+    if (viewport->parentWidget() && viewport->parentWidget() != parent) {
+        viewport->parentWidget()->installEventFilter(this);
+    }
+    m_refreshTimer->setInterval(kRefreshIntervalMs);
+    connect(m_refreshTimer, &QTimer::timeout, this, &PerfOverlay::refresh);
+}
+
+PerfOverlay::~PerfOverlay()
+{
+    if (isActive()) {
+        PerfCounters::instance().setTimingEnabled(false);
+    }
+}
+
+void PerfOverlay::setActive(bool active)
+{
+    if (active == isActive()) {
+        return;
+    }
+
+    PerfCounters::instance().setTimingEnabled(active);
+    if (!active) {
+        m_refreshTimer->stop();
+        hide();
+        return;
+    }
+
+    m_previous = takeSample();
+    m_frameStart = -1;
+    m_frameNanos = 0;
+    m_worstFrameNanos = 0;
+    m_refreshTimer->start();
+    show();
+    raise();
+    refresh();
+}
+
+bool PerfOverlay::isActive() const
+{
+    return m_refreshTimer->isActive();
+}
+
+void PerfOverlay::frameStarted()
+{
+    if (isActive()) {
+        m_frameStart = PerfCounters::instance().nowNanos();
+    }
+}
+
+bool PerfOverlay::eventFilter(QObject *watched, QEvent *event)
+{
+    if ((event->type() == QEvent::Resize || event->type() == QEvent::Move) && isActive()
+        && (watched == m_viewport || watched == m_viewport->parentWidget())) {
+        reposition();
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void PerfOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    // The viewport paints first and this box last, so the gap is one frame.
+    if (m_frameStart >= 0) {
+        m_frameNanos = PerfCounters::instance().nowNanos() - m_frameStart;
+        m_worstFrameNanos = std::max(m_worstFrameNanos, m_frameNanos);
+        m_frameStart = -1;
+    }
+
+    QPainter painter(this);
+    QColor background = AnsiText::basicColor(0, false);
+    background.setAlpha(200);
+    painter.fillRect(rect(), background);
+    painter.setPen(AnsiText::basicColor(2, true));
+
+    const QFontMetrics metrics(font());
+    int y = kPadding + metrics.ascent();
+    for (const QString &line : m_lines) {
+        painter.drawText(kPadding, y, line);
+        y += metrics.lineSpacing();
+    }
+}
+
+PerfOverlay::Sample PerfOverlay::takeSample()
+{
+    const PerfCounters &counters = PerfCounters::instance();
+    Sample sample;
+    sample.at = counters.nowNanos();
+    sample.bytesRead = load(counters.bytesRead);
+    sample.decodeNanos = load(counters.decodeNanos);
+    sample.decodeBatches = load(counters.decodeBatches);
+    sample.parseNanos = load(counters.parseNanos);
+    sample.parseBatches = load(counters.parseBatches);
+    sample.insertNanos = load(counters.insertNanos);
+    sample.insertBatches = load(counters.insertBatches);
+    sample.frames = load(counters.frames);
+    return sample;
+}
+
+void PerfOverlay::refresh()
+{
+    const Sample current = takeSample();
+    const double seconds = std::max<qint64>(1, current.at - m_previous.at) / 1e9;
+    const QLocale locale;
+
+    m_lines = {
+        tr("read    %1/s").arg(locale.formattedDataSize(qint64((current.bytesRead - m_previous.bytesRead) / seconds))),
+        tr("decode  %1").arg(perBatch(current.decodeNanos - m_previous.decodeNanos,
+                                      current.decodeBatches - m_previous.decodeBatches)),
+        tr("parse   %1").arg(perBatch(current.parseNanos - m_previous.parseNanos,
+                                      current.parseBatches - m_previous.parseBatches)),
+        tr("insert  %1").arg(perBatch(current.insertNanos - m_previous.insertNanos,
+                                      current.insertBatches - m_previous.insertBatches)),
+        tr("frame   %1 ms (worst %2), %3 fps")
+            .arg(m_frameNanos / 1e6, 0, 'f', 2)
+            .arg(m_worstFrameNanos / 1e6, 0, 'f', 2)
+            .arg((current.frames - m_previous.frames) / seconds, 0, 'f', 1),
+        tr("lines   %1 (%2)")
+            .arg(locale.toString(m_scrollback ? m_scrollback->lineCount() : 0))
+            .arg(locale.formattedDataSize(m_scrollback ? m_scrollback->memoryUsage() : 0)),
+        tr("queued  %1").arg(PerfCounters::instance().outboundDepth.load(std::memory_order_relaxed)),
+    };
+    m_previous = current;
+    m_worstFrameNanos = m_frameNanos;
+
+    const QFontMetrics metrics(font());
+    int width = 0;
+    for (const QString &line : m_lines) {
+        width = std::max(width, metrics.horizontalAdvance(line));
+    }
+    resize(width + 2 * kPadding, m_lines.size() * metrics.lineSpacing() + 2 * kPadding);
+    reposition();
+    update();
+}
+
+void PerfOverlay::reposition()
+{
+    const QPoint corner = m_viewport->mapTo(parentWidget(), QPoint(m_viewport->width(), 0));
+    move(std::max(0, corner.x() - width() - kMargin), corner.y() + kMargin);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QStringList>
+#include <QWidget>
+#include <QtGlobal>
+
+class ScrollbackModel;
+class QTimer;
+
+// Translucent stats box pinned to the top-right of the display viewport. It
+// is a sibling stacked above the display, not a viewport child, so scrolling
+// the viewport never carries it along. It samples PerfCounters once per
+// refresh and turns on section timing only while it is showing.
+class PerfOverlay : public QWidget
+{
+    Q_OBJECT
+public:
+    PerfOverlay(const ScrollbackModel *scrollback, QWidget *viewport, QWidget *parent);
+    ~PerfOverlay() override;
+
+    void setActive(bool active);
+    bool isActive() const;
+    void frameStarted();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct Sample {
+        qint64 at = 0;
+        quint64 bytesRead = 0;
+        quint64 decodeNanos = 0;
+        quint64 decodeBatches = 0;
+        quint64 parseNanos = 0;
+        quint64 parseBatches = 0;
+        quint64 insertNanos = 0;
+        quint64 insertBatches = 0;
+        quint64 frames = 0;
+    };
+
+    static Sample takeSample();
+    void refresh();
+    void reposition();
+
+    const ScrollbackModel *m_scrollback;
+    QWidget *m_viewport;
+    QTimer *m_refreshTimer;
+    Sample m_previous;
+    QStringList m_lines;
+    qint64 m_frameStart = -1;
+    qint64 m_frameNanos = 0;
+    qint64 m_worstFrameNanos = 0;
+};
@@ -0,0 +1,150 @@
+#include "ScrollbackExporter.h"
+
+#include "AnsiText.h"
+
+#include <QBrush>
+#include <QFont>
+#include <QSaveFile>
+
+namespace {
+
+constexpr int kChunkBytes = 64 * 1024;
+constexpr int kPullLines = 2048;
+
+const char kHtmlHeader[] =
+    "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>chatter transcript</title>\n"
+    "<style>body{background:#000;color:#c0c0c0;margin:0}"
+    "pre{font-family:monospace;white-space:pre-wrap;margin:8px}</style>\n"
+    "</head>\n<body>\n<pre>";
+const char kHtmlFooter[] = "</pre>\n</body>\n</html>\n";
+const char kAnsiReset[] = "\x1b[0m";
+
+QString spanStyle(const QTextCharFormat &format)
+{
+    QString style;
+    if (format.foreground().style() != Qt::NoBrush) {
+        style += QStringLiteral("color:%1;").arg(format.foreground().color().name());
+    }
+    if (format.background().style() != Qt::NoBrush) {
+        style += QStringLiteral("background:%1;").arg(format.background().color().name());
+    }
+    if (format.fontWeight() > QFont::Normal) {
+        style += QStringLiteral("font-weight:bold;");
+    }
+    if (format.fontItalic()) {
+        style += QStringLiteral("font-style:italic;");
+    }
+    if (format.fontUnderline()) {
+        style += QStringLiteral("text-decoration:underline;");
+    }
+    return style;
+}
+
+} // namespace
+
+ScrollbackExporter::ScrollbackExporter(const MessageFilter &filter, Format format, const QString &filePath,
+                                       QObject *parent)
+    : QObject(parent)
+    , m_filter(filter)
+    , m_format(format)
+    , m_filePath(filePath)
+    , m_canceled(false)
+{
+}
+
+void ScrollbackExporter::run()
+{
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        emit finished(false, file.errorString());
+        return;
+    }
+
+    QByteArray chunk;
+    chunk.reserve(kChunkBytes * 2);
+    if (m_format == Format::Html) {
+        chunk.append(kHtmlHeader);
+    }
+
+    const int total = m_filter.lineCount();
+    MessageFilter::Cursor cursor;
+    QTextCharFormat format;
+    while (cursor.line < total) {
+        if (m_canceled.load(std::memory_order_relaxed)) {
+            file.cancelWriting();
+            emit finished(false, tr("Export canceled"));
+            return;
+        }
+
+        const QStringList lines = m_filter.visibleLines(&cursor, kPullLines);
+        for (const QString &line : lines) {
+            encodeLine(line, &format, chunk);
+            if (chunk.size() >= kChunkBytes) {
+                if (file.write(chunk) != chunk.size()) {
+                    file.cancelWriting();
+                    emit finished(false, file.errorString());
+                    return;
+                }
+                chunk.clear();
+            }
+        }
+        emit progressChanged(cursor.line, total);
+    }
+
+    if (m_format == Format::Html) {
+        chunk.append(kHtmlFooter);
+    } else if (m_format == Format::Ansi) {
+        chunk.append(kAnsiReset);
+    }
+
+    if (file.write(chunk) != chunk.size() || m_canceled.load(std::memory_order_relaxed)) {
+        file.cancelWriting();
+        emit finished(false, m_canceled ? tr("Export canceled") : file.errorString());
+        return;
+    }
+    if (!file.commit()) {
+        emit finished(false, file.errorString());
+        return;
+    }
+
+    emit progressChanged(total, total);
+    emit finished(true, QString());
+}
+
+void ScrollbackExporter::cancel()
+{
+    m_canceled.store(true, std::memory_order_relaxed);
+}
+
+void ScrollbackExporter::encodeLine(const QString &line, QTextCharFormat *format, QByteArray &out) const
+{
+    switch (m_format) {
+    case Format::PlainText:
+        out.append(MessageFilter::stripAnsi(line).toUtf8());
+        break;
+    case Format::Ansi:
+        out.append(line.toUtf8());
+        break;
+    case Format::Html: {
+        QString html;
+        // Colour set on one line stays on until reset, as it does on screen.
+        const QVector<FormattedFragment> fragments = AnsiText::parse(line, QTextCharFormat(), format);
+        for (const auto &fragment : fragments) {
+            QString text = fragment.text;
+            text.remove(QLatin1Char('\n'));
+            if (text.isEmpty()) {
+                continue;
+            }
+            const QString style = spanStyle(fragment.format);
+            if (style.isEmpty()) {
+                html += text.toHtmlEscaped();
+            } else {
+                html += QStringLiteral("<span style=\"%1\">%2</span>").arg(style, text.toHtmlEscaped());
+            }
+        }
+        out.append(html.toUtf8());
+        break;
+    }
+    }
+    out.append('\n');
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MessageFilter.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QTextCharFormat>
+
+#include <atomic>
+
+// Writes the lines a filter snapshot shows to disk on a worker thread. The
+// snapshot shares the filter's pages, so the live filter only copies the page
+// it next writes to; lines are pulled in chunks and output is flushed in
+// fixed-size chunks through QSaveFile.
+class ScrollbackExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Format {
+        PlainText,
+        Ansi,
+        Html
+    };
+
+    ScrollbackExporter(const MessageFilter &filter, Format format, const QString &filePath,
+                       QObject *parent = nullptr);
+
+    void run();
+    void cancel();
+
+signals:
+    void progressChanged(int linesWritten, int totalLines);
+    void finished(bool success, const QString &error);
+
+private:
+    void encodeLine(const QString &line, QTextCharFormat *format, QByteArray &out) const;
+
+    MessageFilter m_filter;
+    Format m_format;
+    QString m_filePath;
+    std::atomic<bool> m_canceled;
+};
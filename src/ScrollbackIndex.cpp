@@ -0,0 +1,198 @@
+#include "ScrollbackIndex.h"
+
+#include "ScrollbackModel.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace {
+
+constexpr int kLinesPerBucket = 8;
+constexpr int kStaleCheckInterval = 4096;
+
+quint64 trigramKey(const QChar *text)
+{
+    return (quint64(text[0].unicode()) << 32)
+        | (quint64(text[1].unicode()) << 16)
+        | quint64(text[2].unicode());
+}
+
+// Line ids below zero belong to prepended history; buckets round toward -inf.
+int bucketOf(int id)
+{
+    return id >= 0 ? id / kLinesPerBucket : -((-id - 1) / kLinesPerBucket) - 1;
+}
+
+template <typename Compare>
+QVector<int> intersectBuckets(QVector<const QVector<int> *> lists, Compare compare)
+{
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> *lhs, const QVector<int> *rhs) {
+        if (lhs->size() != rhs->size()) {
+            return lhs->size() < rhs->size();
+        }
+        return std::less<const QVector<int> *>()(lhs, rhs);
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    QVector<int> candidates = *lists.first();
+    QVector<int> intersection;
+    for (int i = 1; i < lists.size() && !candidates.isEmpty(); ++i) {
+        intersection.clear();
+        std::set_intersection(candidates.cbegin(), candidates.cend(),
+                              lists.at(i)->cbegin(), lists.at(i)->cend(),
+                              std::back_inserter(intersection), compare);
+        candidates.swap(intersection);
+    }
+    return candidates;
+}
+
+} // namespace
+
+ScrollbackIndex::ScrollbackIndex(QObject *parent)
+    : QObject(parent)
+    , m_latestRequest(0)
+{
+}
+
+void ScrollbackIndex::appendLines(int firstLine, const QStringList &lines)
+{
+    const int first = std::max(0, firstLine - static_cast<int>(m_olderLines.size()));
+    while (m_lines.size() < first) {
+        m_lines.append(QString());
+    }
+    if (m_lines.size() > first) {
+        m_lines.resize(first);
+    }
+
+    m_lines.reserve(m_lines.size() + lines.size());
+    for (const QString &line : lines) {
+        const int id = static_cast<int>(m_lines.size());
+        m_lines.append(ScrollbackModel::foldCase(line));
+        indexLine(id, m_lines.last());
+    }
+}
+
+void ScrollbackIndex::prependLines(const QStringList &lines)
+{
+    // Bottom line first, so the downward segment's buckets stay in order.
+    m_olderLines.reserve(m_olderLines.size() + lines.size());
+    for (auto it = lines.crbegin(); it != lines.crend(); ++it) {
+        const int id = -1 - static_cast<int>(m_olderLines.size());
+        m_olderLines.append(ScrollbackModel::foldCase(*it));
+        indexLine(id, m_olderLines.last());
+    }
+}
+
+void ScrollbackIndex::clear()
+{
+    m_olderLines.clear();
+    m_lines.clear();
+    m_postings.clear();
+}
+
+void ScrollbackIndex::search(quint64 requestId, const QString &query)
+{
+    if (isStale(requestId)) {
+        return;
+    }
+
+    QVector<ScrollbackMatch> matches;
+    const QString folded = ScrollbackModel::foldCase(query);
+    if (folded.isEmpty()) {
+        emit searchFinished(requestId, query, matches);
+        return;
+    }
+
+    if (folded.size() < 3) {
+        for (int line = 0; line < lineCount(); ++line) {
+            if (line % kStaleCheckInterval == 0 && isStale(requestId)) {
+                return;
+            }
+            collectMatches(line, folded, matches);
+        }
+        emit searchFinished(requestId, query, matches);
+        return;
+    }
+
+    const int older = static_cast<int>(m_olderLines.size());
+    const QVector<int> buckets = candidateBuckets(folded);
+    for (int i = 0; i < buckets.size(); ++i) {
+        if (i % kStaleCheckInterval == 0 && isStale(requestId)) {
+            return;
+        }
+        const int firstId = buckets.at(i) * kLinesPerBucket;
+        const int firstLine = std::max(0, firstId + older);
+        const int lastLine = std::min(firstId + kLinesPerBucket + older, lineCount());
+        for (int line = firstLine; line < lastLine; ++line) {
+            collectMatches(line, folded, matches);
+        }
+    }
+
+    emit searchFinished(requestId, query, matches);
+}
+
+void ScrollbackIndex::setLatestRequest(quint64 requestId)
+{
+    m_latestRequest.store(requestId, std::memory_order_relaxed);
+}
+
+void ScrollbackIndex::indexLine(int id, const QString &folded)
+{
+    const int bucket = bucketOf(id);
+    const QChar *data = folded.constData();
+    for (int i = 0; i + 2 < folded.size(); ++i) {
+        Posting &entry = m_postings[trigramKey(data + i)];
+        QVector<int> &posting = id < 0 ? entry.older : entry.newer;
+        if (posting.isEmpty() || posting.last() != bucket) {
+            posting.append(bucket);
+        }
+    }
+}
+
+int ScrollbackIndex::lineCount() const
+{
+    return static_cast<int>(m_olderLines.size() + m_lines.size());
+}
+
+const QString &ScrollbackIndex::lineAt(int line) const
+{
+    const int older = static_cast<int>(m_olderLines.size());
+    return line < older ? m_olderLines.at(older - 1 - line) : m_lines.at(line - older);
+}
+
+bool ScrollbackIndex::isStale(quint64 requestId) const
+{
+    return requestId != m_latestRequest.load(std::memory_order_relaxed);
+}
+
+QVector<int> ScrollbackIndex::candidateBuckets(const QString &foldedQuery) const
+{
+    QVector<const QVector<int> *> older;
+    QVector<const QVector<int> *> newer;
+    const QChar *data = foldedQuery.constData();
+    for (int i = 0; i + 2 < foldedQuery.size(); ++i) {
+        const auto it = m_postings.constFind(trigramKey(data + i));
+        if (it == m_postings.constEnd()) {
+            return {};
+        }
+        older.append(&it->older);
+        newer.append(&it->newer);
+    }
+
+    // Older buckets are recorded counting down; every one precedes the newer ones.
+    QVector<int> candidates = intersectBuckets(older, std::greater<int>());
+    std::reverse(candidates.begin(), candidates.end());
+    candidates += intersectBuckets(newer, std::less<int>());
+    return candidates;
+}
+
+void ScrollbackIndex::collectMatches(int line, const QString &foldedQuery, QVector<ScrollbackMatch> &matches) const
+{
+    const QString &text = lineAt(line);
+    int from = text.indexOf(foldedQuery);
+    while (from >= 0) {
+        matches.append(ScrollbackMatch{line, from, int(foldedQuery.size())});
+        from = text.indexOf(foldedQuery, from + 1);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+struct ScrollbackMatch {
+    int line = 0;
+    int column = 0;
+    int length = 0;
+};
+
+Q_DECLARE_METATYPE(ScrollbackMatch)
+
+// Trigram index over completed scrollback lines. Lives on a worker thread;
+// postings are kept per bucket of lines and candidates are verified by scan.
+// History pages prepended above the first line grow a second, downward
+// segment, so neither end ever re-indexes the other.
+class ScrollbackIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScrollbackIndex(QObject *parent = nullptr);
+
+    void appendLines(int firstLine, const QStringList &lines);
+    void prependLines(const QStringList &lines);
+    void clear();
+    void search(quint64 requestId, const QString &query);
+    void setLatestRequest(quint64 requestId);
+
+signals:
+    void searchFinished(quint64 requestId, const QString &query, const QVector<ScrollbackMatch> &matches);
+
+private:
+    // Buckets of appended lines count up from 0 and prepended ones down from -1.
+    struct Posting {
+        QVector<int> older;
+        QVector<int> newer;
+    };
+
+    void indexLine(int id, const QString &folded);
+    int lineCount() const;
+    const QString &lineAt(int line) const;
+    bool isStale(quint64 requestId) const;
+    QVector<int> candidateBuckets(const QString &foldedQuery) const;
+    void collectMatches(int line, const QString &foldedQuery, QVector<ScrollbackMatch> &matches) const;
+
+    QVector<QString> m_olderLines;
+    QVector<QString> m_lines;
+    QHash<quint64, Posting> m_postings;
+    std::atomic<quint64> m_latestRequest;
+};
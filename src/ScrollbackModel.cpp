@@ -0,0 +1,237 @@
+#include "ScrollbackModel.h"
+
+#include <QChar>
+
+namespace {
+
+bool isWideCodePoint(uint codePoint)
+{
+    return (codePoint >= 0x1100 && codePoint <= 0x115F)
+        || (codePoint >= 0x2E80 && codePoint <= 0x303E)
+        || (codePoint >= 0x3041 && codePoint <= 0x33FF)
+        || (codePoint >= 0x3400 && codePoint <= 0x4DBF)
+        || (codePoint >= 0x4E00 && codePoint <= 0x9FFF)
+        || (codePoint >= 0xA000 && codePoint <= 0xA4CF)
+        || (codePoint >= 0xAC00 && codePoint <= 0xD7A3)
+        || (codePoint >= 0xF900 && codePoint <= 0xFAFF)
+        || (codePoint >= 0xFE30 && codePoint <= 0xFE4F)
+        || (codePoint >= 0xFF00 && codePoint <= 0xFF60)
+        || (codePoint >= 0xFFE0 && codePoint <= 0xFFE6)
+        || (codePoint >= 0x1F300 && codePoint <= 0x1F64F)
+        || (codePoint >= 0x1F900 && codePoint <= 0x1F9FF)
+        || (codePoint >= 0x20000 && codePoint <= 0x3FFFD);
+}
+
+uint codePointAt(const QString &text, int index, int *length)
+{
+    const ushort unit = text.at(index).unicode();
+    if (QChar::isHighSurrogate(unit) && index + 1 < text.size()) {
+        const ushort low = text.at(index + 1).unicode();
+        if (QChar::isLowSurrogate(low)) {
+            *length = 2;
+            return QChar::surrogateToUcs4(unit, low);
+        }
+    }
+    *length = 1;
+    return unit;
+}
+
+} // namespace
+
+ScrollbackModel::ScrollbackModel()
+{
+    clear();
+}
+
+int ScrollbackModel::lineCount() const
+{
+    return static_cast<int>(m_olderLines.size() + m_lines.size());
+}
+
+QString ScrollbackModel::lineText(int index) const
+{
+    if (index < 0 || index >= lineCount()) {
+        return QString();
+    }
+    return line(index).text;
+}
+
+int ScrollbackModel::lineColumns(int index) const
+{
+    if (index < 0 || index >= lineCount()) {
+        return 0;
+    }
+    return line(index).columns;
+}
+
+qint64 ScrollbackModel::memoryUsage() const
+{
+    // Line records plus their text; cached wrap breaks are small enough to ignore.
+    return qint64(lineCount()) * qint64(sizeof(Line)) + m_textLength * qint64(sizeof(QChar));
+}
+
+void ScrollbackModel::appendText(const QString &text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    Line &line = m_lines.last();
+    line.text.append(text);
+    line.columns += textColumns(text);
+    m_textLength += text.size();
+    line.wrapColumns = 0;
+}
+
+void ScrollbackModel::breakLine()
+{
+    m_lines.append(Line());
+}
+
+void ScrollbackModel::prependLines(const QStringList &texts)
+{
+    if (texts.isEmpty()) {
+        return;
+    }
+
+    m_olderLines.reserve(m_olderLines.size() + texts.size());
+    for (auto it = texts.crbegin(); it != texts.crend(); ++it) {
+        Line line;
+        line.text = *it;
+        line.columns = textColumns(*it);
+        m_olderLines.append(line);
+        m_textLength += it->size();
+    }
+}
+
+void ScrollbackModel::clear()
+{
+    m_olderLines.clear();
+    m_lines.clear();
+    m_lines.append(Line());
+    m_textLength = 0;
+}
+
+bool ScrollbackModel::needsReflow(int index, int columns) const
+{
+    if (index < 0 || index >= lineCount() || columns <= 0) {
+        return false;
+    }
+
+    const Line &entry = line(index);
+    if (entry.wrapColumns == columns) {
+        return false;
+    }
+    return !entry.breaks.isEmpty() || entry.columns > columns;
+}
+
+QVector<int> ScrollbackModel::computeBreaks(int index, int columns) const
+{
+    QVector<int> breaks;
+    if (index < 0 || index >= lineCount() || columns <= 0) {
+        return breaks;
+    }
+
+    const Line &entry = line(index);
+    if (entry.columns <= columns) {
+        return breaks;
+    }
+
+    int column = 0;
+    int position = 0;
+    while (position < entry.text.size()) {
+        int length = 1;
+        const int width = codePointColumns(codePointAt(entry.text, position, &length));
+        if (column > 0 && column + width > columns) {
+            breaks.append(position);
+            column = 0;
+        }
+        column += width;
+        position += length;
+    }
+    return breaks;
+}
+
+QVector<int> ScrollbackModel::appliedBreaks(int index) const
+{
+    if (index < 0 || index >= lineCount()) {
+        return {};
+    }
+    return line(index).breaks;
+}
+
+void ScrollbackModel::setAppliedBreaks(int index, int columns, const QVector<int> &breaks)
+{
+    if (index < 0 || index >= lineCount()) {
+        return;
+    }
+
+    Line &entry = line(index);
+    entry.breaks = breaks;
+    entry.wrapColumns = columns;
+}
+
+const ScrollbackModel::Line &ScrollbackModel::line(int index) const
+{
+    const int older = static_cast<int>(m_olderLines.size());
+    return index < older ? m_olderLines.at(older - 1 - index) : m_lines.at(index - older);
+}
+
+ScrollbackModel::Line &ScrollbackModel::line(int index)
+{
+    const int older = static_cast<int>(m_olderLines.size());
+    return index < older ? m_olderLines[older - 1 - index] : m_lines[index - older];
+}
+
+int ScrollbackModel::codePointColumns(uint codePoint)
+{
+    if (codePoint < 0x20) {
+        return 0;
+    }
+    if (codePoint < 0x7F) {
+        return 1;
+    }
+
+    const QChar::Category category = QChar::category(codePoint);
+    if (category == QChar::Mark_NonSpacing || category == QChar::Mark_Enclosing
+        || category == QChar::Other_Format) {
+        return 0;
+    }
+    return isWideCodePoint(codePoint) ? 2 : 1;
+}
+
+int ScrollbackModel::textColumns(const QString &text)
+{
+    int columns = 0;
+    int position = 0;
+    while (position < text.size()) {
+        int length = 1;
+        columns += codePointColumns(codePointAt(text, position, &length));
+        position += length;
+    }
+    return columns;
+}
+
+QString ScrollbackModel::foldCase(const QString &text)
+{
+    QString folded = text;
+    QChar *data = folded.data();
+    int position = 0;
+    while (position < folded.size()) {
+        int length = 1;
+        const uint codePoint = codePointAt(text, position, &length);
+        const uint mapped = QChar::toCaseFolded(codePoint);
+        // Simple folding maps one code point to one; keep the original if the
+        // UTF-16 width would change, so offsets stay valid in the source text.
+        if (mapped != codePoint && QChar::requiresSurrogates(mapped) == (length == 2)) {
+            if (length == 2) {
+                data[position] = QChar(QChar::highSurrogate(mapped));
+                data[position + 1] = QChar(QChar::lowSurrogate(mapped));
+            } else {
+                data[position] = QChar(static_cast<ushort>(mapped));
+            }
+        }
+        position += length;
+    }
+    return folded;
+}
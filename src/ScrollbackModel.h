@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One entry per block of the display document; soft-wrap breaks are cached per line.
+// Prepended history is kept newest-first in its own vector, so paging in a
+// page costs only that page.
+class ScrollbackModel
+{
+public:
+    ScrollbackModel();
+
+    int lineCount() const;
+    QString lineText(int index) const;
+    int lineColumns(int index) const;
+    qint64 memoryUsage() const;
+
+    void appendText(const QString &text);
+    void breakLine();
+    void prependLines(const QStringList &texts);
+    void clear();
+
+    bool needsReflow(int index, int columns) const;
+    QVector<int> computeBreaks(int index, int columns) const;
+    QVector<int> appliedBreaks(int index) const;
+    void setAppliedBreaks(int index, int columns, const QVector<int> &breaks);
+
+    static int codePointColumns(uint codePoint);
+    static int textColumns(const QString &text);
+    // Case folding that never changes length, so folded offsets are columns of the original.
+    static QString foldCase(const QString &text);
+
+private:
+    struct Line {
+        QString text;
+        QVector<int> breaks;
+        int columns = 0;
+        int wrapColumns = 0;
+    };
+
+    const Line &line(int index) const;
+    Line &line(int index);
+
+    QVector<Line> m_olderLines;
+    QVector<Line> m_lines;
+    qint64 m_textLength = 0;
+};
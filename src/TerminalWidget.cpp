@@ -1,30 +1,161 @@
 #include "TerminalWidget.h"
 
+#include "AnsiText.h"
+#include "ChatLineParser.h"
+#include "CommandCatalog.h"
+#include "CommandValidator.h"
+#include "FindBar.h"
+#include "HistoryStore.h"
+#include "KeyLatencyProbe.h"
+#include "MessageFilter.h"
+#include "PerfCounters.h"
+#include "PerfOverlay.h"
+#include "TraceRecorder.h"
+#include "XtermKeyTable.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QApplication>
 #include <QByteArray>
 #include <QClipboard>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QEvent>
 #include <QFocusEvent>
 #include <QFontDatabase>
 #include <QFontMetricsF>
 #include <QGuiApplication>
+#include <QInputMethodEvent>
 #include <QKeyEvent>
+#include <QLabel>
+#include <QMenu>
+#include <QMimeData>
+#include <QMouseEvent>
+#include <QPalette>
 #include <QResizeEvent>
+#include <QScrollBar>
+#include <QTextBlock>
 #include <QTextBrowser>
 #include <QTextCharFormat>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QTextEdit>
+#include <QTextOption>
+#include <QThread>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QLineEdit>
+#include <QtGlobal>
 
 #include <algorithm>
 #include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr qint64 kReflowBudgetMs = 8;
+// Left to the View menu's raw-mode action so the mode can always be toggled off.
+constexpr int kRawModeToggleKey = Qt::Key_R;
+constexpr int kDefaultResizeDebounceMs = 120;
+constexpr int kEchoExpiryInterval = 250;
+constexpr int kMaxHighlightedMatches = 1000;
+// Longest run of continuation lines walked back to find their message.
+constexpr int kMessageIdLookback = 8;
+// Longest unfinished "\e[?..." tail held over to the next read.
+constexpr int kMaxModeCarry = 32;
+
+int defaultResizeDebounceInterval()
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue("CHATTER_RESIZE_DEBOUNCE_MS", &ok);
+    if (!ok || value < 0) {
+        return kDefaultResizeDebounceMs;
+    }
+    return value;
+}
+
+class ScrollAnchor
+{
+public:
+    explicit ScrollAnchor(QTextBrowser *display)
+        : m_display(display)
+    {
+        QScrollBar *scrollBar = m_display->verticalScrollBar();
+        m_atBottom = scrollBar->value() >= scrollBar->maximum();
+
+        const QTextBlock block = m_display->cursorForPosition(QPoint(0, 0)).block();
+        m_blockNumber = block.blockNumber();
+        m_offset = scrollBar->value() - blockTop(block);
+    }
+
+    void restore() const
+    {
+        QScrollBar *scrollBar = m_display->verticalScrollBar();
+        if (m_atBottom) {
+            scrollBar->setValue(scrollBar->maximum());
+            return;
+        }
+
+        const QTextBlock block = m_display->document()->findBlockByNumber(m_blockNumber);
+        if (block.isValid()) {
+            scrollBar->setValue(blockTop(block) + m_offset);
+        }
+    }
+
+private:
+    int blockTop(const QTextBlock &block) const
+    {
+        if (!block.isValid()) {
+            return 0;
+        }
+        QAbstractTextDocumentLayout *layout = m_display->document()->documentLayout();
+        return static_cast<int>(layout->blockBoundingRect(block).top());
+    }
+
+    QTextBrowser *m_display;
+    int m_blockNumber = 0;
+    int m_offset = 0;
+    bool m_atBottom = true;
+};
+
+// Soft-wrap breaks live in the document as line separators; copies, drags
+// and the selection clipboard get the logical lines without them.
+class TerminalDisplay : public QTextBrowser
+{
+public:
+    using QTextBrowser::QTextBrowser;
+
+protected:
+    QMimeData *createMimeDataFromSelection() const override
+    {
+        QTextDocument selection;
+        QTextCursor(&selection).insertFragment(textCursor().selection());
+
+        const QString separator(QChar::LineSeparator);
+        for (QTextCursor found = selection.find(separator); !found.isNull(); found = selection.find(separator, found)) {
+            found.removeSelectedText();
+        }
+
+        auto *data = new QMimeData;
+        data->setText(selection.toPlainText());
+        data->setHtml(selection.toHtml());
+        return data;
+    }
+};
+
+} // namespace
 
 TerminalWidget::TerminalWidget(QWidget *parent)
     : QWidget(parent)
-    , m_display(new QTextBrowser(this))
+    , m_display(new TerminalDisplay(this))
+    , m_findBar(new FindBar(this))
     , m_entry(new QLineEdit(this))
+    , m_historyLabel(new QLabel(this))
+    , m_validationLabel(new QLabel(this))
+    , m_reflowTimer(new QTimer(this))
+    , m_sizeUpdateTimer(new QTimer(this))
+    , m_echoTimer(new QTimer(this))
+    , m_searchThread(new QThread(this))
+    , m_searchIndex(new ScrollbackIndex)
 {
     setFocusPolicy(Qt::StrongFocus);
 
@@ -36,20 +167,92 @@ TerminalWidget::TerminalWidget(QWidget *parent)
         m_display->setObjectName(QStringLiteral("terminalDisplay"));
         m_display->installEventFilter(this);
         m_display->setFocusPolicy(Qt::ClickFocus);
+        m_display->viewport()->installEventFilter(this);
+        m_display->setContextMenuPolicy(Qt::CustomContextMenu);
+        connect(m_display, &QWidget::customContextMenuRequested,
+                this, &TerminalWidget::showDisplayContextMenu);
+        m_display->setReadOnly(true);
         m_display->setLineWrapMode(QTextEdit::NoWrap);
+        m_display->setWordWrapMode(QTextOption::NoWrap);
+        m_display->setUndoRedoEnabled(false);
         m_display->setContentsMargins(0, 0, 0, 0);
         m_display->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
         if (auto *document = m_display->document()) {
             document->setDocumentMargin(0);
+            QTextOption textOption = document->defaultTextOption();
+            textOption.setFlags(textOption.flags() & ~QTextOption::AddSpaceForLineAndParagraphSeparators);
+            document->setDefaultTextOption(textOption);
         }
+        connect(m_display->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+            if (m_reflowSweepLine >= 0) {
+                reflowVisibleLines();
+            }
+            QScrollBar *scrollBar = m_display->verticalScrollBar();
+            if (value == scrollBar->minimum() && scrollBar->maximum() > scrollBar->minimum()) {
+                emit historyRequested();
+            }
+        });
+        m_perfOverlay = new PerfOverlay(&m_scrollback, m_display->viewport(), this);
         layout->addWidget(m_display);
     }
 
+    m_reflowTimer->setInterval(0);
+    connect(m_reflowTimer, &QTimer::timeout, this, &TerminalWidget::reflowPendingLines);
+
+    m_sizeUpdateTimer->setSingleShot(true);
+    m_sizeUpdateTimer->setInterval(defaultResizeDebounceInterval());
+    connect(m_sizeUpdateTimer, &QTimer::timeout, this, &TerminalWidget::emitTerminalSize);
+
+    m_echoClock.start();
+    m_echoTimer->setInterval(kEchoExpiryInterval);
+    connect(m_echoTimer, &QTimer::timeout, this, [this]() {
+        hidePrediction();
+        m_echo.expire(m_echoClock.elapsed());
+        if (!m_echo.hasPending()) {
+            m_echoTimer->stop();
+        }
+        showPrediction();
+    });
+
+    m_searchIndex->moveToThread(m_searchThread);
+    connect(m_searchThread, &QThread::finished, m_searchIndex, &QObject::deleteLater);
+    connect(m_searchIndex, &ScrollbackIndex::searchFinished, this, &TerminalWidget::handleSearchFinished);
+    m_searchThread->start(QThread::LowPriority);
+
+    if (m_findBar) {
+        m_findBar->hide();
+        connect(m_findBar, &FindBar::queryChanged, this, &TerminalWidget::runSearch);
+        connect(m_findBar, &FindBar::nextRequested, this, [this]() { stepMatch(1); });
+        connect(m_findBar, &FindBar::previousRequested, this, [this]() { stepMatch(-1); });
+        connect(m_findBar, &FindBar::closed, this, [this]() {
+            clearSearch();
+            if (m_entry) {
+                m_entry->setFocus(Qt::OtherFocusReason);
+            }
+        });
+        layout->addWidget(m_findBar);
+    }
+
+    if (m_historyLabel) {
+        m_historyLabel->hide();
+        layout->addWidget(m_historyLabel);
+    }
+
+    if (m_validationLabel) {
+        QPalette palette = m_validationLabel->palette();
+        palette.setColor(QPalette::WindowText, AnsiText::basicColor(1, true));
+        m_validationLabel->setPalette(palette);
+        m_validationLabel->hide();
+        layout->addWidget(m_validationLabel);
+    }
+
     if (m_entry) {
         m_entry->setObjectName(QStringLiteral("terminalEntry"));
         m_entry->setClearButtonEnabled(true);
         m_entry->setPlaceholderText(tr("Type a command and press Enter"));
+        m_entry->installEventFilter(this);
         connect(m_entry, &QLineEdit::returnPressed, this, &TerminalWidget::submitEntryText);
+        connect(m_entry, &QLineEdit::textChanged, this, &TerminalWidget::updateEntryValidation);
         layout->addWidget(m_entry);
     }
 
@@ -68,11 +271,91 @@ TerminalWidget::TerminalWidget(QWidget *parent)
     scheduleTerminalSizeUpdate();
 }
 
+TerminalWidget::~TerminalWidget()
+{
+    m_searchThread->quit();
+    m_searchThread->wait();
+}
+
 QTextBrowser *TerminalWidget::display() const
 {
     return m_display.data();
 }
 
+void TerminalWidget::receiveOutput(const QString &text, MessageFilter *filter, HistoryStore *history)
+{
+    if (history) {
+        history->append(text);
+    }
+    observeOutput(text);
+    if (filter) {
+        filter->setStreaming(m_rawMode || m_alternateScreen);
+    }
+    const QString shown = filter ? filter->process(text) : text;
+    if (!shown.isEmpty()) {
+        appendOutput(shown);
+    }
+}
+
+void TerminalWidget::appendOutput(const QString &text, bool isError)
+{
+    const TraceScope trace("appendOutput");
+    if (!m_display) {
+        return;
+    }
+
+    hidePrediction();
+
+    QString sanitized = text;
+    sanitized.replace("\r\n", "\n");
+    if (sanitized.endsWith(QLatin1Char('\n'))) {
+        sanitized.chop(1);
+    }
+
+    PerfCounters &counters = PerfCounters::instance();
+    const QTextCharFormat baseFormat = baseTextFormat(isError);
+    QVector<FormattedFragment> fragments;
+    {
+        const PerfTimer timer(counters.parseNanos, counters.parseBatches);
+        fragments = AnsiText::parse(sanitized, baseFormat);
+    }
+    const PerfTimer insertTimer(counters.insertNanos, counters.insertBatches);
+
+    const int firstLine = m_scrollback.lineCount() - 1;
+
+    QTextCursor cursor = m_display->textCursor();
+    cursor.movePosition(QTextCursor::End);
+
+    cursor.beginEditBlock();
+    const DocumentWriter::Overlays highlights = highlightOutput(fragments);
+    DocumentWriter::appendFragments(cursor, fragments, &m_scrollback, highlights);
+    reflowLines(firstLine, m_scrollback.lineCount() - 1);
+    {
+        // The document lays out the edit block's changes when it closes,
+        // and scrolling to the new end forces layout down to it.
+        const TraceScope layoutTrace("layout");
+        cursor.endEditBlock();
+        m_display->setTextCursor(cursor);
+        m_display->ensureCursorVisible();
+    }
+
+    indexCompletedLines();
+    showPrediction();
+}
+
+QTextCharFormat TerminalWidget::baseTextFormat(bool isError) const
+{
+    QTextCharFormat baseFormat;
+    baseFormat.setForeground(isError ? QBrush(Qt::red)
+                                    : QBrush(m_display->palette().color(QPalette::Text)));
+    baseFormat.setBackground(Qt::NoBrush);
+    baseFormat.setFont(m_display->font());
+    baseFormat.setFontWeight(QFont::Normal);
+    baseFormat.setFontItalic(false);
+    baseFormat.setFontUnderline(false);
+    return baseFormat;
+}
+
 void TerminalWidget::setTerminalFont(const QFont &font)
 {
     if (m_display) {
@@ -96,6 +379,7 @@ void TerminalWidget::setTerminalFont(const QFont &font)
         m_entry->setFont(font);
     }
 
+    updateWrapColumns();
     scheduleTerminalSizeUpdate();
 }
 
@@ -107,8 +391,230 @@ QFont TerminalWidget::terminalFont() const
     return font();
 }
 
+ScrollbackModel *TerminalWidget::scrollback()
+{
+    return &m_scrollback;
+}
+
+MessageStore *TerminalWidget::messages()
+{
+    return &m_messages;
+}
+
+CommandHistory *TerminalWidget::commandHistory()
+{
+    return &m_commandHistory;
+}
+
+void TerminalWidget::reflowLines(int firstLine, int lastLine)
+{
+    const TraceScope trace("reflowLines");
+    if (!m_display || m_wrapColumns <= 0) {
+        return;
+    }
+
+    firstLine = std::max(0, firstLine);
+    lastLine = std::min(lastLine, m_scrollback.lineCount() - 1);
+    if (firstLine > lastLine) {
+        return;
+    }
+
+    QTextCursor cursor(m_display->document());
+    cursor.beginEditBlock();
+    for (int index = firstLine; index <= lastLine; ++index) {
+        reflowLine(cursor, index);
+    }
+    cursor.endEditBlock();
+}
+
+void TerminalWidget::indexCompletedLines()
+{
+    if (!m_display) {
+        return;
+    }
+
+    const QStringList mentions = m_pendingMentions;
+    m_pendingMentions.clear();
+    for (const QString &text : mentions) {
+        emit mentionDetected(text);
+    }
+
+    const int completedLines = m_scrollback.lineCount() - 1;
+    if (completedLines <= m_indexedLineCount) {
+        return;
+    }
+
+    QStringList lines;
+    lines.reserve(completedLines - m_indexedLineCount);
+    for (int line = m_indexedLineCount; line < completedLines; ++line) {
+        const QString text = m_scrollback.lineText(line);
+        m_messageIds.addLine(line, text);
+        m_completer.harvestLine(text);
+        lines.append(text);
+    }
+
+    const int firstLine = m_indexedLineCount;
+    m_indexedLineCount = completedLines;
+    m_messages.addLines(firstLine, lines, m_replayingHistory ? 0 : QDateTime::currentSecsSinceEpoch());
+
+    ScrollbackIndex *index = m_searchIndex;
+    QMetaObject::invokeMethod(index, [index, firstLine, lines]() {
+        index->appendLines(firstLine, lines);
+    });
+}
+
+void TerminalWidget::linesPrepended(const QStringList &texts)
+{
+    if (texts.isEmpty()) {
+        return;
+    }
+
+    const int count = static_cast<int>(texts.size());
+    m_scrollback.prependLines(texts);
+    m_messageIds.prependLines(texts);
+    m_messages.prependLines(texts);
+    for (const QString &text : texts) {
+        m_completer.harvestLine(text);
+    }
+    m_indexedLineCount += count;
+    if (m_reflowSweepLine >= 0) {
+        m_reflowSweepLine += count;
+    }
+    for (ScrollbackMatch &match : m_searchMatches) {
+        match.line += count;
+    }
+
+    ScrollbackIndex *index = m_searchIndex;
+    QMetaObject::invokeMethod(index, [index, texts]() {
+        index->prependLines(texts);
+    });
+
+    reflowLines(0, count - 1);
+}
+
+void TerminalWidget::setReplayingHistory(bool replaying)
+{
+    m_replayingHistory = replaying;
+}
+
+void TerminalWidget::resetScrollback()
+{
+    m_scrollback.clear();
+    m_messageIds.clear();
+    m_messages.clear();
+    m_indexedLineCount = 0;
+    m_pendingMentions.clear();
+    m_reflowSweepLine = -1;
+    m_reflowTimer->stop();
+    m_prediction = QTextCursor();
+    m_echo.abandon();
+    clearSearch();
+
+    ScrollbackIndex *index = m_searchIndex;
+    QMetaObject::invokeMethod(index, [index]() {
+        index->clear();
+    });
+}
+
+void TerminalWidget::showFindBar()
+{
+    if (m_findBar) {
+        m_findBar->activate();
+        runSearch(m_findBar->query());
+    }
+}
+
+bool TerminalWidget::jumpToMessage(const QString &id)
+{
+    return jumpToLine(m_messageIds.lineForId(id));
+}
+
+bool TerminalWidget::jumpToLine(int line)
+{
+    const int position = documentPosition(line, 0);
+    if (line < 0 || position < 0) {
+        return false;
+    }
+
+    QTextCursor cursor(m_display->document());
+    cursor.setPosition(position);
+    cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+    m_display->setTextCursor(cursor);
+    m_display->ensureCursorVisible();
+    return true;
+}
+
+QString TerminalWidget::messageIdNearLine(int line) const
+{
+    if (line < 0 || line >= m_scrollback.lineCount()) {
+        return QString();
+    }
+
+    // Only the clicked message counts: its own line, or the chat line that
+    // an indented continuation belongs to. Anything else has no id.
+    const int firstLine = std::max(0, line - kMessageIdLookback);
+    for (int index = line; index >= firstLine; --index) {
+        const QString text = m_scrollback.lineText(index);
+        ChatLine chat;
+        if (ChatLineParser::parse(text, &chat)) {
+            return MessageIdIndex::extractId(text);
+        }
+        if (!text.startsWith(QLatin1Char(' ')) && !text.startsWith(QLatin1Char('\t'))) {
+            return QString();
+        }
+    }
+    return QString();
+}
+
+void TerminalWidget::setHighlightRules(const QVector<HighlightRule> &rules)
+{
+    m_highlighter.setRules(rules);
+}
+
+void TerminalWidget::setResizeDebounceInterval(int milliseconds)
+{
+    m_sizeUpdateTimer->setInterval(std::max(0, milliseconds));
+}
+
+int TerminalWidget::resizeDebounceInterval() const
+{
+    return m_sizeUpdateTimer->interval();
+}
+
+quint64 TerminalWidget::suppressedSizeUpdates() const
+{
+    return m_suppressedSizeUpdates;
+}
+
 bool TerminalWidget::eventFilter(QObject *watched, QEvent *event)
 {
+    if (m_rawMode && event && (watched == m_entry || watched == m_display)) {
+        if (event->type() == QEvent::KeyPress || event->type() == QEvent::ShortcutOverride) {
+            return handleRawKeyEvent(static_cast<QKeyEvent *>(event));
+        }
+        if (event->type() == QEvent::InputMethod) {
+            const QString committed = static_cast<QInputMethodEvent *>(event)->commitString();
+            if (!committed.isEmpty()) {
+                emit keysGenerated(committed.toUtf8());
+            }
+            return true;
+        }
+    }
+
+    if (m_display && event && watched == m_display->viewport()) {
+        if (handleViewportEvent(event)) {
+            return true;
+        }
+        return QWidget::eventFilter(watched, event);
+    }
+
+    if (m_entry && event && watched == m_entry) {
+        if (handleEntryEvent(event)) {
+            return true;
+        }
+        return QWidget::eventFilter(watched, event);
+    }
+
     if (!m_display || watched != m_display) {
         return QWidget::eventFilter(watched, event);
     }
@@ -156,6 +662,7 @@ bool TerminalWidget::eventFilter(QObject *watched, QEvent *event)
 void TerminalWidget::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
+    updateWrapColumns();
     scheduleTerminalSizeUpdate();
 }
 
@@ -174,42 +681,83 @@ void TerminalWidget::submitEntryText()
     }
 
     const QString text = m_entry->text();
+    updateEntryValidation();
+    if (!m_entryError.isEmpty()) {
+        QApplication::beep();
+        return;
+    }
 
+    // Checked before the write, while a password prompt still has echo off.
+    const bool echoed = !m_echoCheck || m_echoCheck();
     QByteArray data = text.toUtf8();
     data.append('\r');
 
     emit bytesGenerated(data);
+    emit entrySubmitted(text);
+
+    if (echoed) {
+        m_commandHistory.add(text);
+    }
+    m_historyPosition = -1;
 
     m_entry->clear();
 }
 
-void TerminalWidget::scheduleTerminalSizeUpdate()
+void TerminalWidget::updateEntryValidation()
 {
-    if (m_pendingSizeUpdate) {
+    if (!m_entry || !m_validationLabel) {
         return;
     }
 
-    m_pendingSizeUpdate = true;
-    QTimer::singleShot(0, this, [this]() {
-        m_pendingSizeUpdate = false;
-        emitTerminalSize();
-    });
+    const QString error = CommandValidator::validate(m_entry->text());
+    if (error == m_entryError) {
+        return;
+    }
+
+    m_entryError = error;
+    m_validationLabel->setText(error);
+    m_validationLabel->setVisible(!error.isEmpty());
+    m_entry->setToolTip(error);
+}
+
+void TerminalWidget::scheduleTerminalSizeUpdate()
+{
+    if (m_sizeUpdateTimer->isActive()) {
+        ++m_suppressedSizeUpdates;
+    }
+    m_sizeUpdateTimer->start();
 }
 
 void TerminalWidget::emitTerminalSize()
 {
-    if (!m_display) {
+    const QSize size = computeTerminalSize();
+    if (!size.isValid()) {
         return;
     }
 
+    if (size == m_lastEmittedSize) {
+        ++m_suppressedSizeUpdates;
+        return;
+    }
+
+    m_lastEmittedSize = size;
+    emit terminalSizeChanged(size.width(), size.height());
+}
+
+QSize TerminalWidget::computeTerminalSize() const
+{
+    if (!m_display) {
+        return QSize();
+    }
+
     QWidget *viewport = m_display->viewport();
     if (!viewport) {
-        return;
+        return QSize();
     }
 
     const QSize viewportSize = viewport->size();
     if (viewportSize.width() <= 0 || viewportSize.height() <= 0) {
-        return;
+        return QSize();
     }
 
     const QFontMetricsF metrics(m_display->font());
@@ -219,6 +767,760 @@ void TerminalWidget::emitTerminalSize()
     const int columns = std::max(1, static_cast<int>(std::floor(viewportSize.width() / charWidth)));
     const int rows = std::max(1, static_cast<int>(std::floor(viewportSize.height() / charHeight)));
 
-    emit terminalSizeChanged(columns, rows);
+    return QSize(columns, rows);
+}
+
+void TerminalWidget::updateWrapColumns()
+{
+    const QSize size = computeTerminalSize();
+    if (!size.isValid() || size.width() == m_wrapColumns) {
+        return;
+    }
+
+    m_wrapColumns = size.width();
+    m_reflowSweepLine = m_scrollback.lineCount() - 1;
+    reflowVisibleLines();
+    m_reflowTimer->start();
+}
+
+void TerminalWidget::reflowVisibleLines()
+{
+    if (!m_display || m_reflowing || m_wrapColumns <= 0) {
+        return;
+    }
+
+    QWidget *viewport = m_display->viewport();
+    if (!viewport) {
+        return;
+    }
+
+    const int rows = std::max(1, computeTerminalSize().height());
+    const int firstLine = m_display->cursorForPosition(QPoint(0, 0)).blockNumber() - rows;
+    const int lastLine = m_display->cursorForPosition(QPoint(0, viewport->height())).blockNumber();
+
+    m_reflowing = true;
+    const ScrollAnchor anchor(m_display);
+    reflowLines(firstLine, lastLine);
+    anchor.restore();
+    m_reflowing = false;
+}
+
+void TerminalWidget::reflowPendingLines()
+{
+    const TraceScope trace("reflowPendingLines");
+    if (!m_display || m_reflowSweepLine < 0 || m_wrapColumns <= 0) {
+        m_reflowSweepLine = -1;
+        m_reflowTimer->stop();
+        return;
+    }
+
+    QElapsedTimer budget;
+    budget.start();
+
+    m_reflowing = true;
+    const ScrollAnchor anchor(m_display);
+
+    QTextCursor cursor(m_display->document());
+    cursor.beginEditBlock();
+    bool changed = false;
+    while (m_reflowSweepLine >= 0 && budget.elapsed() < kReflowBudgetMs) {
+        changed = reflowLine(cursor, m_reflowSweepLine) || changed;
+        --m_reflowSweepLine;
+    }
+    cursor.endEditBlock();
+
+    if (changed) {
+        anchor.restore();
+    }
+    m_reflowing = false;
+
+    if (m_reflowSweepLine < 0) {
+        m_reflowTimer->stop();
+    }
+}
+
+bool TerminalWidget::reflowLine(QTextCursor &cursor, int index)
+{
+    if (!m_scrollback.needsReflow(index, m_wrapColumns)) {
+        return false;
+    }
+
+    const QTextBlock block = m_display->document()->findBlockByNumber(index);
+    if (!block.isValid()) {
+        return false;
+    }
+
+    const QVector<int> previousBreaks = m_scrollback.appliedBreaks(index);
+    const QVector<int> breaks = m_scrollback.computeBreaks(index, m_wrapColumns);
+    m_scrollback.setAppliedBreaks(index, m_wrapColumns, breaks);
+    if (previousBreaks == breaks) {
+        return false;
+    }
+
+    const int blockStart = block.position();
+    for (int i = previousBreaks.size() - 1; i >= 0; --i) {
+        const int position = blockStart + previousBreaks.at(i) + i;
+        cursor.setPosition(position);
+        cursor.setPosition(position + 1, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+    }
+
+    for (int i = breaks.size() - 1; i >= 0; --i) {
+        cursor.setPosition(blockStart + breaks.at(i));
+        cursor.insertText(QString(QChar::LineSeparator));
+    }
+    return true;
+}
+
+int TerminalWidget::documentPosition(int line, int column) const
+{
+    if (!m_display) {
+        return -1;
+    }
+
+    const QTextBlock block = m_display->document()->findBlockByNumber(line);
+    if (!block.isValid()) {
+        return -1;
+    }
+
+    const QVector<int> breaks = m_scrollback.appliedBreaks(line);
+    const int separators = static_cast<int>(std::upper_bound(breaks.cbegin(), breaks.cend(), column) - breaks.cbegin());
+    return block.position() + column + separators;
+}
+
+void TerminalWidget::runSearch(const QString &query)
+{
+    ++m_searchRequestId;
+    m_searchIndex->setLatestRequest(m_searchRequestId);
+
+    if (query.isEmpty()) {
+        clearSearch();
+        return;
+    }
+
+    indexCompletedLines();
+    if (m_findBar) {
+        m_findBar->setSearching();
+    }
+
+    ScrollbackIndex *index = m_searchIndex;
+    const quint64 requestId = m_searchRequestId;
+    QMetaObject::invokeMethod(index, [index, requestId, query]() {
+        index->search(requestId, query);
+    });
+}
+
+void TerminalWidget::handleSearchFinished(quint64 requestId,
+                                          const QString &query,
+                                          const QVector<ScrollbackMatch> &matches)
+{
+    Q_UNUSED(query);
+
+    if (requestId != m_searchRequestId) {
+        return;
+    }
+
+    m_searchMatches = matches;
+    m_currentMatch = static_cast<int>(m_searchMatches.size()) - 1;
+    stepMatch(0);
+}
+
+void TerminalWidget::stepMatch(int delta)
+{
+    const int total = static_cast<int>(m_searchMatches.size());
+    if (total == 0) {
+        m_currentMatch = -1;
+        updateSearchHighlights();
+        if (m_findBar) {
+            m_findBar->setMatchStatus(-1, 0);
+        }
+        return;
+    }
+
+    m_currentMatch = ((std::max(0, m_currentMatch) + delta) % total + total) % total;
+    updateSearchHighlights();
+    if (m_findBar) {
+        m_findBar->setMatchStatus(m_currentMatch, total);
+    }
+
+    const ScrollbackMatch &match = m_searchMatches.at(m_currentMatch);
+    const int position = documentPosition(match.line, match.column);
+    if (m_display && position >= 0) {
+        QTextCursor cursor(m_display->document());
+        cursor.setPosition(position);
+        m_display->setTextCursor(cursor);
+        m_display->ensureCursorVisible();
+    }
+}
+
+void TerminalWidget::updateSearchHighlights()
+{
+    if (!m_display) {
+        return;
+    }
+
+    QList<QTextEdit::ExtraSelection> selections;
+    const int total = static_cast<int>(m_searchMatches.size());
+    if (total > 0) {
+        const QPalette palette = m_display->palette();
+
+        QTextCharFormat matchFormat;
+        matchFormat.setBackground(palette.color(QPalette::Highlight).darker(200));
+
+        QTextCharFormat currentFormat;
+        currentFormat.setBackground(palette.color(QPalette::Highlight));
+        currentFormat.setForeground(palette.color(QPalette::HighlightedText));
+
+        const int first = std::max(0, std::min(m_currentMatch - kMaxHighlightedMatches / 2,
+                                               total - kMaxHighlightedMatches));
+        const int last = std::min(total, first + kMaxHighlightedMatches);
+        for (int i = first; i < last; ++i) {
+            const ScrollbackMatch &match = m_searchMatches.at(i);
+            const int start = documentPosition(match.line, match.column);
+            const int end = documentPosition(match.line, match.column + match.length - 1) + 1;
+            if (start < 0 || end <= start) {
+                continue;
+            }
+
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(m_display->document());
+            selection.cursor.setPosition(start);
+            selection.cursor.setPosition(end, QTextCursor::KeepAnchor);
+            selection.format = (i == m_currentMatch) ? currentFormat : matchFormat;
+            selections.append(selection);
+        }
+    }
+
+    m_display->setExtraSelections(selections);
+}
+
+void TerminalWidget::clearSearch()
+{
+    m_searchMatches.clear();
+    m_currentMatch = -1;
+    updateSearchHighlights();
+    if (m_findBar) {
+        m_findBar->setMatchStatus(-1, 0);
+    }
+}
+
+bool TerminalWidget::handleViewportEvent(QEvent *event)
+{
+    if (event->type() == QEvent::Paint) {
+        PerfCounters::instance().frames.fetch_add(1, std::memory_order_relaxed);
+        if (m_perfOverlay) {
+            m_perfOverlay->frameStarted();
+        }
+        if (m_latencyProbe) {
+            m_latencyProbe->mark(LatencyStage::Paint);
+        }
+        return false;
+    }
+
+    if (event->type() == QEvent::MouseButtonPress) {
+        m_pressPosition = static_cast<QMouseEvent *>(event)->pos();
+        return false;
+    }
+
+    if (event->type() != QEvent::MouseButtonRelease) {
+        return false;
+    }
+
+    auto *mouseEvent = static_cast<QMouseEvent *>(event);
+    const QPoint position = mouseEvent->pos();
+    if (mouseEvent->button() != Qt::LeftButton
+        || (position - m_pressPosition).manhattanLength() > 3
+        || m_display->textCursor().hasSelection()
+        || !m_display->anchorAt(position).isEmpty()) {
+        return false;
+    }
+
+    if (!m_entry || (!m_entry->text().isEmpty() && !m_entry->text().startsWith(QStringLiteral("/reply ")))) {
+        return false;
+    }
+
+    const QString id = messageIdNearLine(m_display->cursorForPosition(position).blockNumber());
+    if (!id.isEmpty()) {
+        prefillEntry(QStringLiteral("/reply %1 ").arg(id));
+    }
+    return false;
+}
+
+void TerminalWidget::setRawMode(bool enabled)
+{
+    m_rawModeAuto = false;
+    applyRawMode(enabled);
+}
+
+bool TerminalWidget::rawMode() const
+{
+    return m_rawMode;
+}
+
+void TerminalWidget::observeOutput(const QString &chunk)
+{
+    // A mode sequence split across reads is finished with the next chunk.
+    const QLatin1String privateMode("\x1b[?");
+    const QString text = m_modeCarry.isEmpty() ? chunk : m_modeCarry + chunk;
+    m_modeCarry.clear();
+
+    int from = text.indexOf(privateMode);
+    while (from >= 0) {
+        int end = from + privateMode.size();
+        while (end < text.size() && (text.at(end).isDigit() || text.at(end) == QLatin1Char(';'))) {
+            ++end;
+        }
+        if (end >= text.size()) {
+            if (text.size() - from <= kMaxModeCarry) {
+                m_modeCarry = text.mid(from);
+            }
+            break;
+        }
+
+        const QChar final = text.at(end);
+        if (final == QLatin1Char('h') || final == QLatin1Char('l')) {
+            const bool set = final == QLatin1Char('h');
+            int parameter = 0;
+            for (int i = from + privateMode.size(); i <= end; ++i) {
+                const QChar ch = text.at(i);
+                if (ch.isDigit()) {
+                    parameter = parameter * 10 + ch.digitValue();
+                    continue;
+                }
+                if (parameter == 1) {
+                    m_applicationCursor = set;
+                } else if (parameter == 47 || parameter == 1047 || parameter == 1049) {
+                    m_alternateScreen = set;
+                    if (set && !m_rawMode) {
+                        m_rawModeAuto = true;
+                        applyRawMode(true);
+                    } else if (!set && m_rawModeAuto) {
+                        m_rawModeAuto = false;
+                        applyRawMode(false);
+                    }
+                }
+                parameter = 0;
+            }
+        }
+        from = text.indexOf(privateMode, end);
+    }
+    if (m_modeCarry.isEmpty()) {
+        if (text.endsWith(QLatin1String("\x1b["))) {
+            m_modeCarry = QStringLiteral("\x1b[");
+        } else if (text.endsWith(QLatin1Char('\x1b'))) {
+            m_modeCarry = QStringLiteral("\x1b");
+        }
+    }
+
+    if (m_echo.hasPending()) {
+        hidePrediction();
+        m_echo.reconcile(MessageFilter::stripAnsi(chunk), m_echoClock.elapsed());
+        showPrediction();
+    }
+}
+
+void TerminalWidget::resetInputModes()
+{
+    m_modeCarry.clear();
+    m_applicationCursor = false;
+    m_alternateScreen = false;
+    m_rawModeAuto = false;
+    applyRawMode(false);
+}
+
+void TerminalWidget::applyRawMode(bool enabled)
+{
+    if (m_rawMode == enabled) {
+        return;
+    }
+
+    m_rawMode = enabled;
+    if (!enabled) {
+        hidePrediction();
+        m_echo.abandon();
+    }
+    if (m_historySearchActive) {
+        finishHistorySearch(false);
+    }
+    if (m_entry) {
+        m_entry->setPlaceholderText(enabled ? tr("Raw keyboard mode: keys go straight to the session")
+                                            : tr("Type a command and press Enter"));
+    }
+    emit rawModeChanged(enabled);
+}
+
+bool TerminalWidget::handleRawKeyEvent(QKeyEvent *event)
+{
+    const int key = event->key();
+    const Qt::KeyboardModifiers mods = event->modifiers()
+        & (Qt::ShiftModifier | Qt::ControlModifier | Qt::AltModifier);
+    const bool controlShift = mods == (Qt::ControlModifier | Qt::ShiftModifier);
+    if (controlShift && key == kRawModeToggleKey) {
+        return false;
+    }
+
+    if (event->type() == QEvent::ShortcutOverride) {
+        event->accept();
+        return true;
+    }
+
+    if (controlShift && key == Qt::Key_C) {
+        if (m_display) {
+            m_display->copy();
+        }
+        return true;
+    }
+    if (controlShift && key == Qt::Key_V) {
+        const QClipboard *clipboard = QGuiApplication::clipboard();
+        if (clipboard) {
+            emit keysGenerated(clipboard->text().toUtf8());
+        }
+        predictKey(QString(), false);
+        return true;
+    }
+
+    if (m_latencyProbe) {
+        m_latencyProbe->mark(LatencyStage::Key);
+    }
+
+    const QString text = event->text();
+    const bool printable = text.size() == 1 && text.at(0).isPrint()
+        && !(mods & (Qt::ControlModifier | Qt::AltModifier));
+    if (const QByteArray *bytes = XtermKeyTable::encode(key, mods, text, m_applicationCursor)) {
+        emit keysGenerated(*bytes);
+    } else if (!text.isEmpty()) {
+        // Non-ASCII text is the one case that encodes per key.
+        emit keysGenerated(text.toUtf8());
+    } else {
+        return true;
+    }
+    predictKey(text, printable);
+    return true;
+}
+
+void TerminalWidget::predictKey(const QString &text, bool printable)
+{
+    hidePrediction();
+    if (printable) {
+        m_echo.predict(text.at(0), m_echoClock.elapsed());
+        if (m_echo.hasPending() && !m_echoTimer->isActive()) {
+            m_echoTimer->start();
+        }
+    } else {
+        m_echo.abandon();
+    }
+    showPrediction();
+}
+
+void TerminalWidget::setPredictiveEcho(bool enabled)
+{
+    hidePrediction();
+    m_echo.setEnabled(enabled);
+}
+
+bool TerminalWidget::predictiveEcho() const
+{
+    return m_echo.isEnabled();
+}
+
+EchoPredictionStats TerminalWidget::echoStats() const
+{
+    return m_echo.stats();
+}
+
+void TerminalWidget::setLatencyProbe(KeyLatencyProbe *probe)
+{
+    m_latencyProbe = probe;
+}
+
+void TerminalWidget::setEchoCheck(std::function<bool()> check)
+{
+    m_echoCheck = std::move(check);
+}
+
+void TerminalWidget::setPerfOverlayVisible(bool visible)
+{
+    if (m_perfOverlay) {
+        m_perfOverlay->setActive(visible);
+    }
+}
+
+void TerminalWidget::hidePrediction()
+{
+    // The overlay is never part of the scrollback model, so rolling it back is
+    // just removing its range; reflow and search only ever see echoed text.
+    if (m_prediction.hasSelection()) {
+        m_prediction.removeSelectedText();
+    }
+    m_prediction = QTextCursor();
+}
+
+void TerminalWidget::showPrediction()
+{
+    hidePrediction();
+    if (!m_display || !m_echo.hasPending() || !m_echo.shouldDisplay()) {
+        return;
+    }
+
+    QTextCursor cursor(m_display->document());
+    cursor.movePosition(QTextCursor::End);
+    QTextCharFormat format = cursor.charFormat();
+    format.setAnchor(false);
+    format.setAnchorHref(QString());
+    format.setFontUnderline(true);
+
+    const int start = cursor.position();
+    cursor.insertText(m_echo.pendingText(), format);
+    cursor.setPosition(start, QTextCursor::KeepAnchor);
+    m_prediction = cursor;
+}
+
+bool TerminalWidget::handleEntryEvent(QEvent *event)
+{
+    if (event->type() == QEvent::ShortcutOverride) {
+        const auto *keyEvent = static_cast<QKeyEvent *>(event);
+        if (keyEvent->key() == Qt::Key_K && keyEvent->modifiers() == Qt::ControlModifier) {
+            return true;
+        }
+    }
+
+    if (event->type() == QEvent::KeyPress) {
+        auto *keyEvent = static_cast<QKeyEvent *>(event);
+        if (m_historySearchActive) {
+            return handleHistorySearchKey(keyEvent);
+        }
+
+        const int key = keyEvent->key();
+        const Qt::KeyboardModifiers mods = keyEvent->modifiers();
+        // With nothing to complete, Tab keeps its focus-chain meaning.
+        if (key == Qt::Key_Tab || key == Qt::Key_Backtab) {
+            return m_completer.complete(m_entry, key == Qt::Key_Backtab);
+        }
+        if (key == Qt::Key_R && mods == Qt::ControlModifier) {
+            startHistorySearch();
+            return true;
+        }
+        if ((key == Qt::Key_Up || key == Qt::Key_Down) && mods == Qt::NoModifier) {
+            recallHistory(key == Qt::Key_Up ? -1 : 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TerminalWidget::recallHistory(int direction)
+{
+    const int end = m_commandHistory.end();
+    const int position = m_historyPosition < 0 ? end : m_historyPosition;
+    const int target = direction < 0 ? m_commandHistory.previous(position) : m_commandHistory.next(position);
+    if (target < 0 || (direction > 0 && position == end)) {
+        return;
+    }
+
+    if (m_historyPosition < 0) {
+        m_historyDraft = m_entry->text();
+    }
+    m_historyPosition = target >= end ? -1 : target;
+    m_entry->setText(target >= end ? m_historyDraft : m_commandHistory.at(target));
+}
+
+void TerminalWidget::startHistorySearch()
+{
+    m_historySearchActive = true;
+    m_historyDraft = m_entry->text();
+    m_historyQuery.clear();
+    m_historyMatch = -1;
+    updateHistorySearch();
+}
+
+bool TerminalWidget::handleHistorySearchKey(QKeyEvent *event)
+{
+    const int key = event->key();
+    const Qt::KeyboardModifiers mods = event->modifiers();
+    const int end = m_commandHistory.end();
+
+    if (key == Qt::Key_R && mods == Qt::ControlModifier) {
+        const int older = m_commandHistory.searchBackward(m_historyQuery, m_historyMatch < 0 ? end : m_historyMatch);
+        if (older >= 0) {
+            m_historyMatch = older;
+        }
+        updateHistorySearch();
+        return true;
+    }
+    if (key == Qt::Key_Escape || (key == Qt::Key_G && mods == Qt::ControlModifier)) {
+        finishHistorySearch(false);
+        return true;
+    }
+    if (key == Qt::Key_Return || key == Qt::Key_Enter) {
+        finishHistorySearch(true);
+        submitEntryText();
+        return true;
+    }
+    if (key == Qt::Key_Backspace) {
+        m_historyQuery.chop(1);
+        m_historyMatch = m_historyQuery.isEmpty() ? -1 : m_commandHistory.searchBackward(m_historyQuery, end);
+        updateHistorySearch();
+        return true;
+    }
+
+    const QString text = event->text();
+    if (!text.isEmpty() && text.at(0).isPrint() && !(mods & Qt::ControlModifier)) {
+        m_historyQuery.append(text);
+        const int from = m_historyMatch < 0 ? end : m_historyMatch + 1;
+        m_historyMatch = m_commandHistory.searchBackward(m_historyQuery, from);
+        updateHistorySearch();
+        return true;
+    }
+
+    finishHistorySearch(true);
+    return false;
+}
+
+void TerminalWidget::updateHistorySearch()
+{
+    const bool failed = !m_historyQuery.isEmpty() && m_historyMatch < 0;
+    const QString match = m_historyMatch < 0 ? QString() : m_commandHistory.at(m_historyMatch);
+    m_historyLabel->setText(failed ? tr("(failed reverse-i-search)`%1'").arg(m_historyQuery)
+                                   : tr("(reverse-i-search)`%1'").arg(m_historyQuery));
+    m_historyLabel->show();
+
+    if (m_historyMatch >= 0) {
+        m_entry->setText(match);
+        const int column = static_cast<int>(ScrollbackModel::foldCase(match).indexOf(ScrollbackModel::foldCase(m_historyQuery)));
+        m_entry->setCursorPosition(std::max(0, column));
+    }
+}
+
+void TerminalWidget::finishHistorySearch(bool acceptMatch)
+{
+    m_historySearchActive = false;
+    m_historyLabel->hide();
+    if (!acceptMatch || m_historyMatch < 0) {
+        m_entry->setText(m_historyDraft);
+    }
+    m_historyPosition = -1;
+}
+
+void TerminalWidget::showDisplayContextMenu(const QPoint &position)
+{
+    if (!m_display) {
+        return;
+    }
+
+    QMenu *menu = m_display->createStandardContextMenu(position);
+    const QString id = messageIdNearLine(m_display->cursorForPosition(position).blockNumber());
+    if (!id.isEmpty()) {
+        menu->addSeparator();
+        menu->addAction(tr("Reply to %1").arg(id), this, [this, id]() {
+            prefillEntry(QStringLiteral("/reply %1 ").arg(id));
+        });
+        menu->addAction(tr("Show Message %1").arg(id), this, [this, id]() {
+            emit bytesGenerated(QStringLiteral("/chat %1\r").arg(id).toUtf8());
+        });
+
+        // Reactions are the commands that take nothing but a message id;
+        // /chat is one too, but already has the Show Message entry above.
+        QMenu *reactMenu = menu->addMenu(tr("React"));
+        for (int index = 0; index < CommandCatalog::commandCount(); ++index) {
+            const ArgumentSchema schema = CommandCatalog::argumentSchema(index);
+            if (schema.kind != ArgumentKind::MessageId || schema.rest != ArgumentRest::None
+                || CommandCatalog::name(index) == QLatin1String("/chat")) {
+                continue;
+            }
+            const CommandDescriptor descriptor = CommandCatalog::descriptor(index);
+            const QString command = descriptor.command.arg(id);
+            reactMenu->addAction(descriptor.label, this, [this, command]() {
+                emit bytesGenerated(command.toUtf8() + '\r');
+            });
+        }
+    }
+
+    menu->exec(m_display->viewport()->mapToGlobal(position));
+    delete menu;
+}
+
+void TerminalWidget::prefillEntry(const QString &text)
+{
+    if (!m_entry) {
+        return;
+    }
+
+    m_entry->setText(text);
+    m_entry->setCursorPosition(text.size());
+    m_entry->setFocus(Qt::OtherFocusReason);
+}
+
+DocumentWriter::Overlays TerminalWidget::highlightOutput(const QVector<FormattedFragment> &fragments)
+{
+    DocumentWriter::Overlays overlays;
+    if (m_highlighter.isEmpty() || !m_display) {
+        return overlays;
+    }
+
+    QString batch;
+    for (const FormattedFragment &fragment : fragments) {
+        batch += fragment.text;
+    }
+
+    // Lines are scanned once, when the batch completes them; a line's start
+    // may already be in the document from an earlier batch.
+    int line = m_scrollback.lineCount() - 1;
+    QString text = m_scrollback.lineText(line);
+    int inserted = static_cast<int>(text.size());
+    int lineStart = 0;
+    for (int newline = batch.indexOf(QLatin1Char('\n')); newline >= 0;
+         newline = batch.indexOf(QLatin1Char('\n'), lineStart)) {
+        text.append(batch.constData() + lineStart, newline - lineStart);
+
+        bool mentioned = false;
+        const DocumentWriter::Overlays ranges = highlightLine(text, &mentioned);
+        for (QTextLayout::FormatRange range : ranges) {
+            const int end = range.start + range.length;
+            if (range.start < inserted) {
+                QTextCursor cursor(m_display->document());
+                cursor.setPosition(documentPosition(line, range.start));
+                cursor.setPosition(documentPosition(line, std::min(end, inserted) - 1) + 1, QTextCursor::KeepAnchor);
+                cursor.mergeCharFormat(range.format);
+                range.start = inserted;
+                range.length = end - inserted;
+                if (range.length <= 0) {
+                    continue;
+                }
+            }
+            range.start += lineStart - inserted;
+            overlays.append(range);
+        }
+        if (mentioned) {
+            m_pendingMentions.append(text);
+        }
+
+        text.clear();
+        inserted = 0;
+        lineStart = newline + 1;
+        ++line;
+    }
+    return overlays;
 }
 
+DocumentWriter::Overlays TerminalWidget::highlightLine(const QString &text, bool *mentioned) const
+{
+    DocumentWriter::Overlays overlays;
+    const QVector<HighlightSpan> spans = m_highlighter.scan(text);
+    overlays.reserve(spans.size());
+    const QColor fallback = (m_display ? m_display->palette() : palette()).color(QPalette::Highlight);
+    for (const HighlightSpan &span : spans) {
+        const HighlightRule &rule = m_highlighter.rule(span.rule);
+        QTextLayout::FormatRange range;
+        range.start = span.start;
+        range.length = span.length;
+        range.format.setBackground(rule.color.isValid() ? rule.color : fallback);
+        if (rule.notify) {
+            range.format.setFontWeight(QFont::Bold);
+            if (mentioned) {
+                *mentioned = true;
+            }
+        }
+        overlays.append(range);
+    }
+    return overlays;
+}
@@ -1,26 +1,105 @@
 #pragma once
 
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <QFont>
 #include <QPointer>
+#include <QStringList>
+#include <QTextCursor>
+#include <QVector>
 #include <QWidget>
 
+#include "CommandHistory.h"
+#include "DocumentWriter.h"
+#include "EchoPredictor.h"
+#include "EntryCompleter.h"
+#include "HighlightEngine.h"
+#include "MessageIdIndex.h"
+#include "MessageStore.h"
+#include "ScrollbackIndex.h"
+#include "ScrollbackModel.h"
+
+#include <functional>
+
+class FindBar;
+class HistoryStore;
+class KeyLatencyProbe;
+class MessageFilter;
+class PerfOverlay;
+class QKeyEvent;
+class QLabel;
 class QTextBrowser;
+class QTextCharFormat;
 class QLineEdit;
+class QThread;
+class QTimer;
 class TerminalWidget : public QWidget
 {
     Q_OBJECT
 public:
     explicit TerminalWidget(QWidget *parent = nullptr);
+    ~TerminalWidget() override;
 
     QTextBrowser *display() const;
 
+    // One decoded pty read: logged to history, watched for mode switches,
+    // filtered, then appended. The window and the perf harness both feed
+    // output through here.
+    void receiveOutput(const QString &text, MessageFilter *filter, HistoryStore *history);
+    // Parses, highlights, appends, reflows and indexes text at the end of the
+    // display, lifting the echo prediction around it. A single trailing
+    // newline is dropped.
+    void appendOutput(const QString &text, bool isError = false);
+    QTextCharFormat baseTextFormat(bool isError) const;
+
     void setTerminalFont(const QFont &font);
     QFont terminalFont() const;
 
+    ScrollbackModel *scrollback();
+    MessageStore *messages();
+    CommandHistory *commandHistory();
+    void reflowLines(int firstLine, int lastLine);
+    void indexCompletedLines();
+    void linesPrepended(const QStringList &texts);
+    // Lines indexed while replaying have no known arrival time.
+    void setReplayingHistory(bool replaying);
+    void resetScrollback();
+    QSize computeTerminalSize() const;
+    void showFindBar();
+    bool jumpToMessage(const QString &id);
+    bool jumpToLine(int line);
+    QString messageIdNearLine(int line) const;
+    void setHighlightRules(const QVector<HighlightRule> &rules);
+    DocumentWriter::Overlays highlightOutput(const QVector<FormattedFragment> &fragments);
+    DocumentWriter::Overlays highlightLine(const QString &text, bool *mentioned = nullptr) const;
+
+    void setRawMode(bool enabled);
+    bool rawMode() const;
+    void observeOutput(const QString &chunk);
+    void resetInputModes();
+
+    void setPredictiveEcho(bool enabled);
+    bool predictiveEcho() const;
+    EchoPredictionStats echoStats() const;
+    void hidePrediction();
+    void showPrediction();
+    void setLatencyProbe(KeyLatencyProbe *probe);
+    void setPerfOverlayVisible(bool visible);
+    // Consulted on submit; lines typed while it reports echo off are kept out of the history.
+    void setEchoCheck(std::function<bool()> check);
+
+    void setResizeDebounceInterval(int milliseconds);
+    int resizeDebounceInterval() const;
+    quint64 suppressedSizeUpdates() const;
+
 signals:
     void bytesGenerated(const QByteArray &data);
     void terminalSizeChanged(int columns, int rows);
+    void historyRequested();
+    void mentionDetected(const QString &text);
+    void entrySubmitted(const QString &text);
+    void keysGenerated(const QByteArray &data);
+    void rawModeChanged(bool enabled);
 
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
@@ -29,10 +108,75 @@ protected:
 
 private:
     void submitEntryText();
+    void updateEntryValidation();
     void scheduleTerminalSizeUpdate();
     void emitTerminalSize();
+    void updateWrapColumns();
+    void reflowVisibleLines();
+    void reflowPendingLines();
+    bool reflowLine(QTextCursor &cursor, int index);
+    int documentPosition(int line, int column) const;
+    void runSearch(const QString &query);
+    void handleSearchFinished(quint64 requestId, const QString &query, const QVector<ScrollbackMatch> &matches);
+    void stepMatch(int delta);
+    void updateSearchHighlights();
+    void clearSearch();
+    bool handleViewportEvent(QEvent *event);
+    bool handleEntryEvent(QEvent *event);
+    bool handleRawKeyEvent(QKeyEvent *event);
+    void applyRawMode(bool enabled);
+    void predictKey(const QString &text, bool printable);
+    void recallHistory(int direction);
+    void startHistorySearch();
+    bool handleHistorySearchKey(QKeyEvent *event);
+    void updateHistorySearch();
+    void finishHistorySearch(bool acceptMatch);
+    void showDisplayContextMenu(const QPoint &position);
+    void prefillEntry(const QString &text);
 
     QPointer<QTextBrowser> m_display;
+    QPointer<FindBar> m_findBar;
     QPointer<QLineEdit> m_entry;
-    bool m_pendingSizeUpdate = false;
+    QPointer<QLabel> m_historyLabel;
+    QPointer<QLabel> m_validationLabel;
+    PerfOverlay *m_perfOverlay = nullptr;
+    QTimer *m_reflowTimer = nullptr;
+    QTimer *m_sizeUpdateTimer = nullptr;
+    QTimer *m_echoTimer = nullptr;
+    std::function<bool()> m_echoCheck;
+    KeyLatencyProbe *m_latencyProbe = nullptr;
+    QSize m_lastEmittedSize;
+    quint64 m_suppressedSizeUpdates = 0;
+    QThread *m_searchThread = nullptr;
+    ScrollbackIndex *m_searchIndex = nullptr;
+    ScrollbackModel m_scrollback;
+    MessageIdIndex m_messageIds;
+    MessageStore m_messages;
+    HighlightEngine m_highlighter;
+    EntryCompleter m_completer;
+    EchoPredictor m_echo;
+    QElapsedTimer m_echoClock;
+    QTextCursor m_prediction;
+    CommandHistory m_commandHistory;
+    QString m_historyDraft;
+    QString m_historyQuery;
+    QString m_entryError;
+    QStringList m_pendingMentions;
+    int m_historyPosition = -1;
+    int m_historyMatch = -1;
+    bool m_historySearchActive = false;
+    bool m_rawMode = false;
+    bool m_rawModeAuto = false;
+    bool m_applicationCursor = false;
+    bool m_alternateScreen = false;
+    QString m_modeCarry;
+    QPoint m_pressPosition;
+    QVector<ScrollbackMatch> m_searchMatches;
+    quint64 m_searchRequestId = 0;
+    int m_currentMatch = -1;
+    int m_indexedLineCount = 0;
+    int m_wrapColumns = 0;
+    int m_reflowSweepLine = -1;
+    bool m_reflowing = false;
+    bool m_replayingHistory = false;
 };
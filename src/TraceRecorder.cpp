@@ -0,0 +1,191 @@
+#include "TraceRecorder.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr int kDefaultEventsPerThread = 65536;
+
+struct TraceEvent {
+    const char *name = nullptr;
+    qint64 startNs = 0;
+    qint64 endNs = 0;
+};
+
+// One writer per buffer; readers copy a snapshot and drop whatever the
+// writer lapped while they were copying.
+struct ThreadBuffer {
+    int id = 0;
+    QByteArray name;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<quint64> head {0};
+};
+
+bool tracingRequested()
+{
+    const QByteArray value = qgetenv("CHATTER_TRACE");
+    return !value.isEmpty() && value != "0";
+}
+
+quint64 eventsPerThread()
+{
+    static const quint64 capacity = []() {
+        bool ok = false;
+        const int value = qEnvironmentVariableIntValue("CHATTER_TRACE", &ok);
+        return quint64(ok && value > 1 ? value : kDefaultEventsPerThread);
+    }();
+    return capacity;
+}
+
+QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+// Buffers outlive their threads so a trace still covers finished workers.
+std::vector<ThreadBuffer *> &registry()
+{
+    static std::vector<ThreadBuffer *> buffers;
+    return buffers;
+}
+
+ThreadBuffer *threadBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        auto *created = new ThreadBuffer;
+        created->events.reset(new TraceEvent[eventsPerThread()]);
+
+        QThread *thread = QThread::currentThread();
+        const bool isMain = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+        created->name = isMain ? QByteArrayLiteral("main") : thread->objectName().toUtf8();
+
+        QMutexLocker locker(&registryMutex());
+        created->id = static_cast<int>(registry().size()) + 1;
+        if (created->name.isEmpty()) {
+            created->name = "thread " + QByteArray::number(created->id);
+        }
+        created->name.replace('\\', "\\\\").replace('"', "\\\"");
+        registry().push_back(created);
+        buffer = created;
+    }
+    return buffer;
+}
+
+QByteArray micros(qint64 nanos)
+{
+    return QByteArray::number(double(nanos) / 1000.0, 'f', 3);
+}
+} // namespace
+
+const bool TraceRecorder::s_enabled = tracingRequested();
+
+qint64 TraceRecorder::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void TraceRecorder::record(const char *name, qint64 startNs, qint64 endNs)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent &event = buffer->events[head % eventsPerThread()];
+    event.name = name;
+    event.startNs = startNs;
+    event.endNs = endNs;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::exportChromeTrace(const QString &filePath, QString *error)
+{
+    struct Snapshot {
+        int id;
+        QByteArray name;
+        std::vector<TraceEvent> events;
+    };
+
+    std::vector<Snapshot> snapshots;
+    {
+        QMutexLocker locker(&registryMutex());
+        snapshots.reserve(registry().size());
+        for (ThreadBuffer *buffer : registry()) {
+            const quint64 capacity = eventsPerThread();
+            const quint64 head = buffer->head.load(std::memory_order_acquire);
+            const quint64 first = head > capacity ? head - capacity : 0;
+
+            Snapshot snapshot {buffer->id, buffer->name, {}};
+            snapshot.events.reserve(head - first);
+            for (quint64 index = first; index < head; ++index) {
+                snapshot.events.push_back(buffer->events[index % capacity]);
+            }
+
+            // The writer may be part-way into the slot after head, so count it as lapped.
+            const quint64 lapped = buffer->head.load(std::memory_order_acquire) + 1;
+            if (lapped > first + capacity) {
+                const quint64 stale = std::min<quint64>(lapped - capacity - first, snapshot.events.size());
+                snapshot.events.erase(snapshot.events.begin(), snapshot.events.begin() + qsizetype(stale));
+            }
+            snapshots.push_back(std::move(snapshot));
+        }
+    }
+
+    qint64 origin = std::numeric_limits<qint64>::max();
+    size_t total = 0;
+    for (const Snapshot &snapshot : snapshots) {
+        for (const TraceEvent &event : snapshot.events) {
+            origin = std::min(origin, event.startNs);
+        }
+        total += snapshot.events.size();
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json;
+    json.reserve(qsizetype(total) * 96 + 256);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool firstEvent = true;
+    auto separator = [&]() {
+        if (!firstEvent) {
+            json += ",\n";
+        }
+        firstEvent = false;
+    };
+
+    for (const Snapshot &snapshot : snapshots) {
+        const QByteArray tid = QByteArray::number(snapshot.id);
+        separator();
+        json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid
+            + ",\"args\":{\"name\":\"" + snapshot.name + "\"}}";
+        for (const TraceEvent &event : snapshot.events) {
+            separator();
+            json += "{\"ph\":\"X\",\"name\":\"";
+            json += event.name;
+            json += "\",\"pid\":" + pid + ",\"tid\":" + tid
+                + ",\"ts\":" + micros(event.startNs - origin)
+                + ",\"dur\":" + micros(event.endNs - event.startNs) + '}';
+        }
+    }
+    json += "]}\n";
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
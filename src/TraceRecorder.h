@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// Scoped pipeline trace events kept in per-thread ring buffers and exported
+// as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). Recording is
+// switched on by CHATTER_TRACE at startup; a value above 1 sets the number
+// of events each thread keeps. When it is off a scope costs one load.
+class TraceRecorder
+{
+public:
+    static bool isEnabled()
+    {
+        return s_enabled;
+    }
+
+    static qint64 now();
+    static void record(const char *name, qint64 startNs, qint64 endNs);
+    static bool exportChromeTrace(const QString &filePath, QString *error);
+
+private:
+    static const bool s_enabled;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name)
+        , m_start(TraceRecorder::isEnabled() ? TraceRecorder::now() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_start >= 0) {
+            TraceRecorder::record(m_name, m_start, TraceRecorder::now());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    const qint64 m_start;
+};
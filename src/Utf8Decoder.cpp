@@ -0,0 +1,83 @@
+#include "Utf8Decoder.h"
+
+void Utf8Decoder::append(const char *data, int size)
+{
+    m_buffer.append(data, size);
+}
+
+QString Utf8Decoder::take()
+{
+    QString result;
+
+    while (!m_buffer.isEmpty()) {
+        const int length = boundaryLength();
+        if (length <= 0) {
+            break;
+        }
+
+        result.append(QString::fromUtf8(m_buffer.constData(), length));
+        m_buffer.remove(0, length);
+    }
+
+    return result;
+}
+
+int Utf8Decoder::boundaryLength() const
+{
+    if (m_buffer.isEmpty()) {
+        return 0;
+    }
+
+    const int size = m_buffer.size();
+    int index = 0;
+    int lastComplete = 0;
+
+    while (index < size) {
+        const unsigned char byte = static_cast<unsigned char>(m_buffer.at(index));
+
+        int expected = 0;
+        if ((byte & 0x80) == 0x00) {
+            expected = 1;
+        } else if ((byte & 0xE0) == 0xC0) {
+            expected = 2;
+        } else if ((byte & 0xF0) == 0xE0) {
+            expected = 3;
+        } else if ((byte & 0xF8) == 0xF0) {
+            expected = 4;
+        } else {
+            return index + 1;
+        }
+
+        if (index + expected > size) {
+            break;
+        }
+
+        bool valid = true;
+        for (int i = 1; i < expected; ++i) {
+            const unsigned char continuation = static_cast<unsigned char>(m_buffer.at(index + i));
+            if ((continuation & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+        }
+
+        if (!valid) {
+            return index + 1;
+        }
+
+        index += expected;
+        lastComplete = index;
+    }
+
+    return lastComplete;
+}
+
+bool Utf8Decoder::isEmpty() const
+{
+    return m_buffer.isEmpty();
+}
+
+void Utf8Decoder::clear()
+{
+    m_buffer.clear();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Buffers pty output and decodes it up to the last complete UTF-8 sequence,
+// so a character split across reads is decoded once its tail arrives.
+class Utf8Decoder
+{
+public:
+    void append(const char *data, int size);
+    QString take();
+    int boundaryLength() const;
+    bool isEmpty() const;
+    void clear();
+
+private:
+    QByteArray m_buffer;
+};
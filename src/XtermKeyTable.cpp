@@ -0,0 +1,225 @@
+#include "XtermKeyTable.h"
+
+#include <array>
+
+namespace {
+
+enum SpecialKey {
+    KeyUp,
+    KeyDown,
+    KeyRight,
+    KeyLeft,
+    KeyHome,
+    KeyEnd,
+    KeyInsert,
+    KeyDelete,
+    KeyPageUp,
+    KeyPageDown,
+    KeyF1,
+    KeyF2,
+    KeyF3,
+    KeyF4,
+    KeyF5,
+    KeyF6,
+    KeyF7,
+    KeyF8,
+    KeyF9,
+    KeyF10,
+    KeyF11,
+    KeyF12,
+    KeyBackspace,
+    KeyTab,
+    KeyBacktab,
+    KeyReturn,
+    KeyEscape,
+    SpecialKeyCount
+};
+
+// Shift, Alt and Control give eight modifier states; xterm encodes them as 1 + bits.
+constexpr int kModifierStates = 8;
+constexpr int kShiftBit = 1;
+constexpr int kAltBit = 2;
+constexpr int kControlBit = 4;
+
+struct Table {
+    std::array<std::array<std::array<QByteArray, 2>, kModifierStates>, SpecialKeyCount> special;
+    std::array<QByteArray, 128> ascii;
+    std::array<QByteArray, 128> altAscii;
+};
+
+int specialKeyIndex(int key)
+{
+    switch (key) {
+    case Qt::Key_Up: return KeyUp;
+    case Qt::Key_Down: return KeyDown;
+    case Qt::Key_Right: return KeyRight;
+    case Qt::Key_Left: return KeyLeft;
+    case Qt::Key_Home: return KeyHome;
+    case Qt::Key_End: return KeyEnd;
+    case Qt::Key_Insert: return KeyInsert;
+    case Qt::Key_Delete: return KeyDelete;
+    case Qt::Key_PageUp: return KeyPageUp;
+    case Qt::Key_PageDown: return KeyPageDown;
+    case Qt::Key_F1: return KeyF1;
+    case Qt::Key_F2: return KeyF2;
+    case Qt::Key_F3: return KeyF3;
+    case Qt::Key_F4: return KeyF4;
+    case Qt::Key_F5: return KeyF5;
+    case Qt::Key_F6: return KeyF6;
+    case Qt::Key_F7: return KeyF7;
+    case Qt::Key_F8: return KeyF8;
+    case Qt::Key_F9: return KeyF9;
+    case Qt::Key_F10: return KeyF10;
+    case Qt::Key_F11: return KeyF11;
+    case Qt::Key_F12: return KeyF12;
+    case Qt::Key_Backspace: return KeyBackspace;
+    case Qt::Key_Tab: return KeyTab;
+    case Qt::Key_Backtab: return KeyBacktab;
+    case Qt::Key_Return:
+    case Qt::Key_Enter: return KeyReturn;
+    case Qt::Key_Escape: return KeyEscape;
+    default: return -1;
+    }
+}
+
+QByteArray cursorSequence(char final, int state, bool applicationCursor)
+{
+    if (state != 0) {
+        return QByteArray("\x1b[1;") + QByteArray::number(state + 1) + final;
+    }
+    return QByteArray(applicationCursor ? "\x1bO" : "\x1b[") + final;
+}
+
+QByteArray tildeSequence(int code, int state)
+{
+    QByteArray sequence = QByteArray("\x1b[") + QByteArray::number(code);
+    if (state != 0) {
+        sequence += ';' + QByteArray::number(state + 1);
+    }
+    return sequence + '~';
+}
+
+QByteArray functionSequence(char final, int state)
+{
+    if (state != 0) {
+        return QByteArray("\x1b[1;") + QByteArray::number(state + 1) + final;
+    }
+    return QByteArray("\x1bO") + final;
+}
+
+QByteArray withAlt(const QByteArray &bytes, int state)
+{
+    return (state & kAltBit) ? QByteArray("\x1b") + bytes : bytes;
+}
+
+QByteArray specialSequence(int index, int state, bool applicationCursor)
+{
+    static constexpr char cursorFinals[] = {'A', 'B', 'C', 'D', 'H', 'F'};
+    static constexpr int tildeCodes[] = {2, 3, 5, 6};
+    static constexpr char functionFinals[] = {'P', 'Q', 'R', 'S'};
+    static constexpr int upperFunctionCodes[] = {15, 17, 18, 19, 20, 21, 23, 24};
+
+    if (index <= KeyEnd) {
+        return cursorSequence(cursorFinals[index - KeyUp], state, applicationCursor);
+    }
+    if (index <= KeyPageDown) {
+        return tildeSequence(tildeCodes[index - KeyInsert], state);
+    }
+    if (index <= KeyF4) {
+        return functionSequence(functionFinals[index - KeyF1], state);
+    }
+    if (index <= KeyF12) {
+        return tildeSequence(upperFunctionCodes[index - KeyF5], state);
+    }
+
+    switch (index) {
+    case KeyBackspace:
+        return withAlt((state & kControlBit) ? QByteArray("\x08") : QByteArray("\x7f"), state);
+    case KeyTab:
+        return withAlt(QByteArray("\t"), state);
+    case KeyBacktab:
+        return withAlt(QByteArray("\x1b[Z"), state);
+    case KeyReturn:
+        return withAlt(QByteArray("\r"), state);
+    case KeyEscape:
+        return withAlt(QByteArray("\x1b"), state);
+    default:
+        return QByteArray();
+    }
+}
+
+const Table &table()
+{
+    static const Table built = []() {
+        Table result;
+        for (int index = 0; index < SpecialKeyCount; ++index) {
+            for (int state = 0; state < kModifierStates; ++state) {
+                result.special[index][state][0] = specialSequence(index, state, false);
+                result.special[index][state][1] = specialSequence(index, state, true);
+            }
+        }
+        for (int ch = 0; ch < 128; ++ch) {
+            result.ascii[ch] = QByteArray(1, char(ch));
+            result.altAscii[ch] = QByteArray("\x1b") + char(ch);
+        }
+        return result;
+    }();
+    return built;
+}
+
+int modifierState(Qt::KeyboardModifiers modifiers)
+{
+    int state = 0;
+    if (modifiers & Qt::ShiftModifier) {
+        state |= kShiftBit;
+    }
+    if (modifiers & Qt::AltModifier) {
+        state |= kAltBit;
+    }
+    if (modifiers & Qt::ControlModifier) {
+        state |= kControlBit;
+    }
+    return state;
+}
+
+} // namespace
+
+const QByteArray *XtermKeyTable::encode(int key, Qt::KeyboardModifiers modifiers, const QString &text,
+                                        bool applicationCursor)
+{
+    const Table &keys = table();
+    const int state = modifierState(modifiers);
+
+    const int index = specialKeyIndex(key);
+    if (index >= 0) {
+        const QByteArray &sequence = keys.special[index][state][applicationCursor ? 1 : 0];
+        return sequence.isEmpty() ? nullptr : &sequence;
+    }
+
+    const bool alt = (state & kAltBit) != 0;
+    if (state & kControlBit) {
+        if (key >= Qt::Key_A && key <= Qt::Key_Z) {
+            const int control = key - Qt::Key_A + 1;
+            return alt ? &keys.altAscii[control] : &keys.ascii[control];
+        }
+        switch (key) {
+        case Qt::Key_Space:
+        case Qt::Key_At:
+            return alt ? &keys.altAscii[0] : &keys.ascii[0];
+        case Qt::Key_BracketLeft:
+            return alt ? &keys.altAscii[0x1b] : &keys.ascii[0x1b];
+        case Qt::Key_Backslash:
+            return alt ? &keys.altAscii[0x1c] : &keys.ascii[0x1c];
+        case Qt::Key_BracketRight:
+            return alt ? &keys.altAscii[0x1d] : &keys.ascii[0x1d];
+        default:
+            break;
+        }
+    }
+
+    if (text.size() == 1 && text.at(0).unicode() < 128) {
+        const int ch = text.at(0).unicode();
+        return alt ? &keys.altAscii[ch] : &keys.ascii[ch];
+    }
+    return nullptr;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <Qt>
+
+// xterm input encodings, built once. Lookups hand out shared byte arrays, so
+// translating a key press never allocates.
+class XtermKeyTable
+{
+public:
+    static const QByteArray *encode(int key, Qt::KeyboardModifiers modifiers, const QString &text,
+                                    bool applicationCursor);
+};
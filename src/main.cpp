@@ -1,12 +1,16 @@
 #include "MainWindow.h"
 #include "CommandCatalog.h"
+#include "ScrollbackIndex.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    QApplication::setOrganizationName(QStringLiteral("chatter"));
+    QApplication::setApplicationName(QStringLiteral("chatter-frontend"));
     qRegisterMetaType<CommandDescriptor>("CommandDescriptor");
+    qRegisterMetaType<QVector<ScrollbackMatch>>("QVector<ScrollbackMatch>");
 
     MainWindow window;
     window.resize(900, 600);